@@ -0,0 +1,1383 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    compressed_log.c
+// Notes:   Random access into gzip (and, if built with it, zstd) compressed
+//          logs.  The first time we see a compressed log we decompress the
+//          whole thing once and drop a checkpoint roughly every megabyte of
+//          output.  For gzip that's the zran trick from the zlib examples:
+//          remember where a deflate block starts, the odd bits of the byte
+//          before it and the 32K of output before it, and inflate can be
+//          restarted right there.  zstd can only restart at a frame, so
+//          files written as lots of small frames (seekable zstd) get the
+//          same treatment and single frame files get one checkpoint and a
+//          lot of decompressing.
+//
+//          The checkpoints get saved next to the map files so every later
+//          search only has to decompress the blocks it actually reads.
+//
+//          Synthetic logs (the benchmark spec files) hang off the same hooks,
+//          their bytes get made up by synthetic_log instead of decompressed.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#ifdef TGREP_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "compressed_log.h"
+#include "map_file.h"
+#include "console_output.h"
+#include "stats.h"
+#include "synthetic_log.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//how much output goes by between checkpoints.  this is roughly how much
+//has to be decompressed to read any one byte.
+#define COMPRESSED_SPAN          (1024*1024)
+
+//checkpoints land on block boundaries so the stretch between two is a bit
+//over a span.  up to this size it's decompressed and cached as one block,
+//anything bigger (single frame zstd) gets carved into spans.
+#define COMPRESSED_MAX_BLOCK     (4*COMPRESSED_SPAN)
+
+//deflate can look back 32K, so that's what a gzip checkpoint has to carry
+#define COMPRESSED_WINDOW_SIZE   (32768)
+
+#define COMPRESSED_INPUT_SIZE    (64*1024)
+#define COMPRESSED_CACHE_BLOCKS  (4)
+
+#define COMPRESSED_INDEX_MAGIC   "TGREPZIX"
+#define COMPRESSED_INDEX_VERSION (1)
+
+//a spec file is a handful of key=value lines
+#define SYNTHETIC_SPEC_MAX       (4096)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//where the decompressor can be restarted.  stream_start means a gzip member
+//or zstd frame begins right at in_offset and needs no history.
+struct _checkpoint {
+    int64_t out_offset;
+    int64_t in_offset;
+    int32_t bits;
+    int32_t stream_start;
+};
+
+typedef struct _checkpoint checkpoint;
+
+//front of the saved index, followed by the checkpoints and then (gzip only)
+//one window per checkpoint.  it's tied to the compressed file by its size
+//and mtime, compressed logs don't usually change once they're written.
+struct _compressed_index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t type;
+    uint64_t checkpoint_count;
+    int64_t compressed_size;
+    int64_t compressed_mtime;
+    int64_t uncompressed_size;
+    uint32_t reserved[4];
+};
+
+typedef struct _compressed_index_header compressed_index_header;
+
+struct _cache_block {
+    off_t start;
+    size_t length;
+    char *data;
+    unsigned long last_used;
+};
+
+typedef struct _cache_block cache_block;
+
+_Static_assert(sizeof(checkpoint) == 24, "checkpoint layout changed, bump COMPRESSED_INDEX_VERSION");
+_Static_assert(sizeof(compressed_index_header) == 64, "compressed index header must stay 64 bytes");
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static int compressed_fd = -1;
+static compression_type compressed_type = COMPRESSION_NONE;
+static off_t uncompressed_size = 0;
+
+//the index, either built by us or mapped from the saved file
+static checkpoint *checkpoints = NULL;
+static int checkpoint_count = 0;
+static int checkpoint_capacity = 0;
+static unsigned char *windows = NULL;
+static char *index_mapping = NULL;
+static size_t index_mapping_size = 0;
+
+static cache_block cache[COMPRESSED_CACHE_BLOCKS];
+static unsigned long cache_clock = 0;
+
+//the index builder reads from several threads, they take turns in here
+static pthread_mutex_t compressed_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//the decoder is left running after every block, so the next block along
+//(which is what a dump asks for) carries on instead of starting over
+static int decoder_active = 0;
+static off_t decoder_out = 0;
+static off_t decoder_in = 0;
+static int decoder_finished = 0;
+static unsigned char input_buffer[COMPRESSED_INPUT_SIZE];
+static char discard_buffer[COMPRESSED_INPUT_SIZE];
+
+static z_stream inflater;
+static int inflater_ready = 0;
+static int inflater_raw = 0;
+static int inflater_trailer_left = 0;
+static int inflater_member_check = 0;
+
+#ifdef TGREP_WITH_ZSTD
+static ZSTD_DCtx *zstd_context = NULL;
+static ZSTD_inBuffer zstd_input;
+#endif
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static char *_index_path(const struct stat *file_stat);
+static int _load_index(const char *path, const struct stat *file_stat);
+static void _save_index(const char *path, const struct stat *file_stat);
+static int _add_checkpoint(off_t out_offset, off_t in_offset, int bits, int stream_start, const unsigned char *window);
+static int _build_gzip_index(void);
+static int _find_checkpoint(off_t offset);
+static cache_block *_get_block(off_t offset);
+static ssize_t _decompress_range(off_t start, size_t length, char *dest);
+static int _decoder_start(int index);
+static ssize_t _decoder_read(char *dest, size_t size);
+static void _decoder_end(void);
+static int _fill_input(void);
+static ssize_t _gzip_read(char *dest, size_t size);
+static int _write_all(int fd, const void *data, size_t size);
+static int _open_synthetic(void);
+
+#ifdef TGREP_WITH_ZSTD
+static int _build_zstd_index(void);
+static ssize_t _zstd_read(char *dest, size_t size);
+#endif
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    detect_compression
+// Notes:   gzip starts 1f 8b, zstd frames start 28 b5 2f fd, spec files
+//          start with their magic line
+//
+//******************************************************************************
+compression_type detect_compression(int fd)
+{
+    unsigned char magic[sizeof(SYNTHETIC_SPEC_MAGIC) - 1];
+    ssize_t got = pread(fd, magic, sizeof(magic), 0);
+
+    if(got < 4)
+    {
+        return COMPRESSION_NONE;
+    }
+    if(got == sizeof(magic) && memcmp(magic, SYNTHETIC_SPEC_MAGIC, sizeof(magic)) == 0)
+    {
+        return COMPRESSION_SYNTHETIC;
+    }
+    if(magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        return COMPRESSION_GZIP;
+    }
+    if(magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+    {
+#ifdef TGREP_WITH_ZSTD
+        return COMPRESSION_ZSTD;
+#else
+        console_print_error("This tgrep was built without zstd support.\n");
+#endif
+    }
+    return COMPRESSION_NONE;
+}
+
+
+
+//******************************************************************************
+// Name:    compressed_log_open
+// Notes:   Uses the saved index if it still matches the file, otherwise does
+//          the one full pass and saves the result for next time.
+//
+//******************************************************************************
+int compressed_log_open(int fd, compression_type type, const struct stat *file_stat)
+{
+    char *path;
+    int result = -1;
+
+    if(compressed_fd != -1 || type == COMPRESSION_NONE)
+    {
+        return -1;
+    }
+    compressed_fd = fd;
+    compressed_type = type;
+
+    if(type == COMPRESSION_SYNTHETIC)
+    {
+        return _open_synthetic();
+    }
+
+    path = _index_path(file_stat);
+    if(path != NULL && _load_index(path, file_stat))
+    {
+        console_print_info("Using checkpoint index: %s\n",path);
+        result = 1;
+    }
+    else
+    {
+        console_print_info("Building checkpoint index for %s log.\n",compressed_log_name());
+#ifdef TGREP_WITH_ZSTD
+        if(type == COMPRESSION_ZSTD)
+        {
+            result = _build_zstd_index();
+        }
+        else
+#endif
+        {
+            result = _build_gzip_index();
+        }
+
+        if(result > 0)
+        {
+            console_print_info("%d checkpoints over %lld bytes.\n",checkpoint_count,(long long int)uncompressed_size);
+            if(path != NULL)
+            {
+                _save_index(path, file_stat);
+            }
+        }
+    }
+    free(path);
+
+    if(result < 0)
+    {
+        console_print_error("Could not read the compressed log.\n");
+        compressed_log_close();
+    }
+    return result;
+}
+
+
+
+//******************************************************************************
+// Name:    compressed_log_close
+// Notes:   Drops the index, the cache and the decoder.  The descriptor
+//          belongs to file_scan.
+//
+//******************************************************************************
+void compressed_log_close(void)
+{
+    int i;
+
+    if(compressed_type == COMPRESSION_SYNTHETIC)
+    {
+        synthetic_log_close();
+    }
+    _decoder_end();
+    if(index_mapping != NULL)
+    {
+        munmap(index_mapping, index_mapping_size);
+        index_mapping = NULL;
+        index_mapping_size = 0;
+    }
+    else
+    {
+        free(checkpoints);
+        free(windows);
+    }
+    checkpoints = NULL;
+    windows = NULL;
+    checkpoint_count = 0;
+    checkpoint_capacity = 0;
+
+    for(i = 0; i < COMPRESSED_CACHE_BLOCKS; i++)
+    {
+        free(cache[i].data);
+        memset(&cache[i], 0, sizeof(cache[i]));
+    }
+    cache_clock = 0;
+
+    compressed_fd = -1;
+    compressed_type = COMPRESSION_NONE;
+    uncompressed_size = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    compressed_log_size
+// Notes:   Decompressed size
+//
+//******************************************************************************
+off_t compressed_log_size(void)
+{
+    return uncompressed_size;
+}
+
+
+
+//******************************************************************************
+// Name:    compressed_log_read
+// Notes:   Copies out of cached blocks, decompressing whichever ones are
+//          missing.  Short only at the end of the log (or if the compressed
+//          data is damaged).
+//
+//******************************************************************************
+ssize_t compressed_log_read(char *buffer, size_t size, off_t offset)
+{
+    cache_block *block;
+    size_t copied = 0;
+    size_t chunk;
+
+    if(compressed_fd == -1 || offset < 0)
+    {
+        return -1;
+    }
+    if(compressed_type == COMPRESSION_SYNTHETIC)
+    {
+        return synthetic_log_read(buffer, size, offset);
+    }
+
+    pthread_mutex_lock(&compressed_lock);
+    while(copied < size && offset < uncompressed_size)
+    {
+        block = _get_block(offset);
+        if(block == NULL)
+        {
+            break;
+        }
+        chunk = block->length - (size_t)(offset - block->start);
+        if(chunk > size - copied)
+        {
+            chunk = size - copied;
+        }
+        memcpy(buffer + copied, block->data + (offset - block->start), chunk);
+        copied += chunk;
+        offset += (off_t)chunk;
+    }
+    pthread_mutex_unlock(&compressed_lock);
+
+    if(copied == 0 && size > 0 && offset < uncompressed_size)
+    {
+        return -1;
+    }
+    return (ssize_t)copied;
+}
+
+
+
+//******************************************************************************
+// Name:    compressed_log_name
+// Notes:   For -v and --stats
+//
+//******************************************************************************
+const char *compressed_log_name(void)
+{
+    switch(compressed_type)
+    {
+    case COMPRESSION_GZIP:
+        return "gzip";
+    case COMPRESSION_ZSTD:
+        return "zstd";
+    case COMPRESSION_SYNTHETIC:
+        return "synthetic";
+    default:
+        return "none";
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    compressed_log_peek_size
+// Notes:   Just reads the saved header, the rotation set code uses it to know
+//          how big the log will be without opening it.
+//
+//******************************************************************************
+off_t compressed_log_peek_size(const struct stat *file_stat)
+{
+    char *path = _index_path(file_stat);
+    compressed_index_header header;
+    off_t size = -1;
+    int fd;
+
+    if(path == NULL)
+    {
+        return -1;
+    }
+    fd = open(path, O_RDONLY);
+    free(path);
+    if(fd < 0)
+    {
+        return -1;
+    }
+    if(pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+       memcmp(header.magic, COMPRESSED_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+       header.version == COMPRESSED_INDEX_VERSION &&
+       header.compressed_size == (int64_t)file_stat->st_size &&
+       header.compressed_mtime == (int64_t)file_stat->st_mtime)
+    {
+        size = (off_t)header.uncompressed_size;
+    }
+    close(fd);
+    return size;
+}
+
+
+
+//******************************************************************************
+// Name:    _index_path
+// Notes:   Named like the map file, device and inode, different extension.
+//          Caller frees.
+//
+//******************************************************************************
+static char *_index_path(const struct stat *file_stat)
+{
+    char index_name[64];
+
+    sprintf(index_name,".%llx-%llx.zidx",(unsigned long long int)file_stat->st_dev,(unsigned long long int)file_stat->st_ino);
+    return get_map_file_path(index_name);
+}
+
+
+
+//******************************************************************************
+// Name:    _load_index
+// Notes:   Maps a saved index read-only and points the checkpoint and window
+//          arrays straight into it.
+//
+//******************************************************************************
+static int _load_index(const char *path, const struct stat *file_stat)
+{
+    compressed_index_header header;
+    struct stat index_stat;
+    size_t expected_size;
+    char *mapping;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return 0;
+    }
+
+    if(pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+       memcmp(header.magic, COMPRESSED_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != COMPRESSED_INDEX_VERSION ||
+       header.type != (uint32_t)compressed_type ||
+       header.checkpoint_count == 0)
+    {
+        console_print_info("Discarding checkpoint index with the wrong format.\n");
+        close(fd);
+        return 0;
+    }
+    if(header.compressed_size != (int64_t)file_stat->st_size ||
+       header.compressed_mtime != (int64_t)file_stat->st_mtime)
+    {
+        console_print_info("Discarding checkpoint index, the compressed log changed.\n");
+        close(fd);
+        return 0;
+    }
+
+    expected_size = sizeof(header) + (size_t)header.checkpoint_count * sizeof(checkpoint);
+    if(compressed_type == COMPRESSION_GZIP)
+    {
+        expected_size += (size_t)header.checkpoint_count * COMPRESSED_WINDOW_SIZE;
+    }
+    if(fstat(fd, &index_stat) != 0 || (size_t)index_stat.st_size != expected_size)
+    {
+        console_print_info("Discarding truncated checkpoint index.\n");
+        close(fd);
+        return 0;
+    }
+
+    mapping = mmap(NULL, expected_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    index_mapping = mapping;
+    index_mapping_size = expected_size;
+    checkpoints = (checkpoint *)(mapping + sizeof(header));
+    checkpoint_count = (int)header.checkpoint_count;
+    windows = NULL;
+    if(compressed_type == COMPRESSION_GZIP)
+    {
+        windows = (unsigned char *)(mapping + sizeof(header) + (size_t)checkpoint_count * sizeof(checkpoint));
+    }
+    uncompressed_size = (off_t)header.uncompressed_size;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _save_index
+// Notes:   Same temporary-and-rename dance as the map files
+//
+//******************************************************************************
+static void _save_index(const char *path, const struct stat *file_stat)
+{
+    compressed_index_header header;
+    char *temp_path;
+    int ok;
+    int fd;
+
+    temp_path = malloc(strlen(path) + 5);
+    if(temp_path == NULL)
+    {
+        return;
+    }
+    strcpy(temp_path, path);
+    strcat(temp_path, ".tmp");
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COMPRESSED_INDEX_MAGIC, sizeof(header.magic));
+    header.version = COMPRESSED_INDEX_VERSION;
+    header.type = (uint32_t)compressed_type;
+    header.checkpoint_count = (uint64_t)checkpoint_count;
+    header.compressed_size = (int64_t)file_stat->st_size;
+    header.compressed_mtime = (int64_t)file_stat->st_mtime;
+    header.uncompressed_size = (int64_t)uncompressed_size;
+
+    fd = open(temp_path, O_WRONLY | O_TRUNC | O_CREAT, 0666);
+    if(fd < 0)
+    {
+        console_print_info("%s\n",strerror( errno ));
+        free(temp_path);
+        return;
+    }
+
+    ok = _write_all(fd, &header, sizeof(header)) &&
+         _write_all(fd, checkpoints, (size_t)checkpoint_count * sizeof(checkpoint));
+    if(ok && compressed_type == COMPRESSION_GZIP)
+    {
+        ok = _write_all(fd, windows, (size_t)checkpoint_count * COMPRESSED_WINDOW_SIZE);
+    }
+    close(fd);
+
+    if(!ok || rename(temp_path, path) != 0)
+    {
+        console_print_debug("Could not save the checkpoint index.\n");
+        unlink(temp_path);
+    }
+    else
+    {
+        console_print_info("Saving checkpoint index: %s\n",path);
+    }
+    free(temp_path);
+}
+
+
+
+//******************************************************************************
+// Name:    _add_checkpoint
+// Notes:   Only used while building, so the arrays are ours to grow.  The
+//          window is already straightened out (oldest byte first).
+//
+//******************************************************************************
+static int _add_checkpoint(off_t out_offset, off_t in_offset, int bits, int stream_start, const unsigned char *window)
+{
+    if(checkpoint_count == checkpoint_capacity)
+    {
+        int new_capacity = (checkpoint_capacity == 0) ? 64 : checkpoint_capacity * 2;
+        checkpoint *new_checkpoints = realloc(checkpoints, new_capacity * sizeof(checkpoint));
+        if(new_checkpoints == NULL)
+        {
+            return 0;
+        }
+        checkpoints = new_checkpoints;
+
+        if(compressed_type == COMPRESSION_GZIP)
+        {
+            unsigned char *new_windows = realloc(windows, (size_t)new_capacity * COMPRESSED_WINDOW_SIZE);
+            if(new_windows == NULL)
+            {
+                return 0;
+            }
+            windows = new_windows;
+        }
+        checkpoint_capacity = new_capacity;
+    }
+
+    checkpoints[checkpoint_count].out_offset = (int64_t)out_offset;
+    checkpoints[checkpoint_count].in_offset = (int64_t)in_offset;
+    checkpoints[checkpoint_count].bits = bits;
+    checkpoints[checkpoint_count].stream_start = stream_start;
+    if(compressed_type == COMPRESSION_GZIP)
+    {
+        unsigned char *slot = windows + (size_t)checkpoint_count * COMPRESSED_WINDOW_SIZE;
+        if(window != NULL)
+        {
+            memcpy(slot, window, COMPRESSED_WINDOW_SIZE);
+        }
+        else
+        {
+            memset(slot, 0, COMPRESSED_WINDOW_SIZE);
+        }
+    }
+    checkpoint_count++;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _build_gzip_index
+// Notes:   zran's build_index.  Inflate a block at a time (Z_BLOCK) into a
+//          circular 32K window, and at block boundaries a span or more past
+//          the last checkpoint, save one.  Concatenated members (what you
+//          get from appending to a .gz) just carry on.
+//
+//******************************************************************************
+static int _build_gzip_index(void)
+{
+    z_stream strm;
+    unsigned char *window = malloc(COMPRESSED_WINDOW_SIZE);
+    unsigned char *linear = malloc(COMPRESSED_WINDOW_SIZE);
+    off_t read_position = 0;
+    off_t total_in = 0;
+    off_t total_out = 0;
+    off_t last = 0;
+    ssize_t got;
+    size_t left;
+    int finished = 0;
+    int ret;
+
+    if(window == NULL || linear == NULL)
+    {
+        free(window);
+        free(linear);
+        return -1;
+    }
+    memset(window, 0, COMPRESSED_WINDOW_SIZE);
+    memset(&strm, 0, sizeof(strm));
+    if(inflateInit2(&strm, 47) != Z_OK)
+    {
+        free(window);
+        free(linear);
+        return -1;
+    }
+
+    _add_checkpoint(0, 0, 0, 1, NULL);
+    strm.avail_out = 0;
+    while(!finished)
+    {
+        if(strm.avail_in == 0)
+        {
+            got = pread(compressed_fd, input_buffer, COMPRESSED_INPUT_SIZE, read_position);
+            if(got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(got <= 0)
+            {
+                //a .gz that's still being written, use what's there
+                console_print_info("Compressed log ends mid stream.\n");
+                break;
+            }
+            read_position += got;
+            strm.next_in = input_buffer;
+            strm.avail_in = (uInt)got;
+        }
+
+        if(strm.avail_out == 0)
+        {
+            strm.next_out = window;
+            strm.avail_out = COMPRESSED_WINDOW_SIZE;
+        }
+
+        total_in += strm.avail_in;
+        total_out += strm.avail_out;
+        ret = inflate(&strm, Z_BLOCK);
+        total_in -= strm.avail_in;
+        total_out -= strm.avail_out;
+
+        if(ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+        {
+            console_print_error("Compressed log is damaged at byte %lld.\n",(long long int)total_in);
+            inflateEnd(&strm);
+            free(window);
+            free(linear);
+            return -1;
+        }
+
+        if(ret == Z_STREAM_END)
+        {
+            //see whether another member follows, anything else is junk
+            while(strm.avail_in == 0)
+            {
+                got = pread(compressed_fd, input_buffer, COMPRESSED_INPUT_SIZE, read_position);
+                if(got < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if(got <= 0)
+                {
+                    break;
+                }
+                read_position += got;
+                strm.next_in = input_buffer;
+                strm.avail_in = (uInt)got;
+            }
+            if(strm.avail_in == 0 || strm.next_in[0] != 0x1f)
+            {
+                finished = 1;
+            }
+            else
+            {
+                inflateReset(&strm);
+            }
+            continue;
+        }
+
+        if((strm.data_type & 128) && !(strm.data_type & 64) && total_out - last >= COMPRESSED_SPAN)
+        {
+            left = strm.avail_out;
+            if(left)
+            {
+                memcpy(linear, window + COMPRESSED_WINDOW_SIZE - left, left);
+            }
+            if(left < COMPRESSED_WINDOW_SIZE)
+            {
+                memcpy(linear + left, window, COMPRESSED_WINDOW_SIZE - left);
+            }
+            if(!_add_checkpoint(total_out, total_in, strm.data_type & 7, 0, linear))
+            {
+                break;
+            }
+            last = total_out;
+        }
+    }
+
+    inflateEnd(&strm);
+    free(window);
+    free(linear);
+    uncompressed_size = total_out;
+    return (total_out > 0) ? 1 : -1;
+}
+
+
+
+#ifdef TGREP_WITH_ZSTD
+//******************************************************************************
+// Name:    _build_zstd_index
+// Notes:   Streams through every frame.  Each time one ends and we're a span
+//          past the last checkpoint, the next frame gets one.
+//
+//******************************************************************************
+static int _build_zstd_index(void)
+{
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    size_t output_size = ZSTD_DStreamOutSize();
+    char *output = malloc(output_size);
+    ZSTD_inBuffer in = {input_buffer, 0, 0};
+    ZSTD_outBuffer out;
+    off_t read_position = 0;
+    off_t total_out = 0;
+    off_t last = 0;
+    size_t ret = 0;
+    ssize_t got;
+
+    if(context == NULL || output == NULL)
+    {
+        ZSTD_freeDCtx(context);
+        free(output);
+        return -1;
+    }
+
+    _add_checkpoint(0, 0, 0, 1, NULL);
+    for(;;)
+    {
+        if(in.pos == in.size)
+        {
+            got = pread(compressed_fd, input_buffer, COMPRESSED_INPUT_SIZE, read_position);
+            if(got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(got <= 0)
+            {
+                break;
+            }
+            read_position += got;
+            in.size = (size_t)got;
+            in.pos = 0;
+        }
+
+        out.dst = output;
+        out.size = output_size;
+        out.pos = 0;
+        ret = ZSTD_decompressStream(context, &out, &in);
+        if(ZSTD_isError(ret))
+        {
+            console_print_error("Compressed log is damaged: %s\n",ZSTD_getErrorName(ret));
+            ZSTD_freeDCtx(context);
+            free(output);
+            return -1;
+        }
+        total_out += (off_t)out.pos;
+
+        if(ret == 0 && total_out - last >= COMPRESSED_SPAN)
+        {
+            if(!_add_checkpoint(total_out, read_position - (off_t)(in.size - in.pos), 0, 1, NULL))
+            {
+                break;
+            }
+            last = total_out;
+        }
+    }
+    if(ret != 0)
+    {
+        console_print_info("Compressed log ends mid frame.\n");
+    }
+
+    //a checkpoint right at the end has nothing after it
+    if(checkpoint_count > 1 && checkpoints[checkpoint_count - 1].out_offset >= total_out)
+    {
+        checkpoint_count--;
+    }
+
+    ZSTD_freeDCtx(context);
+    free(output);
+    uncompressed_size = total_out;
+    return (total_out > 0) ? 1 : -1;
+}
+#endif
+
+
+
+//******************************************************************************
+// Name:    _find_checkpoint
+// Notes:   Last checkpoint at or before offset
+//
+//******************************************************************************
+static int _find_checkpoint(off_t offset)
+{
+    int low = 0;
+    int high = checkpoint_count - 1;
+    int middle;
+
+    while(low < high)
+    {
+        middle = (low + high + 1) / 2;
+        if(checkpoints[middle].out_offset <= (int64_t)offset)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+
+
+//******************************************************************************
+// Name:    _get_block
+// Notes:   The cached block holding offset, decompressing it into the least
+//          recently used slot if we don't have it.  A block is the stretch
+//          between two checkpoints, or a span of it if that's too big.
+//
+//******************************************************************************
+static cache_block *_get_block(off_t offset)
+{
+    cache_block *slot = &cache[0];
+    off_t extent_start;
+    off_t extent_end;
+    off_t start;
+    off_t end;
+    ssize_t got;
+    char *data;
+    int index;
+    int i;
+
+    for(i = 0; i < COMPRESSED_CACHE_BLOCKS; i++)
+    {
+        if(cache[i].data != NULL && offset >= cache[i].start && offset < cache[i].start + (off_t)cache[i].length)
+        {
+            cache[i].last_used = ++cache_clock;
+            return &cache[i];
+        }
+        if(cache[i].last_used < slot->last_used)
+        {
+            slot = &cache[i];
+        }
+    }
+
+    index = _find_checkpoint(offset);
+    extent_start = (off_t)checkpoints[index].out_offset;
+    extent_end = (index + 1 < checkpoint_count) ? (off_t)checkpoints[index + 1].out_offset : uncompressed_size;
+    if(extent_end - extent_start <= COMPRESSED_MAX_BLOCK)
+    {
+        start = extent_start;
+        end = extent_end;
+    }
+    else
+    {
+        start = extent_start + ((offset - extent_start) / COMPRESSED_SPAN) * COMPRESSED_SPAN;
+        end = start + COMPRESSED_SPAN;
+        if(end > extent_end)
+        {
+            end = extent_end;
+        }
+    }
+
+    data = realloc(slot->data, (size_t)(end - start));
+    if(data == NULL)
+    {
+        return NULL;
+    }
+    slot->data = data;
+    slot->start = start;
+    slot->length = 0;
+    slot->last_used = ++cache_clock;
+
+    got = _decompress_range(start, (size_t)(end - start), slot->data);
+    if(got <= 0 || offset >= start + got)
+    {
+        free(slot->data);
+        memset(slot, 0, sizeof(*slot));
+        return NULL;
+    }
+    slot->length = (size_t)got;
+    return slot;
+}
+
+
+
+//******************************************************************************
+// Name:    _decompress_range
+// Notes:   Gets the decoder to start and fills dest from there.  If the
+//          decoder is already sitting somewhere between the right checkpoint
+//          and start, it just keeps going.
+//
+//******************************************************************************
+static ssize_t _decompress_range(off_t start, size_t length, char *dest)
+{
+    int index = _find_checkpoint(start);
+    size_t total = 0;
+    size_t skip;
+    ssize_t got;
+
+    if(!decoder_active || decoder_out > start || decoder_out < (off_t)checkpoints[index].out_offset)
+    {
+        if(_decoder_start(index) < 0)
+        {
+            return -1;
+        }
+    }
+
+    while(decoder_out < start)
+    {
+        skip = sizeof(discard_buffer);
+        if((off_t)skip > start - decoder_out)
+        {
+            skip = (size_t)(start - decoder_out);
+        }
+        if(_decoder_read(discard_buffer, skip) <= 0)
+        {
+            return -1;
+        }
+    }
+
+    while(total < length)
+    {
+        got = _decoder_read(dest + total, length - total);
+        if(got <= 0)
+        {
+            break;
+        }
+        total += (size_t)got;
+    }
+    stats_add(STAT_BLOCKS_DECOMPRESSED, 1);
+    return (ssize_t)total;
+}
+
+
+
+//******************************************************************************
+// Name:    _decoder_start
+// Notes:   Puts the decoder at a checkpoint.  Mid-stream gzip checkpoints
+//          need a raw inflater primed with the leftover bits and the window.
+//
+//******************************************************************************
+static int _decoder_start(int index)
+{
+    const checkpoint *here = &checkpoints[index];
+    unsigned char byte;
+
+    _decoder_end();
+    decoder_out = (off_t)here->out_offset;
+    decoder_in = (off_t)here->in_offset;
+    decoder_finished = 0;
+
+#ifdef TGREP_WITH_ZSTD
+    if(compressed_type == COMPRESSION_ZSTD)
+    {
+        zstd_context = ZSTD_createDCtx();
+        if(zstd_context == NULL)
+        {
+            return -1;
+        }
+        zstd_input.src = input_buffer;
+        zstd_input.size = 0;
+        zstd_input.pos = 0;
+        decoder_active = 1;
+        return 0;
+    }
+#endif
+
+    memset(&inflater, 0, sizeof(inflater));
+    if(inflateInit2(&inflater, here->stream_start ? 47 : -15) != Z_OK)
+    {
+        return -1;
+    }
+    inflater_ready = 1;
+    inflater_raw = !here->stream_start;
+    inflater_trailer_left = 0;
+    inflater_member_check = 0;
+
+    if(!here->stream_start)
+    {
+        if(here->bits)
+        {
+            decoder_in--;
+            if(pread(compressed_fd, &byte, 1, decoder_in) != 1)
+            {
+                _decoder_end();
+                return -1;
+            }
+            decoder_in++;
+            inflatePrime(&inflater, here->bits, byte >> (8 - here->bits));
+        }
+        inflateSetDictionary(&inflater, windows + (size_t)index * COMPRESSED_WINDOW_SIZE, COMPRESSED_WINDOW_SIZE);
+    }
+    decoder_active = 1;
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _decoder_read
+// Notes:   Up to size bytes of output from wherever the decoder is.  0 once
+//          the compressed data runs out, -1 if it's damaged.
+//
+//******************************************************************************
+static ssize_t _decoder_read(char *dest, size_t size)
+{
+    ssize_t got;
+
+    if(!decoder_active || decoder_finished)
+    {
+        return 0;
+    }
+#ifdef TGREP_WITH_ZSTD
+    if(compressed_type == COMPRESSION_ZSTD)
+    {
+        got = _zstd_read(dest, size);
+    }
+    else
+#endif
+    {
+        got = _gzip_read(dest, size);
+    }
+
+    if(got < 0)
+    {
+        console_print_error("Compressed log is damaged near byte %lld.\n",(long long int)decoder_in);
+        _decoder_end();
+        return -1;
+    }
+    decoder_out += got;
+    stats_add(STAT_BYTES_DECOMPRESSED, got);
+    return got;
+}
+
+
+
+//******************************************************************************
+// Name:    _decoder_end
+// Notes:   Lets go of whatever decoder is running
+//
+//******************************************************************************
+static void _decoder_end(void)
+{
+    if(inflater_ready)
+    {
+        inflateEnd(&inflater);
+        inflater_ready = 0;
+    }
+#ifdef TGREP_WITH_ZSTD
+    if(zstd_context != NULL)
+    {
+        ZSTD_freeDCtx(zstd_context);
+        zstd_context = NULL;
+    }
+#endif
+    decoder_active = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _fill_input
+// Notes:   Next chunk of compressed data into the input buffer.  Returns how
+//          much arrived, 0 at the end of the file.
+//
+//******************************************************************************
+static int _fill_input(void)
+{
+    ssize_t got;
+
+    do
+    {
+        got = pread(compressed_fd, input_buffer, COMPRESSED_INPUT_SIZE, decoder_in);
+    } while(got < 0 && errno == EINTR);
+
+    if(got <= 0)
+    {
+        return 0;
+    }
+    decoder_in += got;
+    return (int)got;
+}
+
+
+
+//******************************************************************************
+// Name:    _gzip_read
+// Notes:   Mid-stream checkpoints inflate raw deflate, so when a member ends
+//          we have to step over its 8 byte trailer ourselves before looking
+//          for the next member's header.
+//
+//******************************************************************************
+static ssize_t _gzip_read(char *dest, size_t size)
+{
+    int got;
+    int ret;
+
+    inflater.next_out = (unsigned char *)dest;
+    inflater.avail_out = (uInt)size;
+
+    while(inflater.avail_out > 0)
+    {
+        if(inflater_trailer_left > 0 || inflater_member_check)
+        {
+            if(inflater.avail_in == 0)
+            {
+                got = _fill_input();
+                if(got == 0)
+                {
+                    decoder_finished = 1;
+                    break;
+                }
+                inflater.next_in = input_buffer;
+                inflater.avail_in = (uInt)got;
+            }
+            if(inflater_trailer_left > 0)
+            {
+                uInt skip = ((uInt)inflater_trailer_left < inflater.avail_in) ? (uInt)inflater_trailer_left : inflater.avail_in;
+                inflater.next_in += skip;
+                inflater.avail_in -= skip;
+                inflater_trailer_left -= (int)skip;
+                continue;
+            }
+            if(inflater.next_in[0] != 0x1f)
+            {
+                decoder_finished = 1;
+                break;
+            }
+            inflateReset2(&inflater, 31);
+            inflater_raw = 0;
+            inflater_member_check = 0;
+        }
+
+        ret = inflate(&inflater, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END)
+        {
+            //gzip mode eats its own trailer, raw mode leaves it to us
+            inflater_trailer_left = inflater_raw ? 8 : 0;
+            inflater_member_check = 1;
+            continue;
+        }
+        if(ret == Z_BUF_ERROR && inflater.avail_in == 0)
+        {
+            got = _fill_input();
+            if(got == 0)
+            {
+                decoder_finished = 1;
+                break;
+            }
+            inflater.next_in = input_buffer;
+            inflater.avail_in = (uInt)got;
+            continue;
+        }
+        if(ret != Z_OK)
+        {
+            return -1;
+        }
+    }
+    return (ssize_t)(size - inflater.avail_out);
+}
+
+
+
+#ifdef TGREP_WITH_ZSTD
+//******************************************************************************
+// Name:    _zstd_read
+// Notes:   Frames just follow one another, the stream decoder takes care of
+//          moving on to the next one.  Give it a go before reading more input
+//          since it may still be holding output from last time.
+//
+//******************************************************************************
+static ssize_t _zstd_read(char *dest, size_t size)
+{
+    ZSTD_outBuffer out = {dest, size, 0};
+    size_t before;
+    size_t ret;
+    int got;
+
+    while(out.pos < out.size)
+    {
+        before = out.pos;
+        ret = ZSTD_decompressStream(zstd_context, &out, &zstd_input);
+        if(ZSTD_isError(ret))
+        {
+            return -1;
+        }
+        if(out.pos == before && zstd_input.pos == zstd_input.size)
+        {
+            got = _fill_input();
+            if(got == 0)
+            {
+                decoder_finished = 1;
+                break;
+            }
+            zstd_input.size = (size_t)got;
+            zstd_input.pos = 0;
+        }
+    }
+    return (ssize_t)out.pos;
+}
+#endif
+
+
+
+//******************************************************************************
+// Name:    _open_synthetic
+// Notes:   No index to build, the spec is the index
+//
+//******************************************************************************
+static int _open_synthetic(void)
+{
+    char text[SYNTHETIC_SPEC_MAX];
+    synthetic_spec spec;
+    ssize_t got;
+
+    got = pread(compressed_fd, text, sizeof(text), 0);
+    if(got <= 0 || synthetic_spec_parse(text, (size_t)got, &spec) < 0 || synthetic_log_open(&spec) < 0)
+    {
+        console_print_error("Could not make sense of the synthetic log spec.\n");
+        compressed_fd = -1;
+        compressed_type = COMPRESSION_NONE;
+        return -1;
+    }
+    uncompressed_size = synthetic_log_size();
+    console_print_info("Synthetic %s log, %lld bytes.\n",synthetic_shape_name(spec.shape),(long long int)uncompressed_size);
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _write_all
+// Notes:   Keeps calling write until everything is out
+//
+//******************************************************************************
+static int _write_all(int fd, const void *data, size_t size)
+{
+    const char *working = data;
+    ssize_t written;
+
+    while(size > 0)
+    {
+        written = write(fd, working, size);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return 0;
+        }
+        working += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
@@ -0,0 +1,69 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    compressed_log.h
+// Notes:   header for the compressed_log module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_COMPRESSED_LOG_H__
+#define __TGREP_COMPRESSED_LOG_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+typedef enum
+{
+    COMPRESSION_NONE = 0,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD,
+    COMPRESSION_SYNTHETIC
+} compression_type;
+
+//looks at the magic at the front of the file.  zstd files are only
+//recognised when tgrep was built with zstd support.  synthetic_log spec
+//files come through here too, they're "compressed" about as far as a log
+//can be.
+compression_type detect_compression(int fd);
+
+//gets the compressed log ready for random access: loads its checkpoint index
+//from the map directory or builds one (a single pass over the file) and
+//saves it there.  returns 1 on success, -1 on failure.
+int compressed_log_open(int fd, compression_type type, const struct stat *file_stat);
+void compressed_log_close(void);
+
+//the size of the log once it's decompressed
+off_t compressed_log_size(void);
+
+//pread() on the decompressed log.  only the blocks the range touches get
+//decompressed, and the last few are kept around.  safe to call from several
+//threads at once (they take turns).
+ssize_t compressed_log_read(char *buffer, size_t size, off_t offset);
+
+//"gzip", "zstd" or "synthetic"
+const char *compressed_log_name(void);
+
+//the decompressed size recorded in the saved index for this file, without
+//opening the file itself, or -1 if there isn't a current index for it
+off_t compressed_log_peek_size(const struct stat *file_stat);
+
+#endif
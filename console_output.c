@@ -53,6 +53,7 @@
 static int debug_enabled = 0;
 static int info_enabled = 0;
 static int error_enabled = 1;
+static int explain_enabled = 0;
 
 
 
@@ -100,6 +101,31 @@ void console_enable_error()
 
 
 
+//******************************************************************************
+// Name:    console_enable_explain
+// Notes:   Enables the probe trajectory (--explain)
+//
+//******************************************************************************
+void console_enable_explain()
+{
+    explain_enabled = 1;
+}
+
+
+
+//******************************************************************************
+// Name:    console_explain_enabled
+// Notes:   The search does some extra work to describe itself, it skips that
+//          when nobody's listening
+//
+//******************************************************************************
+int console_explain_enabled()
+{
+    return explain_enabled;
+}
+
+
+
 //******************************************************************************
 // Name:    console_disable_debug
 // Notes:   disables debug printing (default)
@@ -179,6 +205,26 @@ void console_print_info(const char *format, ...)
 
 
 
+//******************************************************************************
+// Name:    console_print_explain
+// Notes:   prints a formatted explain message in YELLOW/BOLD
+//
+//******************************************************************************
+void console_print_explain(const char *format, ...)
+{
+    if(explain_enabled)
+    {
+        va_list arg;
+        va_start(arg,format);
+        fprintf(stderr, "\033[01;33mEXPLAIN: ");
+        vfprintf(stderr, format, arg);
+        va_end(arg);
+        fprintf(stderr,"\033[0m");
+    }
+}
+
+
+
 //******************************************************************************
 // Name:    console_print_info
 // Notes:   prints a formatted error message in RED/BOLD
@@ -209,15 +255,55 @@ void console_print_error(const char *format, ...)
 //******************************************************************************
 void console_print_help()
 {
-    fprintf(stderr,"Usage: tgrep [OPTION]... SEARCH_PATTERN [FILE]\n");
+    fprintf(stderr,"Usage: tgrep [OPTION]... SEARCH_PATTERN [FILE]...\n");
+    fprintf(stderr,"   or: tgrep [OPTION]... --build-index [FILE]...\n");
     fprintf(stderr,"Search for SEARCH_PATTERN in FILE or /logs/haproxy.log\n");
-    fprintf(stderr,"SEARCH_PATTERN is, by default, a basic hh:mm:ss timestamp\n");
+    fprintf(stderr,"Several FILEs, a directory or a quoted glob are searched as one log,\n");
+    fprintf(stderr,"oldest file first (e.g. tgrep 10:00-11:00 '/logs/haproxy.log*')\n");
+    fprintf(stderr,"gzip (and zstd, if built with ZSTD=1) compressed FILEs are searched in place\n");
+    fprintf(stderr,"SEARCH_PATTERN is, by default, a basic hh:mm:ss[.fff] timestamp\n");
+    fprintf(stderr,"Lines can have syslog, ISO-8601, RFC 5424 or nginx stamps, which one is worked out from the log\n");
+    fprintf(stderr,"Without a date it matches on every day the log covers, [YYYY-]MM-DDThh:mm:ss picks one\n");
+    fprintf(stderr,"Several SEARCH_PATTERNs can be given, the lines for all of them come out once each, in time order\n");
     fprintf(stderr,"Example: tgrep 12:13:16-14:32:44 ~/logs/super_awesome_log.log\n");
+    fprintf(stderr,"         tgrep 12:00-13:00 -e ' 503 ' -e ' 504 ' ~/logs/super_awesome_log.log\n");
+    fprintf(stderr,"         tgrep 02-10T23:30-00:30 /logs/haproxy.log\n");
+    fprintf(stderr,"         tgrep -f 06:52 /logs/haproxy.log\n");
+    fprintf(stderr,"         tgrep --ranges=alerts.txt /logs/haproxy.log\n");
+    fprintf(stderr,"         tgrep --time-field=accept 06:52:00.500-06:52:00.700 /logs/haproxy.log\n");
     fprintf(stderr,"\n");
     fprintf(stderr,"Options:\n");
     fprintf(stderr,"  -v,                       Print more verbose output to standard error\n");
     fprintf(stderr,"  -d,                       Print debug output to standard error. DEBUG ONLY\n");
     fprintf(stderr,"  -h                        Prints this helpful help message!\n");
+    fprintf(stderr,"  -f, --follow              Keep printing new lines as the log grows, until they pass the end\n");
+    fprintf(stderr,"                            of the range (a single time, not a range, follows for good)\n");
+    fprintf(stderr,"  -e, --regexp=STRING       Only print the lines in the range containing STRING\n");
+    fprintf(stderr,"      --regex=REGEX         Only print the lines in the range matching the extended REGEX\n");
+    fprintf(stderr,"                            (-e and --regex can be given several times, any match counts)\n");
+    fprintf(stderr,"      --ranges=FILE         Read more SEARCH_PATTERNs from FILE, one per line (- is standard input)\n");
+    fprintf(stderr,"      --stats               Print a JSON summary of the run to standard error: counters for\n");
+    fprintf(stderr,"                            the map, probes and output, and the time spent in each phase\n");
+    fprintf(stderr,"      --explain             Print every step of the search to standard error: the bracket,\n");
+    fprintf(stderr,"                            where it probed and what it learned\n");
+    fprintf(stderr,"      --format=NAME         The log's stamps: auto (the default), syslog, iso8601, rfc5424 or nginx\n");
+    fprintf(stderr,"      --time-field=syslog|accept\n");
+    fprintf(stderr,"                            Which stamp of a line to search on, the syslog one or haproxy's\n");
+    fprintf(stderr,"                            millisecond accept date (default syslog)\n");
+    fprintf(stderr,"      --reader=mmap|read    How searches read the log file (default mmap)\n");
+    fprintf(stderr,"      --io=sync|uring       Blocking I/O or io_uring for probes and output (default sync)\n");
+    fprintf(stderr,"      --probes=K            Read K spots of the log at once per search step (default 1)\n");
+    fprintf(stderr,"      --build-index         Index every second of FILE up front and save the map\n");
+    fprintf(stderr,"      --huge-pages          Keep the time map in 2MB pages (explicit ones if the system has\n");
+    fprintf(stderr,"                            any reserved, transparent ones otherwise)\n");
+    fprintf(stderr,"      --map-budget=SIZE     Most memory (and disk) a log's time map may take, with an optional\n");
+    fprintf(stderr,"                            K, M or G (default 64M, 0 for no limit).  Past it the map keeps one\n");
+    fprintf(stderr,"                            entry a minute away from recent searches.\n");
+    fprintf(stderr,"  -j, --threads=N           Threads for --build-index and filtering (default: one per cpu)\n");
+    fprintf(stderr,"      --daemon[=SOCKET]     Stay running and answer --client queries, keeping logs and maps open\n");
+    fprintf(stderr,"                            (the daemon's own options apply to every query it answers)\n");
+    fprintf(stderr,"      --client[=SOCKET]     Hand the search to a running --daemon, or search here if there isn't one\n");
+    fprintf(stderr,"                            (SOCKET defaults to ~/.tgrepmapfiles/tgrep.sock)\n");
 }
 
 
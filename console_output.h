@@ -35,6 +35,10 @@ void console_print_debug(const char *format, ...);
 void console_print_info(const char *format, ...);
 void console_print_error(const char *format, ...);
 
+//how the search got where it did (--explain), one line per probe round
+void console_print_explain(const char *format, ...);
+int console_explain_enabled();
+
 //little different on this one
 void console_print_help();
 
@@ -42,6 +46,7 @@ void console_print_help();
 void console_enable_debug();
 void console_enable_info();
 void console_enable_error();
+void console_enable_explain();
 void console_disable_debug();
 void console_disable_info();
 void console_disable_error();
@@ -40,6 +40,7 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 
 
 
@@ -51,15 +52,60 @@
 #include "map_file.h"
 #include "file_scan.h"
 #include "console_output.h"
+#include "range_output.h"
+#include "stats.h"
+#include "compressed_log.h"
+#include "line_scan.h"
+#include "log_format.h"
+#include "probe_pool.h"
+#include "uring_io.h"
+#include "line_filter.h"
 
 //******************************************************************************
 // Module Specific #defines
 //******************************************************************************
 
-//4096, sure...  This could probably be optimized by aligning our reads to
-//sector boundries to keep the HD from seeking around too much, oh well.
-#define READ_BUFFER_SIZE   (4096)
-#define READ_OFFSET        (READ_BUFFER_SIZE/2)
+//the probe window starts out at a block and doubles every time a probe
+//doesn't teach us anything (a line longer than the window, a second with
+//more lines than fit), then halves again once the bracket is narrow.  a
+//line longer than the max and we give up on the search.
+#define PROBE_WINDOW_MIN   (4096)
+#define PROBE_WINDOW_MAX   (64*1024*1024)
+
+//windows start on a block boundary, but don't let a filesystem with huge
+//blocks make every probe enormous
+#define PROBE_ALIGN_MAX    (1024*1024)
+
+//readahead hints: how much of a range to ask for while its end is still
+//being searched for, and the most we ever ask for in one go (the dump's own
+//sequential readahead takes it from there)
+#define PREFETCH_FIRST_WINDOW   (1024*1024)
+#define PREFETCH_MAX_RANGE      (64*1024*1024)
+
+//lines handed back by each line_scan call
+#define LINE_SCAN_BATCH    (64)
+
+//upper limit for --probes
+#define PROBE_MAX_COUNT    (64)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//everything that belongs to one open log, for handing it to the daemon
+//between queries (see detach_log_file).  the buffers are scratch space and
+//stay with the module.
+struct _log_context {
+    int log_file;
+    struct stat log_file_stat;
+    off_t file_end_offset;
+    size_t probe_window;
+    size_t probe_alignment;
+    char *log_map;
+    size_t log_map_size;
+};
 
 
 
@@ -74,8 +120,39 @@ static struct stat log_file_stat;
 static off_t file_end_offset;
 
 
-//declare our read buffer
-static char read_buffer[READ_BUFFER_SIZE];
+//declare our read buffer, it grows along with the probe window
+static char *read_buffer = NULL;
+static size_t read_buffer_size = 0;
+
+//the current probe window and what it gets aligned to (the bigger of a page
+//and the file's st_blksize)
+static size_t probe_window = PROBE_WINDOW_MIN;
+static size_t probe_alignment = PROBE_WINDOW_MIN;
+
+//time changes (one line's second to the next) the probes have seen since
+//the search last reset it.  none means the window sat inside one second.
+static int probe_time_changes = 0;
+
+//when the mmap reader is in use the whole file lives here and "reads" are
+//just pointers into it.
+static log_reader selected_reader = LOG_READER_MMAP;
+static char *log_map = NULL;
+static size_t log_map_size = 0;
+
+//gzip/zstd logs are read through the compressed_log module, every offset
+//in here is an offset into the decompressed log
+static compression_type log_compression = COMPRESSION_NONE;
+
+//how many windows each round of the search reads.  1 is the plain one read
+//at a time search, more than that and the reads go out together through the
+//probe pool, one buffer each.
+static int probe_count = 1;
+static char *probe_buffers = NULL;
+static size_t probe_buffers_size = 0;
+
+//with io_uring the probe batches go out as one submit instead of through the
+//pool's threads
+static log_io_engine io_engine = LOG_IO_SYNC;
 
 //this is going to store our current buffer offsets
 static off_t read_start_offset = (off_t)0;
@@ -86,12 +163,24 @@ static off_t read_end_offset = (off_t)0;
 //******************************************************************************
 // Module Specific Functions
 //******************************************************************************
-static char *read_from_offset_start(off_t read_offset);
+static char *read_from_offset_start(off_t read_offset, size_t read_length);
 static char *read_from_offset_center(off_t read_offset);
-static void parse_times_around_offset(off_t offset);
-static off_t _get_confirmed_start_offset(int time);
-static int _start_offset_found(int time);
-static off_t _get_confirmed_end_offset(int time);
+static int parse_times_around_offset(off_t offset);
+static int _parse_window(const char *working, off_t window_start, size_t window_length);
+static off_t _window_bounds(off_t center_offset, size_t *length);
+static int _grow_probe_window(void);
+static void _fit_probe_window(off_t bracket_size);
+static int _probe_round(off_t low_offset, off_t high_offset, off_t target_offset);
+static int _add_probe_center(off_t *centers, int count, off_t center);
+static int _read_windows(off_t *centers, int count, int batch);
+static off_t _get_confirmed_start_offset(epoch_time time);
+static int _start_offset_found(epoch_time time);
+static off_t _get_confirmed_end_offset(epoch_time time);
+static off_t _line_length(const char *working, off_t remaining);
+static void _map_log_file(void);
+static void _advise_log_map(off_t start_offset, off_t end_offset, int advice);
+static void _label_log_file(void);
+static int _start_log_times(void);
 
 
 
@@ -123,21 +212,60 @@ int open_log_file(char *file_name)
         return -1;
     }
 
-    //The set log time start day will help us later with parsing the log entries
-    if(set_log_time_start_day(read_from_offset_start(0)))
+    //we need the size up front, the mmap reader can't hand out anything past
+    //the end of the mapping.  fstat rather than stat so we're describing the
+    //file we actually opened even if the name just got rotated.
+    file_end_offset = lseek(log_file, 0, SEEK_END);
+    fstat(log_file,&log_file_stat);
+
+    //every probe window is a whole number of blocks on a block boundary
+    probe_alignment = (size_t)sysconf(_SC_PAGESIZE);
+    if(log_file_stat.st_blksize > 0 && (size_t)log_file_stat.st_blksize > probe_alignment &&
+       log_file_stat.st_blksize <= PROBE_ALIGN_MAX)
+    {
+        probe_alignment = (size_t)log_file_stat.st_blksize;
+    }
+    if(probe_alignment < PROBE_WINDOW_MIN)
+    {
+        probe_alignment = PROBE_WINDOW_MIN;
+    }
+    probe_window = probe_alignment;
+
+    log_compression = detect_compression(log_file);
+    if(log_compression != COMPRESSION_NONE)
+    {
+        if(compressed_log_open(log_file, log_compression, &log_file_stat) < 0)
+        {
+            close_log_file();
+            return -1;
+        }
+        file_end_offset = compressed_log_size();
+    }
+    else
+    {
+        //probes jump all over the place, readahead around them is wasted.
+        //the mapping gets the same treatment in _map_log_file.
+        posix_fadvise(log_file, 0, 0, POSIX_FADV_RANDOM);
+        if(selected_reader == LOG_READER_MMAP)
+        {
+            _map_log_file();
+        }
+    }
+
+    //work out the stamp layout (and for syslog, the years) from the start
+    if(_start_log_times())
     {
         //now just compile some data about the file so we can start searching it
-        file_end_offset = lseek(log_file, 0, SEEK_END);
         set_log_file_start_offset();
         set_log_file_end_offset();
-        stat(file_name,&log_file_stat);
-        console_print_info("Opened %s\n",file_name);
+        console_print_info("Opened %s (%s reader)\n",file_name,get_log_reader_name());
+        _label_log_file();
         return log_file;
     }
     else
     {
         console_print_error("Logfile of improper format.\n");
-        close(log_file);
+        close_log_file();
         return -1;
     }
 }
@@ -156,7 +284,296 @@ void close_log_file()
         console_print_error("Tried to close() a non-opened logfile.\n");
         return;
     }
+    if(log_map != NULL)
+    {
+        munmap(log_map, log_map_size);
+        log_map = NULL;
+        log_map_size = 0;
+    }
+    if(log_compression != COMPRESSION_NONE)
+    {
+        compressed_log_close();
+        log_compression = COMPRESSION_NONE;
+    }
     close(log_file);
+    log_file = -1;
+}
+
+
+
+//******************************************************************************
+// Name:    detach_log_file
+// Notes:   Hands the open log over to the caller and leaves the module looking
+//          closed, so another log can be opened.  Compressed logs keep a
+//          pile of state in compressed_log that nobody has asked to juggle
+//          yet, so those stay put and this returns NULL.
+//
+//******************************************************************************
+log_context *detach_log_file(void)
+{
+    log_context *context;
+
+    if(log_file == -1 || log_compression != COMPRESSION_NONE)
+    {
+        return NULL;
+    }
+    context = malloc(sizeof(log_context));
+    if(context == NULL)
+    {
+        return NULL;
+    }
+
+    context->log_file = log_file;
+    context->log_file_stat = log_file_stat;
+    context->file_end_offset = file_end_offset;
+    context->probe_window = probe_window;
+    context->probe_alignment = probe_alignment;
+    context->log_map = log_map;
+    context->log_map_size = log_map_size;
+
+    log_file = -1;
+    log_map = NULL;
+    log_map_size = 0;
+    read_start_offset = 0;
+    read_end_offset = 0;
+    return context;
+}
+
+
+
+//******************************************************************************
+// Name:    attach_log_file
+// Notes:   The other half of detach_log_file, the context is freed.  The
+//          start day lives in parse_time, so set it again from the first
+//          line (which the mapping or page cache has handy anyway).
+//
+//******************************************************************************
+int attach_log_file(log_context *context)
+{
+    if(context == NULL || log_file != -1)
+    {
+        return -1;
+    }
+
+    log_file = context->log_file;
+    log_file_stat = context->log_file_stat;
+    file_end_offset = context->file_end_offset;
+    probe_window = context->probe_window;
+    probe_alignment = context->probe_alignment;
+    log_map = context->log_map;
+    log_map_size = context->log_map_size;
+    free(context);
+
+    read_start_offset = 0;
+    read_end_offset = 0;
+    if(!_start_log_times())
+    {
+        close_log_file();
+        return -1;
+    }
+    _label_log_file();
+    return log_file;
+}
+
+
+
+//******************************************************************************
+// Name:    refresh_log_file
+// Notes:   Picks up whatever got appended to an attached log since it was
+//          opened, remapping it if need be.  The map gets the same treatment
+//          as one loaded from a file saved when the log was shorter: the old
+//          last second may carry on, and both the new end and the old one
+//          get probed.  Returns -1 if the log shrank (truncated, copytruncate
+//          rotation) and should be opened fresh instead.
+//
+//******************************************************************************
+int refresh_log_file(void)
+{
+    struct stat current_stat;
+    off_t previous_size = file_end_offset;
+
+    if(log_file == -1 || log_compression != COMPRESSION_NONE || fstat(log_file, &current_stat) != 0)
+    {
+        return -1;
+    }
+    if(current_stat.st_size < file_end_offset)
+    {
+        return -1;
+    }
+
+    log_file_stat = current_stat;
+    if(current_stat.st_size == file_end_offset)
+    {
+        return 0;
+    }
+
+    file_end_offset = current_stat.st_size;
+    read_start_offset = 0;
+    read_end_offset = 0;
+    if(log_map != NULL)
+    {
+        munmap(log_map, log_map_size);
+        log_map = NULL;
+        log_map_size = 0;
+        _map_log_file();
+    }
+
+    unconfirm_map_end();
+    set_log_file_end_offset();
+    extend_log_map(previous_size);
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    set_log_reader
+// Notes:   Picks the backend the probes read through.  This has to happen
+//          before open_log_file since that's where the file gets mapped.
+//
+//******************************************************************************
+void set_log_reader(log_reader reader)
+{
+    selected_reader = reader;
+}
+
+
+
+//******************************************************************************
+// Name:    set_probe_count
+// Notes:   --probes.  The pool itself only starts on the first round that
+//          needs it.
+//
+//******************************************************************************
+void set_probe_count(int count)
+{
+    if(count < 1)
+    {
+        count = 1;
+    }
+    if(count > PROBE_MAX_COUNT)
+    {
+        count = PROBE_MAX_COUNT;
+    }
+    probe_count = count;
+}
+
+
+
+//******************************************************************************
+// Name:    set_log_io_engine
+// Notes:   The ring gets set up right here so we know straight away whether
+//          it's going to work.
+//
+//******************************************************************************
+log_io_engine set_log_io_engine(log_io_engine engine)
+{
+    if(engine == LOG_IO_URING && !uring_io_init())
+    {
+        console_print_info("io_uring isn't available here, using blocking I/O.\n");
+        engine = LOG_IO_SYNC;
+    }
+    io_engine = engine;
+    set_output_io_uring(engine == LOG_IO_URING);
+    return engine;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_reader_name
+// Notes:   Printable name of the backend actually in use, which may not be
+//          the one asked for if the mapping failed.
+//
+//******************************************************************************
+const char *get_log_reader_name(void)
+{
+    if(log_compression != COMPRESSION_NONE)
+    {
+        return compressed_log_name();
+    }
+    return (log_map != NULL) ? "mmap" : "read";
+}
+
+
+
+//******************************************************************************
+// Name:    is_log_file_compressed
+// Notes:   1 if reads are going through compressed_log
+//
+//******************************************************************************
+int is_log_file_compressed(void)
+{
+    return log_compression != COMPRESSION_NONE;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_file_descriptor
+// Notes:   The open log, for modules that need to do their own bulk reading.
+//
+//******************************************************************************
+int get_log_file_descriptor(void)
+{
+    return log_file;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_file_mapping
+// Notes:   The whole log when the mmap reader is in use, NULL otherwise.
+//
+//******************************************************************************
+const char *get_log_file_mapping(void)
+{
+    return log_map;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_file_size
+// Notes:   Size of the log as of open_log_file.  Decompressed size for
+//          compressed logs.
+//
+//******************************************************************************
+off_t get_log_file_size(void)
+{
+    return file_end_offset;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_size_for_stat
+// Notes:   What get_log_file_size would say if we opened this file.  For a
+//          compressed log that comes out of its saved checkpoint index, -1 if
+//          there isn't one yet.
+//
+//******************************************************************************
+off_t get_log_size_for_stat(const struct stat *file_stat)
+{
+    off_t size = compressed_log_peek_size(file_stat);
+    return (size >= 0) ? size : file_stat->st_size;
+}
+
+
+
+//******************************************************************************
+// Name:    read_log_file
+// Notes:   pread() for modules doing their own bulk reading, decompressing
+//          if need be.
+//
+//******************************************************************************
+ssize_t read_log_file(char *buffer, size_t size, off_t offset)
+{
+    if(log_compression != COMPRESSION_NONE)
+    {
+        return compressed_log_read(buffer, size, offset);
+    }
+    return pread(log_file, buffer, size, offset);
 }
 
 
@@ -168,7 +585,7 @@ void close_log_file()
 //          functions, but that was not needed
 //
 //******************************************************************************
-static int _start_offset_found(int time)
+static int _start_offset_found(epoch_time time)
 {
     return (_get_confirmed_start_offset(time) != -1);
 }
@@ -186,10 +603,27 @@ static int _start_offset_found(int time)
 //          amount of information
 //
 //******************************************************************************
-off_t find_time_start_offset(int time)
+off_t find_time_start_offset(epoch_time time)
 {
     off_t target_offset;
     map_item *a, *b;
+    map_item last_a, last_b;
+    char time_text[3][LOG_TIME_TEXT_SIZE];
+    int have_last = 0;
+    int rounds = 0;
+    int stamped_lines;
+    int bisect;
+    int stuck;
+    off_t found;
+
+    memset(&last_a, 0, sizeof(last_a));
+    memset(&last_b, 0, sizeof(last_b));
+    stats_add(STAT_SEARCHES, 1);
+    note_map_query(time);
+    if(console_explain_enabled())
+    {
+        console_print_explain("Looking for the first line at or after %s.\n",format_log_time(time, time_text[0]));
+    }
 
     while(!_start_offset_found(time))
     {
@@ -199,6 +633,7 @@ off_t find_time_start_offset(int time)
             b=find_next_map_item(time);
             if(b==NULL)
             {
+                console_print_explain("Nothing at or after that in the log.\n");
                 return -1;
             }
         }
@@ -208,6 +643,7 @@ off_t find_time_start_offset(int time)
             a = find_next_map_item(time);
             if(a->starting_offset == 0 && a->starting_offset_confirmed == 1)
             {
+                console_print_explain("The log starts after that, so it's the first line.\n");
                 return (off_t)0;
             }
             else
@@ -215,15 +651,45 @@ off_t find_time_start_offset(int time)
                 return -1;
             }
         }
-        console_print_debug("Searching For %d With Bound Times: %d - %d\n",time,a->time,b->time);
+        console_print_debug("Searching For %lld With Bound Times: %lld - %lld\n",(long long int)time,(long long int)a->time,(long long int)b->time);
+
+        //the last probe didn't move the bracket at all, so whatever is in
+        //there doesn't fit in the window, or it landed inside one packed
+        //second.  either way look wider.  otherwise size the window to the
+        //bracket.
+        stuck = (have_last && last_a.time == a->time && last_a.ending_offset == a->ending_offset &&
+                 last_a.ending_offset_confirmed == a->ending_offset_confirmed &&
+                 last_b.time == b->time && last_b.starting_offset == b->starting_offset &&
+                 last_b.starting_offset_confirmed == b->starting_offset_confirmed);
+        if(stuck || (have_last && probe_time_changes == 0))
+        {
+            if(!_grow_probe_window() && stuck)
+            {
+                console_print_error("No usable lines within %d bytes of offset %lld, giving up.\n",
+                                    PROBE_WINDOW_MAX,(long long int)a->ending_offset);
+                return -1;
+            }
+            console_print_explain("  nothing new, widening the window.\n");
+        }
+        else
+        {
+            _fit_probe_window(b->starting_offset - a->ending_offset);
+        }
+        last_a = *a;
+        last_b = *b;
+        have_last = 1;
+        probe_time_changes = 0;
+
         //this is sort of a special case since doing a straight interpolation
         //if our time is at the bounds would result in a problem (we would still
         //find the value since we center our read call around the target, thus we
         //would walk backwards through the file, but this would be O(n) for local
         //searching, that sucks, let's degrade to the O(log(n)) binary search
-        if(time == b->time)
+        bisect = (time == b->time);
+        if(bisect)
         {
             target_offset = a->ending_offset + ((b->starting_offset - a->ending_offset)/2);
+            stats_add(STAT_PROBE_BISECTIONS, 1);
         }
         else
         {
@@ -237,13 +703,172 @@ off_t find_time_start_offset(int time)
             double search_percent = (double)(time - a->time) / (double)(b->time - a->time);
 
             target_offset += search_percent * (b->starting_offset - a->ending_offset);
+            stats_add(STAT_PROBE_INTERPOLATIONS, 1);
+        }
 
+        rounds++;
+        if(console_explain_enabled())
+        {
+            console_print_explain("Round %d: bracket %s (ends at %lld) - %s (starts at %lld), %lld bytes\n",
+                                  rounds,format_log_time(a->time, time_text[1]),(long long int)a->ending_offset,
+                                  format_log_time(b->time, time_text[2]),(long long int)b->starting_offset,
+                                  (long long int)(b->starting_offset - a->ending_offset));
+            console_print_explain("  %s to offset %lld, %zu byte window%s\n",bisect ? "bisect" : "interpolate",
+                                  (long long int)target_offset,probe_window,(probe_count > 1) ? "s" : "");
         }
+
         //now go do the work!
-        parse_times_around_offset(target_offset);
+        stats_add(STAT_PROBE_ROUNDS, 1);
+        if(probe_count > 1)
+        {
+            stamped_lines = _probe_round(a->ending_offset, b->starting_offset, target_offset);
+        }
+        else
+        {
+            stamped_lines = parse_times_around_offset(target_offset);
+        }
+        stats_add(STAT_PROBE_BOUNDARIES, probe_time_changes);
+        console_print_explain("  learned %d stamped lines, %d time boundaries.\n",stamped_lines,probe_time_changes);
+    }
+
+    found = _get_confirmed_start_offset(time);
+    if(rounds == 0)
+    {
+        stats_add(STAT_MAP_HITS, 1);
+        console_print_explain("The map already had it: offset %lld.\n",(long long int)found);
+    }
+    else
+    {
+        console_print_explain("Found offset %lld after %d round%s.\n",(long long int)found,rounds,(rounds == 1) ? "" : "s");
+    }
+    return found;
+}
+
+
+
+//******************************************************************************
+// Name:    resolve_time_offsets
+// Notes:   find_time_start_offset for a batch of times, sharing the work.
+//          Each round every time that isn't settled yet gets its bracket
+//          and target worked out the same way the single search does it,
+//          targets that would read the same window get merged, and then the
+//          whole round is read (all at once with --probes or io_uring).
+//          Neighbouring times narrow each other's brackets as they go, and
+//          a few hundred times take about as many rounds (reads that have
+//          to wait on each other) as one does.
+//
+//          A time whose bracket didn't move gets the window grown for the
+//          next round, same as the single search.  Anything that still
+//          can't be settled is left for find_time_start_offset to complain
+//          about.
+//
+//******************************************************************************
+void resolve_time_offsets(const epoch_time *times, int count)
+{
+    off_t centers[PROBE_MAX_COUNT];
+    map_item *a, *b;
+    map_item *last_brackets;
+    char *pending;
+    off_t target_offset;
+    int center_count;
+    int rounds = 0;
+    int stuck;
+    int i;
+
+    last_brackets = calloc((size_t)count * 2, sizeof(map_item));
+    pending = malloc((size_t)count);
+    if(last_brackets == NULL || pending == NULL)
+    {
+        free(last_brackets);
+        free(pending);
+        return;
+    }
+    //1 is waiting for a probe, 2 had one last round, 0 is settled (or
+    //can't be)
+    memset(pending, 1, (size_t)count);
+    for(i = 0; i < count; i++)
+    {
+        note_map_query(times[i]);
+    }
+    console_print_explain("Resolving %d times together.\n",count);
+
+    for(;;)
+    {
+        center_count = 0;
+        stuck = 0;
+        for(i = 0; i < count; i++)
+        {
+            if(!pending[i])
+            {
+                continue;
+            }
+            if(_start_offset_found(times[i]))
+            {
+                pending[i] = 0;
+                continue;
+            }
+
+            //a full round goes out now and the rest wait for the next one
+            if(center_count == PROBE_MAX_COUNT)
+            {
+                pending[i] = 1;
+                continue;
+            }
+            b = find_exact_map_item(times[i]);
+            if(b == NULL)
+            {
+                b = find_next_map_item(times[i]);
+            }
+            a = find_prev_map_item(times[i]);
+            if(a == NULL || b == NULL)
+            {
+                pending[i] = 0;
+                continue;
+            }
+
+            //a probe that didn't move this bracket needs a wider window
+            if(pending[i] == 2 && memcmp(&last_brackets[i * 2], a, sizeof(map_item)) == 0 &&
+               memcmp(&last_brackets[i * 2 + 1], b, sizeof(map_item)) == 0)
+            {
+                stuck = 1;
+            }
+            last_brackets[i * 2] = *a;
+            last_brackets[i * 2 + 1] = *b;
+            pending[i] = 2;
+
+            if(times[i] == b->time)
+            {
+                target_offset = a->ending_offset + ((b->starting_offset - a->ending_offset)/2);
+                stats_add(STAT_PROBE_BISECTIONS, 1);
+            }
+            else
+            {
+                double search_percent = (double)(times[i] - a->time) / (double)(b->time - a->time);
+                target_offset = a->ending_offset + search_percent * (b->starting_offset - a->ending_offset);
+                stats_add(STAT_PROBE_INTERPOLATIONS, 1);
+            }
+            center_count = _add_probe_center(centers, center_count, target_offset);
+        }
+        if(center_count == 0)
+        {
+            break;
+        }
+        if(stuck && !_grow_probe_window())
+        {
+            //nothing more this can do, leave them to the single search
+            break;
+        }
 
+        rounds++;
+        probe_time_changes = 0;
+        stats_add(STAT_PROBE_ROUNDS, 1);
+        _read_windows(centers, center_count, probe_count > 1 || io_engine == LOG_IO_URING);
+        stats_add(STAT_PROBE_BOUNDARIES, probe_time_changes);
+        console_print_explain("Batch round %d: %d windows, %d time boundaries.\n",rounds,center_count,probe_time_changes);
     }
-    return _get_confirmed_start_offset(time);
+
+    free(last_brackets);
+    free(pending);
 }
 
 
@@ -255,24 +880,34 @@ off_t find_time_start_offset(int time)
 //          makes the code more simple.
 //
 //******************************************************************************
-off_t find_time_end_offset(int time)
+off_t find_time_end_offset(epoch_time time)
 {
     //this is bodgey, but it's correct given the algorithm
-    find_time_start_offset(time+1);
+    off_t next_start = find_time_start_offset(time+1);
+    off_t end_offset = _get_confirmed_end_offset(time);
+
+    //a map that's been thinned (see set_map_budget) can know where the next
+    //second starts without still having the one before it.  the range ends
+    //right before it all the same.
+    if(end_offset == -1 && next_start > 0)
+    {
+        end_offset = next_start - 1;
+    }
 
     //now just dump out th eend of file
-    return _get_confirmed_end_offset(time);
+    return end_offset;
 }
 
 
 
 //******************************************************************************
 // Name:    get_file_hash
-// Notes:   This will give us a mostly-unique identifier based on a few
-//          different pieces of information. First we compact all the numbers
-//          in the first line then strap on the file's modification date (and
-//          a short file extension).  Note: this allocates memory so the caller
-//          needs to be careful about freeing it.
+// Notes:   This will give us the name of the map file for the open log.  It's
+//          built from the device and inode rather than anything in the file,
+//          so the map survives the log growing and follows the file when
+//          it's rotated by renaming it.  Whether the contents still match is
+//          the map header's job (see get_file_fingerprint).  Note: this
+//          allocates memory so the caller needs to be careful about freeing it.
 //
 //******************************************************************************
 char *get_file_hash(void)
@@ -281,17 +916,60 @@ char *get_file_hash(void)
     {
         return NULL;
     }
-    char *working = read_from_offset_start(0);
+    return get_file_hash_for_stat(&log_file_stat);
+}
+
+
+
+//******************************************************************************
+// Name:    get_file_hash_for_stat
+// Notes:   Same name, but for a file we haven't opened.  Rotation sets use
+//          this to look at a file's map before deciding to open the file.
+//
+//******************************************************************************
+char *get_file_hash_for_stat(const struct stat *file_stat)
+{
+    char *hash_name = malloc(64);
+    if(hash_name == NULL)
+    {
+        return NULL;
+    }
+
+    sprintf(hash_name,".%llx-%llx.map",(unsigned long long int)file_stat->st_dev,(unsigned long long int)file_stat->st_ino);
+    console_print_debug("Logfile hashes to %s.\n",hash_name);
+    return hash_name;
+}
+
+
+
+//******************************************************************************
+// Name:    get_legacy_file_hash
+// Notes:   The name older versions of tgrep gave their maps: compact all the
+//          numbers in the first line then strap on the file's modification
+//          date.  Only used to find maps worth upgrading.
+//
+//******************************************************************************
+char *get_legacy_file_hash(void)
+{
+    if(log_file == -1)
+    {
+        return NULL;
+    }
+    char *working = read_from_offset_start(0, probe_window);
     if(working==NULL)
     {
         return NULL;
     }
-    ssize_t line_length = strcspn(working,"\n");
-    char *hash_name = malloc(64);
+    ssize_t line_length = _line_length(working, read_end_offset - read_start_offset);
     int all_numbers=0;
 
     if(line_length > 0)
     {
+        char *hash_name = malloc(64);
+        if(hash_name == NULL)
+        {
+            return NULL;
+        }
         int read_ptr=0;
         for(; read_ptr < line_length; read_ptr++)
         {
@@ -301,11 +979,65 @@ char *get_file_hash(void)
             }
         }
 
-        sprintf(hash_name,".%d%lld.map",all_numbers,(long long int)log_file_stat.st_mtime);
-        console_print_debug("Logfile hashes to %s.\n",hash_name);
-        return hash_name;
+        sprintf(hash_name,".%d%lld.map",all_numbers,(long long int)log_file_stat.st_mtime);
+        return hash_name;
+    }
+    return NULL;
+}
+
+
+
+//******************************************************************************
+// Name:    get_file_fingerprint
+// Notes:   64-bit FNV-1a over the whole first line.  This goes in the map file
+//          header so a map is only ever applied to the log it was built from.
+//          Appending to a log leaves this alone, rotating or truncating it
+//          and writing new lines changes it.
+//
+//******************************************************************************
+uint64_t get_file_fingerprint(void)
+{
+    uint64_t fingerprint = 14695981039346656037ULL;
+    char *working;
+    off_t line_length;
+    off_t i;
+
+    if(log_file == -1)
+    {
+        return 0;
+    }
+    working = read_from_offset_start(0, probe_window);
+    if(working == NULL)
+    {
+        return 0;
+    }
+
+    line_length = _line_length(working, read_end_offset - read_start_offset);
+    for(i = 0; i < line_length; i++)
+    {
+        fingerprint = (fingerprint ^ (unsigned char)working[i]) * 1099511628211ULL;
+    }
+    return fingerprint;
+}
+
+
+
+//******************************************************************************
+// Name:    extend_log_map
+// Notes:   The map we loaded was built when the log was previous_size bytes
+//          long.  Probe right at the old end so the last old second and the
+//          first new one get pinned down, the rest of the new tail fills in
+//          the usual way as searches need it.
+//
+//******************************************************************************
+void extend_log_map(off_t previous_size)
+{
+    if(log_file == -1 || previous_size >= file_end_offset)
+    {
+        return;
     }
-    return NULL;
+    console_print_info("Log grew by %lld bytes since the map was saved.\n",(long long int)(file_end_offset - previous_size));
+    parse_times_around_offset(previous_size);
 }
 
 
@@ -316,12 +1048,51 @@ char *get_file_hash(void)
 //          out of the log file.
 //
 //******************************************************************************
-static char *read_from_offset_start(off_t read_offset)
+static char *read_from_offset_start(off_t read_offset, size_t read_length)
 {
     ssize_t read_size;
+    char *buffer;
+
+    //mapped files don't need a copy at all, just point at the window
+    if(log_map != NULL)
+    {
+        if(read_offset > file_end_offset)
+        {
+            read_offset = file_end_offset;
+        }
+        read_start_offset = read_offset;
+        read_end_offset = read_offset + (off_t)read_length;
+        if(read_end_offset > file_end_offset)
+        {
+            read_end_offset = file_end_offset;
+        }
+        return log_map + read_offset;
+    }
+
+    if(read_buffer_size < read_length)
+    {
+        buffer = realloc(read_buffer, read_length);
+        if(buffer == NULL)
+        {
+            return NULL;
+        }
+        read_buffer = buffer;
+        read_buffer_size = read_length;
+    }
 
-    read_offset = lseek(log_file,read_offset,SEEK_SET);
-    read_size = read(log_file,read_buffer,READ_BUFFER_SIZE);
+    if(log_compression != COMPRESSION_NONE)
+    {
+        if(read_offset > file_end_offset)
+        {
+            read_offset = file_end_offset;
+        }
+        read_size = compressed_log_read(read_buffer, read_length, read_offset);
+    }
+    else
+    {
+        read_offset = lseek(log_file,read_offset,SEEK_SET);
+        read_size = read(log_file,read_buffer,read_length);
+    }
 
     if(read_size != (ssize_t)-1)
     {
@@ -348,16 +1119,76 @@ static char *read_from_offset_start(off_t read_offset)
 //******************************************************************************
 static char *read_from_offset_center(off_t read_offset)
 {
-    if(read_offset >= READ_OFFSET)
+    size_t length;
+    off_t start = _window_bounds(read_offset, &length);
+
+    return read_from_offset_start(start, length);
+}
+
+
+
+//******************************************************************************
+// Name:    _window_bounds
+// Notes:   The window centered on center_offset, with both ends pushed out
+//          to block boundaries, so it can be up to a block bigger than the
+//          window itself.  Never before the start of the file.
+//
+//******************************************************************************
+static off_t _window_bounds(off_t center_offset, size_t *length)
+{
+    off_t start = center_offset - (off_t)(probe_window / 2);
+    off_t end = center_offset + (off_t)(probe_window / 2);
+
+    if(start < 0)
     {
-        read_offset -= (off_t)READ_OFFSET;
+        start = 0;
     }
-    else
+    start -= start % (off_t)probe_alignment;
+    end += (off_t)probe_alignment - 1;
+    end -= end % (off_t)probe_alignment;
+    *length = (size_t)(end - start);
+    return start;
+}
+
+
+
+//******************************************************************************
+// Name:    _grow_probe_window
+// Notes:   Doubles the window, returns 0 if it's already as big as it goes
+//
+//******************************************************************************
+static int _grow_probe_window(void)
+{
+    if(probe_window >= PROBE_WINDOW_MAX)
     {
-        read_offset = (off_t) 0;
+        return 0;
     }
+    probe_window *= 2;
+    stats_add(STAT_PROBE_WINDOW_GROWS, 1);
+    console_print_debug("Probe window grown to %zu bytes.\n",probe_window);
+    return 1;
+}
+
 
-    return read_from_offset_start(read_offset);
+
+//******************************************************************************
+// Name:    _fit_probe_window
+// Notes:   A window centered in the bracket only has to be about twice as
+//          wide as the bracket to see both edges of it.  Anything bigger is
+//          just bytes we don't need, so halve it back down (never below a
+//          block).
+//
+//******************************************************************************
+static void _fit_probe_window(off_t bracket_size)
+{
+    if(bracket_size < 0)
+    {
+        bracket_size = 0;
+    }
+    while(probe_window / 2 >= probe_alignment && (off_t)(probe_window / 2) >= bracket_size * 2)
+    {
+        probe_window /= 2;
+    }
 }
 
 
@@ -367,105 +1198,271 @@ static char *read_from_offset_center(off_t read_offset)
 // Notes:   This fuction sucks out all the information from a dumped readbuffer
 //          and puts it into a usable format in the map files.  It's responsible
 //          for pushing around start and end offsets for specific log times
-//          while confirming their start/end points.
+//          while confirming their start/end points.  Returns how many stamped
+//          lines it saw.
 //
 //******************************************************************************
-static void parse_times_around_offset(off_t read_offset)
+static int parse_times_around_offset(off_t read_offset)
 {
     char *working = read_from_offset_center(read_offset);
-    char *start = working;
-    map_item *current_map_item = NULL;
-    map_item *last_map_item = NULL;
 
-    int current_time;
-    off_t read_ptr = 0;
     //blarg
     if(working==NULL)
     {
-        return;
+        return 0;
     }
 
+    stats_add(STAT_PROBE_READS, 1);
+    stats_add(STAT_PROBE_BYTES, read_end_offset - read_start_offset);
+    return _parse_window(working, read_start_offset, (size_t)(read_end_offset - read_start_offset));
+}
+
+
+
+//******************************************************************************
+// Name:    _parse_window
+// Notes:   The parsing half of the above, for a window of the log that starts
+//          at window_start.  Split out so windows that were read some other
+//          way (all at once by the probe pool) go through the same code.
+//
+//******************************************************************************
+static int _parse_window(const char *working, off_t window_start, size_t window_length)
+{
+    int stamped_lines = 0;
+    map_item *current_map_item = NULL;
+    map_item *last_map_item = NULL;
+    scanned_line lines[LINE_SCAN_BATCH];
+    size_t position = 0;
+    size_t consumed;
+    off_t line_start;
+    off_t line_end;
+    int line_count;
+    epoch_time current_time;
+    int i;
+
+    //nobody is holding map items between probes, so this is the spot to
+    //fold new ones into the sorted part of the map
+    merge_map_items(0);
+
     //we want to squeeze every drop of blood we can from this buffer so we'll
-    //run her right up to the end if we can.
-    while(read_ptr < (read_end_offset - read_start_offset))
+    //run her right up to the end if we can.  line_scan splits it up and
+    //checks the stamps a batch of lines at a time.
+    while(position < window_length)
     {
+        line_count = scan_log_lines(working + position, window_length - position, lines, LINE_SCAN_BATCH, &consumed);
+        if(line_count == 0)
+        {
+            break;
+        }
 
-        //verify that our log line is a real time
-        if(is_valid_log_time(working))
+        for(i = 0; i < line_count; i++)
         {
-            //grab the time on that log line
-            if(parse_log_time(working,&current_time))
+            //no stamp, nothing to learn from this line
+            if(lines[i].time == EPOCH_TIME_NONE)
+            {
+                continue;
+            }
+            current_time = refine_log_time(lines[i].time, working + position + lines[i].start, lines[i].length);
+            if(current_time == EPOCH_TIME_NONE)
             {
+                continue;
+            }
 
-                //hunt down the current item
-                //This looks goofy since I have a "find_exact" function
-                //available.  However, create new map item returns an existing one
-                //and creates a new one automagically if it doens't have it.
-                //perhaps a new name is in order.
-                current_map_item = create_new_map_item(current_time);
+            stamped_lines++;
 
-                //try to update the start by moving it LOWER
-                if((current_map_item->starting_offset > read_ptr + read_start_offset || current_map_item->starting_offset == -1) && read_ptr != -1)
-                {
-                    current_map_item->starting_offset = read_ptr+read_start_offset;
-                    if(current_map_item->starting_offset == 0)
-                    {
-                        current_map_item->starting_offset_confirmed = 1;
-                    }
-                }
+            //the end of a line is its newline, or the end of the window if
+            //it runs off it
+            line_start = window_start + (off_t)(position + lines[i].start);
+            line_end = line_start + (off_t)lines[i].length;
 
-                //find the end of line
-                read_ptr += strcspn(working,"\n");
+            //hunt down the current item
+            //This looks goofy since I have a "find_exact" function
+            //available.  However, create new map item returns an existing one
+            //and creates a new one automagically if it doens't have it.
+            //perhaps a new name is in order.
+            current_map_item = create_new_map_item(current_time);
 
-                //clamp the end of line if it's larger than our buffer
-                if(read_ptr > (read_end_offset - read_start_offset))
+            //try to update the start by moving it LOWER
+            if(current_map_item->starting_offset > line_start || current_map_item->starting_offset == -1)
+            {
+                current_map_item->starting_offset = line_start;
+                if(current_map_item->starting_offset == 0)
                 {
-                    read_ptr = read_end_offset - read_start_offset;
+                    current_map_item->starting_offset_confirmed = 1;
                 }
+            }
 
-                //update the current end of line.
-                if(current_map_item->ending_offset < read_ptr + read_start_offset)
-                {
-                    current_map_item->ending_offset = read_ptr + read_start_offset;
+            //update the current end of line.
+            if(current_map_item->ending_offset < line_end)
+            {
+                current_map_item->ending_offset = line_end;
 
-                    //-1 to account for the eof char
-                    if(current_map_item->ending_offset == (file_end_offset - 1))
-                    {
-                        current_map_item->ending_offset_confirmed = 1;
-                    }
+                //-1 to account for the eof char
+                if(current_map_item->ending_offset == (file_end_offset - 1))
+                {
+                    current_map_item->ending_offset_confirmed = 1;
                 }
+            }
 
-                //did we process more than one already?
-                if(last_map_item != NULL)
+            //did we process more than one already?
+            if(last_map_item != NULL)
+            {
+                //if the time between 2 consecutive map entries are different
+                //we've found a boundry, update our confirmed limits.
+                if(last_map_item->time != current_map_item->time)
                 {
-                    //if the time between 2 consecutive map entries are different
-                    //we've found a boundry, update our confirmed limits.
-                    if(last_map_item->time != current_map_item->time)
-                    {
-                        last_map_item->ending_offset_confirmed = 1;
-                        current_map_item->starting_offset_confirmed = 1;
-                    }
+                    probe_time_changes++;
+                    last_map_item->ending_offset_confirmed = 1;
+                    current_map_item->starting_offset_confirmed = 1;
                 }
+            }
 
-                //update the last item
-                last_map_item = current_map_item;
+            //update the last item
+            last_map_item = current_map_item;
+        }
+        position += consumed;
+    }
+    return stamped_lines;
+}
 
-            }
+
+
+//******************************************************************************
+// Name:    _probe_round
+// Notes:   One round of the search with several reads in flight.  Besides the
+//          interpolated target we read evenly spaced points across the
+//          bracket, so even when the interpolation is way off the bracket
+//          still shrinks by a factor of probe_count.  Everything read goes
+//          into the map before the next bracket gets picked.  Returns how
+//          many stamped lines the windows had between them.
+//
+//******************************************************************************
+static int _probe_round(off_t low_offset, off_t high_offset, off_t target_offset)
+{
+    off_t centers[PROBE_MAX_COUNT];
+    int count = 0;
+    int i;
+
+    centers[count++] = target_offset;
+    for(i = 1; i < probe_count; i++)
+    {
+        count = _add_probe_center(centers, count, low_offset + ((high_offset - low_offset) / probe_count) * i);
+    }
+
+    console_print_debug("Probing %d windows between %lld and %lld.\n",count,(long long int)low_offset,(long long int)high_offset);
+    return _read_windows(centers, count, 1);
+}
+
+
+
+//******************************************************************************
+// Name:    _add_probe_center
+// Notes:   Adds a window center unless it's mostly a window we're already
+//          reading.  Returns the new count.
+//
+//******************************************************************************
+static int _add_probe_center(off_t *centers, int count, off_t center)
+{
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        if(centers[i] - center < (off_t)(probe_window / 2) && center - centers[i] < (off_t)(probe_window / 2))
+        {
+            return count;
         }
-        else
+    }
+    centers[count] = center;
+    return count + 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _read_windows
+// Notes:   Reads and parses a window around each center, at most
+//          PROBE_MAX_COUNT of them.  With batch they go out together
+//          (io_uring or the probe pool), otherwise one at a time.  Returns how many stamped lines they had between them.
+//
+//******************************************************************************
+static int _read_windows(off_t *centers, int count, int batch)
+{
+    probe_read reads[PROBE_MAX_COUNT];
+    size_t slot_size = probe_window + probe_alignment;
+    int stamped_lines = 0;
+    off_t center;
+    off_t start;
+    char *buffers;
+    int i, j;
+
+    //send them out in file order, it's kinder to the disk
+    for(i = 1; i < count; i++)
+    {
+        center = centers[i];
+        for(j = i; j > 0 && centers[j - 1] > center; j--)
         {
-            //find the end of line
-            read_ptr += strcspn(working,"\n");
+            centers[j] = centers[j - 1];
+        }
+        centers[j] = center;
+    }
 
-            //clamp the end of line if it's larger than our buffer
-            if(read_ptr > (read_end_offset - read_start_offset))
-            {
-                read_ptr = read_end_offset - read_start_offset;
-            }
+    if(!batch || count == 1)
+    {
+        for(i = 0; i < count; i++)
+        {
+            stamped_lines += parse_times_around_offset(centers[i]);
+        }
+        return stamped_lines;
+    }
+
+    if(probe_buffers_size < (size_t)count * slot_size)
+    {
+        buffers = realloc(probe_buffers, (size_t)count * slot_size);
+        if(buffers == NULL)
+        {
+            console_print_debug("Could not allocate probe buffers, probing one at a time.\n");
+            probe_count = 1;
+            return _read_windows(centers, count, 0);
+        }
+        probe_buffers = buffers;
+        probe_buffers_size = (size_t)count * slot_size;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        start = _window_bounds(centers[i], &reads[i].size);
+        if(start > file_end_offset)
+        {
+            start = file_end_offset;
+        }
+        reads[i].offset = start;
+        if(file_end_offset - start < (off_t)reads[i].size)
+        {
+            reads[i].size = (size_t)(file_end_offset - start);
+        }
+        reads[i].buffer = probe_buffers + (size_t)i * slot_size;
+        reads[i].result = 0;
+    }
+
+    //compressed logs have to go through compressed_log_read, the ring can
+    //only do the raw file
+    if(io_engine != LOG_IO_URING || log_compression != COMPRESSION_NONE ||
+       uring_io_read_batch(log_file, reads, count) < 0)
+    {
+        probe_pool_start(probe_count);
+        probe_pool_read(reads, count);
+    }
+    stats_add(STAT_PROBE_READS, count);
+
+    for(i = 0; i < count; i++)
+    {
+        stats_add(STAT_PROBE_BYTES, (reads[i].result > 0) ? reads[i].result : 0);
+        if(reads[i].result > 0)
+        {
+            stamped_lines += _parse_window(reads[i].buffer, reads[i].offset, (size_t)reads[i].result);
         }
-        read_ptr++;
-        working = start + read_ptr;
     }
+    return stamped_lines;
 }
 
 
@@ -478,7 +1475,7 @@ static void parse_times_around_offset(off_t read_offset)
 //          this function and I were in prison together, I'd shiv someone for it
 //
 //******************************************************************************
-static off_t _get_confirmed_start_offset(int time)
+static off_t _get_confirmed_start_offset(epoch_time time)
 {
     map_item *target = find_exact_map_item(time);
 
@@ -541,7 +1538,7 @@ static off_t _get_confirmed_start_offset(int time)
 //          applies
 //
 //******************************************************************************
-static off_t _get_confirmed_end_offset(int time)
+static off_t _get_confirmed_end_offset(epoch_time time)
 {
     map_item *target = find_exact_map_item(time);
 
@@ -608,7 +1605,10 @@ static off_t _get_confirmed_end_offset(int time)
 //******************************************************************************
 off_t set_log_file_start_offset(void)
 {
-    parse_times_around_offset(0);
+    //a first line longer than the window shows up as nothing at all
+    while(parse_times_around_offset(0) == 0 && _grow_probe_window())
+    {
+    }
     return 0;
 }
 
@@ -618,13 +1618,16 @@ off_t set_log_file_start_offset(void)
 //******************************************************************************
 // Name:    set_log_file_end_offset
 // Notes:   Same as the start offset finder, but (you guessed it!) for the end
-//          of the file.
+//          of the file.  The end is the size we saw at open, which for a
+//          compressed log has nothing to do with where lseek ends up.
 //
 //******************************************************************************
 off_t set_log_file_end_offset(void)
 {
-    off_t end = lseek(log_file,0,SEEK_END);
-    parse_times_around_offset(end);
+    off_t end = file_end_offset;
+    while(parse_times_around_offset(end) == 0 && _grow_probe_window())
+    {
+    }
     return 0;
 }
 
@@ -632,13 +1635,14 @@ off_t set_log_file_end_offset(void)
 
 //******************************************************************************
 // Name:    dump_file_range
-// Notes:   this actually dumps the desired range to stdout.
+// Notes:   this actually dumps the desired range to stdout.  The copy itself
+//          is handed to the range_output module so the kernel can move the
+//          bytes without us touching them whenever stdout allows it.
 //
 //******************************************************************************
 void dump_file_range(off_t dump_start_offset, off_t dump_end_offset)
 {
-    off_t temp;
-    size_t dump_size; //heh
+    off_t dumped;
 
     //protect us from goofy cases
     if(dump_start_offset == -1 || dump_end_offset == -1 || dump_end_offset < dump_start_offset)
@@ -646,34 +1650,214 @@ void dump_file_range(off_t dump_start_offset, off_t dump_end_offset)
         return ;
     }
 
-    //git'r'done
-    temp = lseek(log_file,dump_start_offset,SEEK_SET);
+    //git'r'done.  anything sitting in stdio has to go out before the kernel
+    //starts writing behind its back.
     console_print_info("Printing output %lld - %lld.\n",dump_start_offset, dump_end_offset);
-    while(temp < dump_end_offset)
+    stats_timer_start(STAT_TIMER_OUTPUT);
+    fflush(stdout);
+
+    //the search is done with this stretch of the file, tell the kernel we're
+    //about to walk straight through it and put it back to random afterwards
+    //in case there's another search coming.
+    _advise_log_map(dump_start_offset, dump_end_offset, MADV_SEQUENTIAL);
+    if(log_compression == COMPRESSION_NONE)
     {
-        //make sure we only read as far as we need to.
-        if(dump_end_offset - temp > READ_BUFFER_SIZE)
-        {
-            dump_size = (size_t)READ_BUFFER_SIZE;
-        }
-        else
-        {
-            dump_size = (size_t)(dump_end_offset - temp);
-        }
-        dump_size = read(log_file, read_buffer, dump_size);
+        posix_fadvise(log_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    if(filter_enabled())
+    {
+        dumped = filter_range(log_map, read_log_file, dump_start_offset, dump_end_offset, fileno(stdout));
+    }
+    else if(log_compression != COMPRESSION_NONE)
+    {
+        dumped = output_reader_range(read_log_file, dump_start_offset, dump_end_offset, fileno(stdout));
+    }
+    else
+    {
+        dumped = output_file_range(log_file, log_map, dump_start_offset, dump_end_offset, fileno(stdout));
+    }
+    _advise_log_map(dump_start_offset, dump_end_offset, MADV_RANDOM);
+    if(log_compression == COMPRESSION_NONE)
+    {
+        posix_fadvise(log_file, 0, 0, POSIX_FADV_RANDOM);
+    }
 
-        fwrite(read_buffer, 1, dump_size, stdout);
-        temp += (off_t)dump_size;
+    stats_add(STAT_OUTPUT_RANGES, 1);
+    stats_add(STAT_OUTPUT_BYTES, (dumped > 0) ? dumped : 0);
+    if(filter_enabled())
+    {
+        //every matching line comes with its own newline
+        stats_set_label(STAT_LABEL_OUTPUT_METHOD, "filter");
+        stats_timer_stop(STAT_TIMER_OUTPUT);
+        return;
     }
+    stats_set_label(STAT_LABEL_OUTPUT_METHOD, get_output_method_name(get_output_method()));
+
     fwrite("\n",1,1,stdout);
     fflush(stdout);
+    stats_timer_stop(STAT_TIMER_OUTPUT);
+}
+
+
+
+//******************************************************************************
+// Name:    prefetch_log_range
+// Notes:   WILLNEED starts the reads and returns straight away, so the disk is
+//          busy with the front of the range while we're still probing for
+//          the back of it.  Compressed logs are skipped, the offsets are into
+//          the decompressed data and mean nothing to the page cache.
+//
+//******************************************************************************
+void prefetch_log_range(off_t start_offset, off_t end_offset)
+{
+    off_t length;
+
+    if(log_file == -1 || log_compression != COMPRESSION_NONE || start_offset < 0)
+    {
+        return;
+    }
+
+    if(end_offset < 0)
+    {
+        end_offset = start_offset + PREFETCH_FIRST_WINDOW;
+    }
+    if(end_offset > file_end_offset)
+    {
+        end_offset = file_end_offset;
+    }
+    length = end_offset - start_offset;
+    if(length > PREFETCH_MAX_RANGE)
+    {
+        length = PREFETCH_MAX_RANGE;
+    }
+    if(length <= 0)
+    {
+        return;
+    }
+
+    console_print_debug("Prefetching %lld bytes at %lld.\n",(long long int)length,(long long int)start_offset);
+    if(posix_fadvise(log_file, start_offset, length, POSIX_FADV_WILLNEED) == 0)
+    {
+        stats_add(STAT_PREFETCH_BYTES, length);
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _line_length
+// Notes:   strcspn(working,"\n") that knows where the window stops.  Neither
+//          the read buffer nor the mapping is NUL terminated, so running
+//          off the end hunting for a newline isn't an option.
+//
+//******************************************************************************
+static off_t _line_length(const char *working, off_t remaining)
+{
+    const char *eol;
+
+    if(remaining <= 0)
+    {
+        return 0;
+    }
+    eol = memchr(working, '\n', (size_t)remaining);
+    if(eol == NULL)
+    {
+        return remaining;
+    }
+    return (off_t)(eol - working);
+}
+
+
+
+//******************************************************************************
+// Name:    _map_log_file
+// Notes:   Maps the whole log read-only.  Searching jumps all over the place,
+//          so start out telling the kernel not to bother reading ahead.  If
+//          the map fails for any reason we just stay on the read() path.
+//
+//******************************************************************************
+static void _map_log_file(void)
+{
+    void *mapping;
+
+    if(file_end_offset <= 0)
+    {
+        return;
+    }
 
+    mapping = mmap(NULL, (size_t)file_end_offset, PROT_READ, MAP_SHARED, log_file, 0);
+    if(mapping == MAP_FAILED)
+    {
+        console_print_debug("mmap failed, using the read() backend.\n");
+        return;
+    }
+
+    log_map = mapping;
+    log_map_size = (size_t)file_end_offset;
+    madvise(log_map, log_map_size, MADV_RANDOM);
+    console_print_debug("Mapped %lld bytes of log file.\n",(long long int)file_end_offset);
 }
 
 
 
+//******************************************************************************
+// Name:    _advise_log_map
+// Notes:   madvise wants page aligned addresses, so round the start down.
+//
+//******************************************************************************
+static void _advise_log_map(off_t start_offset, off_t end_offset, int advice)
+{
+    off_t page_size = (off_t)sysconf(_SC_PAGESIZE);
+    off_t aligned_start;
+
+    if(log_map == NULL || end_offset <= start_offset)
+    {
+        return;
+    }
+
+    aligned_start = start_offset - (start_offset % page_size);
+    if(end_offset > (off_t)log_map_size)
+    {
+        end_offset = (off_t)log_map_size;
+    }
+    madvise(log_map + aligned_start, (size_t)(end_offset - aligned_start), advice);
+}
+
+
 
+//******************************************************************************
+// Name:    _label_log_file
+// Notes:   The --stats labels describing how this log gets read
+//
+//******************************************************************************
+static void _label_log_file(void)
+{
+    stats_set_label(STAT_LABEL_READER, get_log_reader_name());
+    stats_set_label(STAT_LABEL_LINE_SCAN, get_line_scan_isa_name(get_line_scan_isa()));
+    stats_set_label(STAT_LABEL_IO_ENGINE, (io_engine == LOG_IO_URING) ? "io_uring" : "sync");
+    stats_set_label(STAT_LABEL_LOG_FORMAT, get_log_format_name(get_log_format()));
+}
 
 
 
+//******************************************************************************
+// Name:    _start_log_times
+// Notes:   Everything about reading stamps comes from the first window of
+//          the log, see start_log_format
+//
+//******************************************************************************
+static int _start_log_times(void)
+{
+    char *working = read_from_offset_start(0, probe_window);
 
+    if(working == NULL)
+    {
+        return 0;
+    }
+    if(!start_log_format(working, (size_t)(read_end_offset - read_start_offset), log_file_stat.st_mtime))
+    {
+        return 0;
+    }
+    console_print_debug("Log stamps are %s.\n",get_log_format_name(get_log_format()));
+    return 1;
+}
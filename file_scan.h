@@ -28,16 +28,89 @@
 #ifndef __TGREP_FILE_SCAN_H__
 #define __TGREP_FILE_SCAN_H__
 
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "parse_time.h"
+
 //keep all file reading stuff in this module
 int open_log_file(char *file_name);
 void close_log_file();
 
+//the daemon keeps logs open between queries.  detach hands the open log
+//over and leaves the module as if it had been closed, attach puts it back
+//(and frees the context).  compressed logs can't be detached, that gives
+//NULL and the log stays open.  refresh picks up anything appended since,
+//it returns -1 if the log shrank and needs opening from scratch.
+typedef struct _log_context log_context;
+
+log_context *detach_log_file(void);
+int attach_log_file(log_context *context);
+int refresh_log_file(void);
+
+//probes can either read() into a buffer or look straight into an mmap of the
+//whole file.  mmap is the default, read is kept around so the two can be
+//compared on different storage.  must be set before open_log_file.
+typedef enum
+{
+    LOG_READER_MMAP = 0,
+    LOG_READER_READ
+} log_reader;
+
+void set_log_reader(log_reader reader);
+const char *get_log_reader_name(void);
+
+//how many windows each round of the search reads at once (--probes).  1, the
+//default, is the old one read per round search.  more than that trades a few
+//extra reads for fewer round trips to the disk.
+void set_probe_count(int count);
+
+//the blocking calls, or io_uring for the probe batches and dumping ranges
+//out (--io).  if io_uring isn't available this quietly stays on sync, the
+//engine actually in use is what comes back.
+typedef enum
+{
+    LOG_IO_SYNC = 0,
+    LOG_IO_URING
+} log_io_engine;
+
+log_io_engine set_log_io_engine(log_io_engine engine);
+
+//raw access for modules that scan big stretches of the file themselves.  the
+//mapping is NULL unless the mmap reader is in use.
+int get_log_file_descriptor(void);
+const char *get_log_file_mapping(void);
+off_t get_log_file_size(void);
+
+//1 for gzip/zstd logs, whose descriptor holds the compressed bytes
+int is_log_file_compressed(void);
+
+//pread() for those modules.  offsets (and sizes) are always into the
+//decompressed log, so compressed logs look like any other.
+ssize_t read_log_file(char *buffer, size_t size, off_t offset);
+
+//the size the log would have once opened, for deciding whether a saved map
+//is still current without opening the file
+off_t get_log_size_for_stat(const struct stat *file_stat);
+
 
 //these will have a little bit of application knowledge in them so that
 //they can start at the next highest point if a start time is missing and end at 
 //the next prior time if the end is missing
-off_t find_time_start_offset(int time);
-off_t find_time_end_offset(int time);
+off_t find_time_start_offset(epoch_time time);
+off_t find_time_end_offset(epoch_time time);
+
+//probes for a whole list of times at once, each round reading one
+//window per unsettled time, so every probe lands in the map for all the
+//times it brackets.  the find_time_* calls for those times afterwards are
+//answered from the map.
+void resolve_time_offsets(const epoch_time *times, int count);
+
+//tells the kernel which stretch of the log is about to be dumped so it can
+//start reading it in.  pass -1 for end_offset when only the start is known
+//yet and just the first part of the range gets asked for.
+void prefetch_log_range(off_t start_offset, off_t end_offset);
 
 
 //The start one is for verbosity, but the end one sets the internal limits of 
@@ -46,10 +119,22 @@ off_t find_time_end_offset(int time);
 off_t set_log_file_start_offset(void);
 off_t set_log_file_end_offset(void);
 
-//this will give us our unique identifier for this file based on it's first line
-//so we can figure out if we have a pre-generated map for it  note, this will 
+//this will give us our unique identifier for this file (device and inode) so we
+//can figure out if we have a pre-generated map for it  note, this will 
 //malloc everytime, so the caller needs to be sure to free old values returned.
 char *get_file_hash(void);
+char *get_file_hash_for_stat(const struct stat *file_stat);
+
+//the first-line-and-mtime name maps used to be saved under, same malloc rules
+char *get_legacy_file_hash(void);
+
+//identifies the contents (the first line) and gets stored inside the map
+//itself, so a rotated or truncated file never picks up a stale map
+uint64_t get_file_fingerprint(void);
+
+//the loaded map only covers the first previous_size bytes of the log, pick
+//up where it left off
+void extend_log_map(off_t previous_size);
 
 
 //provide a nice "dump" function to print everything out and keep track of all the 
@@ -0,0 +1,587 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    follow_log.c
+// Notes:   -f, tail -f for a time window.  The normal search finds where the
+//          window starts and the existing part goes out the usual way, then
+//          we sit on inotify and print whatever gets appended.  Only
+//          complete lines ever go out, a half written last line waits for
+//          its newline.  Times only get looked at while waiting for the
+//          window to open or when it has an end, otherwise new lines just
+//          get copied.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "follow_log.h"
+#include "file_scan.h"
+#include "map_file.h"
+#include "parse_time.h"
+#include "log_format.h"
+#include "range_output.h"
+#include "line_filter.h"
+#include "console_output.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//new data gets read this much at a time, more if a single line won't fit
+#define FOLLOW_BUFFER_SIZE      (1024*1024)
+#define FOLLOW_BUFFER_MAX       (64*1024*1024)
+
+//how far back from the end to look for the last newline at a time
+#define FOLLOW_TAIL_READ        (64*1024)
+
+//inotify doesn't fire on every filesystem (NFS...), so look anyway now and
+//then
+#define FOLLOW_POLL_MS          (1000)
+
+#define FOLLOW_FILE_EVENTS      (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#define FOLLOW_DIR_EVENTS       (IN_CREATE | IN_MOVED_TO)
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+
+//our own descriptor for the log, and the name to look for a new one under
+//after a rotation
+static char *follow_path = NULL;
+static int follow_fd = -1;
+
+//the next byte that hasn't been looked at
+static off_t follow_offset = 0;
+
+//the window, in the same time base as the map.  nothing prints until a line
+//at or after follow_start turns up (unless the window was already open),
+//and the first line past follow_end (-1 for none) ends it.
+static epoch_time follow_start = 0;
+static epoch_time follow_end = -1;
+static int window_open = 0;
+
+static char *buffer = NULL;
+static size_t buffer_size = 0;
+
+static int notify_fd = -1;
+static int file_watch = -1;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static off_t _last_line_end(off_t size);
+static int _follow_step(void);
+static int _scan_lines(const char *data, size_t length, size_t *emit_start, size_t *emit_end);
+static void _emit(const char *data, off_t start_offset, off_t end_offset);
+static ssize_t _follow_read(char *read_buffer, size_t size, off_t offset);
+static int _check_rotation(void);
+static void _watch_log(void);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    follow_log_start
+// Notes:   The end of the log is "now", so a window without a date goes on
+//          whichever day puts it closest to that: a range that's still
+//          going if there is one, otherwise the nearest start, whether that
+//          was a little while ago or is coming up shortly.  If the window
+//          already closed before the end of the log this is just a search,
+//          otherwise the log gets dumped from the start of the window
+//          through the last complete line and following takes it from there.
+//
+//******************************************************************************
+int follow_log_start(const char *path, epoch_time search_start_time, epoch_time search_end_time, int dated)
+{
+    epoch_time file_start_time = get_log_start_time();
+    epoch_time file_end_time = get_log_end_time();
+    off_t start_offset = -1;
+    off_t tail;
+    epoch_time duration = -1;
+    epoch_time candidate;
+    epoch_time distance;
+    epoch_time best_distance = -1;
+    char time_text[LOG_TIME_TEXT_SIZE];
+    int i;
+
+    if(is_log_file_compressed())
+    {
+        console_print_error("Can't follow a compressed log: %s\n",path);
+        return -1;
+    }
+
+    if(dated)
+    {
+        follow_start = search_start_time;
+        follow_end = search_end_time;
+    }
+    else
+    {
+        if(search_end_time >= 0)
+        {
+            duration = search_end_time - search_start_time;
+            while(duration < 0)
+            {
+                duration += EPOCH_TIME_PER_DAY;
+            }
+        }
+
+        //the day before the end of the log, that day or the one after
+        for(i = -1; i <= 1; i++)
+        {
+            candidate = file_end_time - (file_end_time % EPOCH_TIME_PER_DAY) + (i * EPOCH_TIME_PER_DAY) + search_start_time;
+            if(duration >= 0 && candidate <= file_end_time && candidate + duration >= file_end_time)
+            {
+                distance = 0;
+            }
+            else
+            {
+                distance = (candidate > file_end_time) ? candidate - file_end_time : file_end_time - candidate;
+            }
+            if(best_distance < 0 || distance < best_distance)
+            {
+                best_distance = distance;
+                follow_start = candidate;
+            }
+        }
+        follow_end = (duration < 0) ? -1 : follow_start + duration;
+    }
+
+    window_open = (follow_start <= file_end_time);
+    if(window_open)
+    {
+        start_offset = find_time_start_offset((follow_start > file_start_time) ? follow_start : file_start_time);
+    }
+
+    //it's all in the past, nothing to follow
+    if(follow_end >= 0 && follow_end < file_end_time)
+    {
+        console_print_info("Window closed at %s, before the end of the log.\n",format_log_time(follow_end, time_text));
+        dump_file_range(start_offset, find_time_end_offset(follow_end));
+        return 0;
+    }
+
+    tail = _last_line_end(get_log_file_size());
+    if(window_open && start_offset >= 0 && tail > start_offset)
+    {
+        dump_file_range(start_offset, tail - 1);
+    }
+    fflush(stdout);
+
+    free(follow_path);
+    follow_path = strdup(path);
+    follow_fd = fcntl(get_log_file_descriptor(), F_DUPFD_CLOEXEC, 0);
+    if(follow_path == NULL || follow_fd < 0)
+    {
+        console_print_error("Could not hang on to %s for following.\n",path);
+        return -1;
+    }
+    follow_offset = tail;
+    console_print_info("Following %s from offset %lld.\n",path,(long long int)follow_offset);
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    follow_log_run
+// Notes:   The directory gets watched as well as the file so we hear about
+//          a new log turning up under the old name.  Every wakeup (or
+//          timeout) reads whatever is new, then checks for a rotation.
+//
+//******************************************************************************
+int follow_log_run(void)
+{
+    char events[4096];
+    struct pollfd waiting;
+    char *directory;
+    char *slash;
+
+    if(follow_fd < 0)
+    {
+        return 0;
+    }
+
+    notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(notify_fd < 0)
+    {
+        console_print_info("No inotify (%s), checking the log every %d ms.\n",strerror(errno),FOLLOW_POLL_MS);
+    }
+    else
+    {
+        directory = strdup(follow_path);
+        if(directory != NULL)
+        {
+            slash = strrchr(directory, '/');
+            if(slash == NULL)
+            {
+                strcpy(directory, ".");
+            }
+            else if(slash == directory)
+            {
+                slash[1] = '\0';
+            }
+            else
+            {
+                *slash = '\0';
+            }
+            inotify_add_watch(notify_fd, directory, FOLLOW_DIR_EVENTS);
+            free(directory);
+        }
+        _watch_log();
+    }
+
+    for(;;)
+    {
+        if(_follow_step() || _check_rotation())
+        {
+            break;
+        }
+
+        waiting.fd = notify_fd;
+        waiting.events = POLLIN;
+        waiting.revents = 0;
+        if(poll(&waiting, (notify_fd >= 0) ? 1 : 0, FOLLOW_POLL_MS) > 0)
+        {
+            //what happened doesn't matter, we look at the file either way
+            while(read(notify_fd, events, sizeof(events)) > 0)
+            {
+            }
+        }
+    }
+
+    if(notify_fd >= 0)
+    {
+        close(notify_fd);
+        notify_fd = -1;
+    }
+    close(follow_fd);
+    follow_fd = -1;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _last_line_end
+// Notes:   One past the last newline in the first size bytes of the log, so
+//          a partly written last line is left for following to pick up.
+//
+//******************************************************************************
+static off_t _last_line_end(off_t size)
+{
+    char tail[FOLLOW_TAIL_READ];
+    off_t position = size;
+    ssize_t got;
+    size_t length;
+
+    while(position > 0)
+    {
+        length = (position > FOLLOW_TAIL_READ) ? FOLLOW_TAIL_READ : (size_t)position;
+        got = read_log_file(tail, length, position - (off_t)length);
+        if(got != (ssize_t)length)
+        {
+            break;
+        }
+        char *newline = memrchr(tail, '\n', length);
+        if(newline != NULL)
+        {
+            return position - (off_t)length + (newline - tail) + 1;
+        }
+        position -= (off_t)length;
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _follow_step
+// Notes:   Reads and prints everything complete that's been added since last
+//          time.  Returns 1 once a line past the end of the window shows up.
+//
+//******************************************************************************
+static int _follow_step(void)
+{
+    struct stat file_stat;
+    size_t length;
+    size_t complete;
+    size_t emit_start;
+    size_t emit_end;
+    ssize_t got;
+    char *newline;
+    char *grown;
+    int closed;
+
+    for(;;)
+    {
+        if(fstat(follow_fd, &file_stat) != 0)
+        {
+            return 0;
+        }
+        if(file_stat.st_size < follow_offset)
+        {
+            console_print_info("Log was truncated, following from the top.\n");
+            follow_offset = 0;
+        }
+        if(file_stat.st_size == follow_offset)
+        {
+            return 0;
+        }
+
+        if(buffer == NULL)
+        {
+            buffer = malloc(FOLLOW_BUFFER_SIZE);
+            if(buffer == NULL)
+            {
+                return 0;
+            }
+            buffer_size = FOLLOW_BUFFER_SIZE;
+        }
+        length = (file_stat.st_size - follow_offset > (off_t)buffer_size) ? buffer_size : (size_t)(file_stat.st_size - follow_offset);
+        do
+        {
+            got = pread(follow_fd, buffer, length, follow_offset);
+        } while(got < 0 && errno == EINTR);
+        if(got <= 0)
+        {
+            return 0;
+        }
+
+        newline = memrchr(buffer, '\n', (size_t)got);
+        if(newline != NULL)
+        {
+            complete = (size_t)(newline - buffer) + 1;
+        }
+        else if((size_t)got < buffer_size)
+        {
+            //the rest of the line hasn't been written yet
+            return 0;
+        }
+        else if(buffer_size < FOLLOW_BUFFER_MAX && (grown = realloc(buffer, buffer_size * 2)) != NULL)
+        {
+            //a line bigger than the buffer, give it more room
+            buffer = grown;
+            buffer_size *= 2;
+            continue;
+        }
+        else
+        {
+            //past the max it just goes out in pieces
+            complete = (size_t)got;
+        }
+
+        closed = _scan_lines(buffer, complete, &emit_start, &emit_end);
+        if(emit_end > emit_start)
+        {
+            _emit(buffer + emit_start, follow_offset + (off_t)emit_start, follow_offset + (off_t)emit_end);
+        }
+        if(closed)
+        {
+            return 1;
+        }
+        follow_offset += (off_t)complete;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _scan_lines
+// Notes:   Works out which part of the complete lines in data gets printed.
+//          Lines without a time stamp go along with the one before them.
+//          Returns 1 if the window closed somewhere in here.
+//
+//******************************************************************************
+static int _scan_lines(const char *data, size_t length, size_t *emit_start, size_t *emit_end)
+{
+    const char *line = data;
+    const char *end = data + length;
+    const char *newline;
+    epoch_time line_time;
+
+    *emit_start = 0;
+    *emit_end = length;
+
+    //the common case, an open window with no end, doesn't need to look
+    if(window_open && follow_end < 0)
+    {
+        return 0;
+    }
+
+    while(line < end)
+    {
+        newline = memchr(line, '\n', (size_t)(end - line));
+        if(parse_log_line_time(line, (size_t)(newline - line), &line_time))
+        {
+            line_time = refine_log_time(line_time, line, (size_t)(newline - line));
+            if(line_time == EPOCH_TIME_NONE)
+            {
+                line = newline + 1;
+                continue;
+            }
+            if(!window_open && line_time >= follow_start)
+            {
+                window_open = 1;
+                *emit_start = (size_t)(line - data);
+            }
+            if(window_open && follow_end >= 0 && line_time > follow_end)
+            {
+                *emit_end = (size_t)(line - data);
+                return 1;
+            }
+        }
+        line = newline + 1;
+    }
+
+    if(!window_open)
+    {
+        *emit_start = length;
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _emit
+// Notes:   Straight out of the buffer, or through the -e/--regex filter,
+//          which reads the lines back itself.
+//
+//******************************************************************************
+static void _emit(const char *data, off_t start_offset, off_t end_offset)
+{
+    fflush(stdout);
+    if(filter_enabled())
+    {
+        //filter_range wants the end at the last newline, like dump_file_range
+        filter_range(NULL, _follow_read, start_offset, end_offset - 1, fileno(stdout));
+    }
+    else
+    {
+        output_buffer(data, (size_t)(end_offset - start_offset), fileno(stdout));
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _follow_read
+// Notes:   The filter's reader, our descriptor rather than the search's
+//
+//******************************************************************************
+static ssize_t _follow_read(char *read_buffer, size_t size, off_t offset)
+{
+    return pread(follow_fd, read_buffer, size, offset);
+}
+
+
+
+//******************************************************************************
+// Name:    _check_rotation
+// Notes:   If the name now points at a different file the log got rotated.
+//          Whatever the old file got before the writer moved over has
+//          already been read, so switch to the new one and start at its top.
+//          Returns 1 if the window closed in the last of the old file.
+//
+//******************************************************************************
+static int _check_rotation(void)
+{
+    struct stat path_stat;
+    struct stat fd_stat;
+    int new_fd;
+
+    if(stat(follow_path, &path_stat) != 0 || fstat(follow_fd, &fd_stat) != 0)
+    {
+        return 0;
+    }
+    if(path_stat.st_dev == fd_stat.st_dev && path_stat.st_ino == fd_stat.st_ino)
+    {
+        return 0;
+    }
+
+    //the writer may have got a last few lines in after we looked
+    if(_follow_step())
+    {
+        return 1;
+    }
+
+    new_fd = open(follow_path, O_RDONLY | O_CLOEXEC);
+    if(new_fd < 0)
+    {
+        return 0;
+    }
+    console_print_info("%s was rotated, following the new file.\n",follow_path);
+    close(follow_fd);
+    follow_fd = new_fd;
+    follow_offset = 0;
+    _watch_log();
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _watch_log
+// Notes:   Watches are per inode, a rotated log needs a new one
+//
+//******************************************************************************
+static void _watch_log(void)
+{
+    if(notify_fd < 0)
+    {
+        return;
+    }
+    if(file_watch >= 0)
+    {
+        inotify_rm_watch(notify_fd, file_watch);
+    }
+    file_watch = inotify_add_watch(notify_fd, follow_path, FOLLOW_FILE_EVENTS);
+}
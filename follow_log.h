@@ -0,0 +1,48 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    follow_log.h
+// Notes:   header for the follow_log module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_FOLLOW_LOG_H__
+#define __TGREP_FOLLOW_LOG_H__
+
+#include "parse_time.h"
+
+//the part of -f that's already in the log.  the log has to be open: this
+//finds where the window starts, dumps everything up to the last complete
+//line and takes its own descriptor, so the log can be closed (and its map
+//saved) afterwards.  the times are what parse_search_string gave, with
+//search_end_time of -1 meaning there's no end, follow forever.  returns 1
+//if there's more to wait for, 0 if the window already closed and
+//everything got printed, -1 if following can't work.
+int follow_log_start(const char *path, epoch_time search_start_time, epoch_time search_end_time, int dated);
+
+//then wait for the log to grow, printing new lines as they show up until
+//one is past the end of the window.  picks up the new file when the log
+//gets rotated.  returns 1 once the window has closed, 0 if it had to give
+//up, and never returns at all without an end time.
+int follow_log_run(void);
+
+#endif
@@ -0,0 +1,551 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    index_build.c
+// Notes:   Builds the complete map for a log in one pass instead of letting it
+//          fill in lazily as searches probe around.  The file is cut into one
+//          chunk per thread, each thread owns the lines that START inside its
+//          chunk and boils them down to runs of lines with the same time.
+//          The runs are stitched together in file order at the end and
+//          poured into the map, every boundary confirmed.
+//
+//          Meant to be run once after a log rotates (logrotate postrotate) so
+//          interactive searches only ever see a warm map.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "parse_time.h"
+#include "map_file.h"
+#include "file_scan.h"
+#include "index_build.h"
+#include "console_output.h"
+#include "line_scan.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//how much the read() path pulls in at a time.  doubles if a single line
+//doesn't fit.
+#define INDEX_READ_SIZE         (4*1024*1024)
+
+//no point spinning up threads for tiny pieces of file
+#define INDEX_MIN_CHUNK_SIZE    (1024*1024)
+
+#define INDEX_MAX_THREADS       (256)
+
+//lines per line_scan call
+#define INDEX_SCAN_BATCH        (256)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//a stretch of consecutive lines that all carry the same time
+struct _index_run {
+    epoch_time time;
+    off_t starting_offset;
+    off_t ending_offset;
+};
+
+typedef struct _index_run index_run;
+
+//everything one thread needs, and everything it hands back
+struct _index_chunk {
+    off_t chunk_start;
+    off_t chunk_end;
+
+    index_run *runs;
+    int run_count;
+    int run_capacity;
+    long long int line_count;
+
+    int failed;
+};
+
+typedef struct _index_chunk index_chunk;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void *_index_chunk_thread(void *argument);
+static off_t _find_first_line_start(off_t chunk_start);
+static int _scan_lines(index_chunk *chunk, const char *data, off_t data_offset, off_t data_length, int at_eof, off_t *next_line_start);
+static int _add_line(index_chunk *chunk, const scanned_line *line, const char *text, off_t line_start, off_t line_end);
+static int _stitch_chunks(index_chunk *chunks, int chunk_count);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    build_log_index
+// Notes:   Splits the file up, runs the threads, stitches the results.  The
+//          map module isn't thread safe so the threads only ever touch their
+//          own chunk and the map is filled in afterwards from this thread.
+//
+//******************************************************************************
+int build_log_index(int thread_count)
+{
+    off_t file_size = get_log_file_size();
+    pthread_t threads[INDEX_MAX_THREADS];
+    index_chunk *chunks;
+    int chunk_count;
+    int seconds;
+    int i;
+
+    if(get_log_file_descriptor() == -1 || file_size <= 0)
+    {
+        console_print_error("No log file to index.\n");
+        return -1;
+    }
+
+    if(thread_count <= 0)
+    {
+        thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if(thread_count <= 0)
+    {
+        thread_count = 1;
+    }
+    if(thread_count > INDEX_MAX_THREADS)
+    {
+        thread_count = INDEX_MAX_THREADS;
+    }
+
+    chunk_count = thread_count;
+    if(file_size / chunk_count < INDEX_MIN_CHUNK_SIZE)
+    {
+        chunk_count = (int)(file_size / INDEX_MIN_CHUNK_SIZE) + 1;
+        if(chunk_count > thread_count)
+        {
+            chunk_count = thread_count;
+        }
+    }
+
+    chunks = calloc(chunk_count, sizeof(index_chunk));
+    if(chunks == NULL)
+    {
+        console_print_error("Could not allocate index chunks.\n");
+        return -1;
+    }
+
+    for(i = 0; i < chunk_count; i++)
+    {
+        chunks[i].chunk_start = (file_size / chunk_count) * i;
+        chunks[i].chunk_end = (i == chunk_count - 1) ? file_size : (file_size / chunk_count) * (i + 1);
+    }
+
+    console_print_info("Indexing %lld bytes with %d threads.\n",(long long int)file_size,chunk_count);
+
+    //chunk 0 runs on this thread, no sense leaving it idle
+    for(i = 1; i < chunk_count; i++)
+    {
+        if(pthread_create(&threads[i], NULL, _index_chunk_thread, &chunks[i]) != 0)
+        {
+            //just do it ourselves then
+            _index_chunk_thread(&chunks[i]);
+            threads[i] = pthread_self();
+        }
+    }
+    _index_chunk_thread(&chunks[0]);
+    for(i = 1; i < chunk_count; i++)
+    {
+        if(!pthread_equal(threads[i], pthread_self()))
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    seconds = _stitch_chunks(chunks, chunk_count);
+
+    for(i = 0; i < chunk_count; i++)
+    {
+        free(chunks[i].runs);
+    }
+    free(chunks);
+    return seconds;
+}
+
+
+
+//******************************************************************************
+// Name:    _index_chunk_thread
+// Notes:   Walks every line that starts in the chunk.  With the file mapped
+//          that's one call over the mapping, otherwise pread big blocks and
+//          carry any partial line at the end over to the next read.
+//
+//******************************************************************************
+static void *_index_chunk_thread(void *argument)
+{
+    index_chunk *chunk = argument;
+    const char *mapping = get_log_file_mapping();
+    off_t file_size = get_log_file_size();
+    off_t line_start = _find_first_line_start(chunk->chunk_start);
+    size_t buffer_size = INDEX_READ_SIZE;
+    char *buffer = NULL;
+    ssize_t read_size;
+    off_t next_line_start;
+    int at_eof;
+
+    if(line_start < 0)
+    {
+        chunk->failed = 1;
+        return NULL;
+    }
+
+    if(mapping != NULL)
+    {
+        _scan_lines(chunk, mapping + line_start, line_start, file_size - line_start, 1, &next_line_start);
+        return NULL;
+    }
+
+    buffer = malloc(buffer_size);
+    if(buffer == NULL)
+    {
+        chunk->failed = 1;
+        return NULL;
+    }
+
+    while(line_start < chunk->chunk_end && line_start < file_size)
+    {
+        read_size = read_log_file(buffer, buffer_size, line_start);
+        if(read_size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(read_size <= 0)
+        {
+            chunk->failed = (read_size < 0);
+            break;
+        }
+
+        at_eof = (line_start + read_size >= file_size);
+        if(_scan_lines(chunk, buffer, line_start, read_size, at_eof, &next_line_start) || at_eof)
+        {
+            break;
+        }
+
+        if(next_line_start == line_start)
+        {
+            //one line bigger than the whole buffer, make room and try again
+            char *bigger = realloc(buffer, buffer_size * 2);
+            if(bigger == NULL)
+            {
+                chunk->failed = 1;
+                break;
+            }
+            buffer = bigger;
+            buffer_size *= 2;
+        }
+        line_start = next_line_start;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+
+
+//******************************************************************************
+// Name:    _find_first_line_start
+// Notes:   The first line that starts at or after chunk_start, which is just
+//          past the first newline at or after chunk_start-1.
+//
+//******************************************************************************
+static off_t _find_first_line_start(off_t chunk_start)
+{
+    const char *mapping = get_log_file_mapping();
+    off_t file_size = get_log_file_size();
+    char buffer[4096];
+    const char *eol;
+    ssize_t read_size;
+    off_t offset;
+
+    if(chunk_start == 0)
+    {
+        return 0;
+    }
+
+    offset = chunk_start - 1;
+    if(mapping != NULL)
+    {
+        eol = memchr(mapping + offset, '\n', (size_t)(file_size - offset));
+        return (eol == NULL) ? file_size : (off_t)(eol - mapping) + 1;
+    }
+
+    while(offset < file_size)
+    {
+        read_size = read_log_file(buffer, sizeof(buffer), offset);
+        if(read_size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(read_size <= 0)
+        {
+            return (read_size == 0) ? file_size : -1;
+        }
+        eol = memchr(buffer, '\n', (size_t)read_size);
+        if(eol != NULL)
+        {
+            return offset + (off_t)(eol - buffer) + 1;
+        }
+        offset += read_size;
+    }
+    return file_size;
+}
+
+
+
+//******************************************************************************
+// Name:    _scan_lines
+// Notes:   Feeds every complete line in data to _add_line.  line_scan does
+//          the newline hunting and the stamp checks a batch at a time.  Sets
+//          next_line_start to the first line it couldn't finish and returns 1
+//          once we've walked past the end of the chunk.
+//
+//******************************************************************************
+static int _scan_lines(index_chunk *chunk, const char *data, off_t data_offset, off_t data_length, int at_eof, off_t *next_line_start)
+{
+    scanned_line lines[INDEX_SCAN_BATCH];
+    off_t position = 0;
+    off_t line_start;
+    size_t consumed;
+    int line_count;
+    int i;
+
+    while(position < data_length)
+    {
+        line_count = scan_log_lines(data + position, (size_t)(data_length - position), lines, INDEX_SCAN_BATCH, &consumed);
+        for(i = 0; i < line_count; i++)
+        {
+            line_start = data_offset + position + (off_t)lines[i].start;
+            if(line_start >= chunk->chunk_end)
+            {
+                *next_line_start = line_start;
+                return 1;
+            }
+
+            //the rest of this line is in the next read
+            if(!lines[i].has_newline && !at_eof)
+            {
+                *next_line_start = line_start;
+                return 0;
+            }
+
+            if(!_add_line(chunk, &lines[i], data + position + lines[i].start, line_start, line_start + (off_t)lines[i].length))
+            {
+                chunk->failed = 1;
+                *next_line_start = line_start;
+                return 1;
+            }
+        }
+        if(line_count == 0)
+        {
+            break;
+        }
+        position += (off_t)consumed;
+    }
+
+    *next_line_start = data_offset + position;
+    return (data_offset + position >= chunk->chunk_end);
+}
+
+
+
+//******************************************************************************
+// Name:    _add_line
+// Notes:   Either stretches the current run or starts a new one.  Lines that
+//          don't start with a timestamp are skipped just like the probes skip
+//          them.  ending_offset follows the map convention: the newline of the
+//          last line, or the end of the file if it has none.
+//
+//******************************************************************************
+static int _add_line(index_chunk *chunk, const scanned_line *line, const char *text, off_t line_start, off_t line_end)
+{
+    index_run *run;
+    epoch_time time;
+
+    chunk->line_count++;
+    if(line->time == EPOCH_TIME_NONE)
+    {
+        return 1;
+    }
+    time = refine_log_time(line->time, text, line->length);
+    if(time == EPOCH_TIME_NONE)
+    {
+        return 1;
+    }
+
+    if(chunk->run_count > 0 && chunk->runs[chunk->run_count - 1].time == time)
+    {
+        chunk->runs[chunk->run_count - 1].ending_offset = line_end;
+        return 1;
+    }
+
+    if(chunk->run_count == chunk->run_capacity)
+    {
+        int new_capacity = (chunk->run_capacity == 0) ? 1024 : chunk->run_capacity * 2;
+        index_run *new_runs = realloc(chunk->runs, new_capacity * sizeof(index_run));
+        if(new_runs == NULL)
+        {
+            return 0;
+        }
+        chunk->runs = new_runs;
+        chunk->run_capacity = new_capacity;
+    }
+
+    run = &chunk->runs[chunk->run_count++];
+    run->time = time;
+    run->starting_offset = line_start;
+    run->ending_offset = line_end;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _stitch_chunks
+// Notes:   A second that straddles a chunk boundary shows up as the last run
+//          of one chunk and the first run of the next, so glue those back
+//          together before anything goes in the map.  After that every run
+//          boundary is a real time change and can be confirmed, the ends of
+//          the file are confirmed the same way the probes do it.
+//
+//******************************************************************************
+static int _stitch_chunks(index_chunk *chunks, int chunk_count)
+{
+    off_t file_size = get_log_file_size();
+    index_run *previous = NULL;
+    index_run *run;
+    map_item *item;
+    long long int line_count = 0;
+    int seconds = 0;
+    int total = 0;
+    int c;
+    int r;
+
+    for(c = 0; c < chunk_count; c++)
+    {
+        if(chunks[c].failed)
+        {
+            console_print_error("Reading the log failed while indexing.\n");
+            return -1;
+        }
+        total += chunks[c].run_count;
+    }
+
+    //glue in place first, a run swallowed by the one before gets its time
+    //set to -1 so it's skipped below
+    for(c = 0; c < chunk_count; c++)
+    {
+        for(r = 0; r < chunks[c].run_count; r++)
+        {
+            run = &chunks[c].runs[r];
+            if(previous != NULL && previous->time == run->time)
+            {
+                previous->ending_offset = run->ending_offset;
+                run->time = -1;
+                continue;
+            }
+            previous = run;
+        }
+        line_count += chunks[c].line_count;
+    }
+
+    previous = NULL;
+    for(c = 0; c < chunk_count; c++)
+    {
+        for(r = 0; r < chunks[c].run_count; r++)
+        {
+            run = &chunks[c].runs[r];
+            if(run->time == -1)
+            {
+                continue;
+            }
+
+            item = create_new_map_item(run->time);
+            if(item == NULL)
+            {
+                return -1;
+            }
+
+            //a scan of the whole file beats any guess, and the same time
+            //turning up twice (clock going backwards) just widens the entry
+            if(item->starting_offset == -1 || run->starting_offset < item->starting_offset)
+            {
+                item->starting_offset = run->starting_offset;
+            }
+            if(run->ending_offset > item->ending_offset)
+            {
+                item->ending_offset = run->ending_offset;
+            }
+            if(previous != NULL || run->starting_offset == 0)
+            {
+                item->starting_offset_confirmed = 1;
+            }
+            if(previous != NULL)
+            {
+                map_item *previous_item = find_exact_map_item(previous->time);
+                if(previous_item != NULL)
+                {
+                    previous_item->ending_offset_confirmed = 1;
+                }
+            }
+            if(run->ending_offset == file_size - 1)
+            {
+                item->ending_offset_confirmed = 1;
+            }
+
+            previous = run;
+            seconds++;
+        }
+    }
+
+    merge_map_items(1);
+    console_print_info("Indexed %lld lines into %d seconds (%d runs before stitching).\n",line_count,seconds,total);
+    return seconds;
+}
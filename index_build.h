@@ -0,0 +1,36 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    index_build.h
+// Notes:   header for the index_build module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_INDEX_BUILD_H__
+#define __TGREP_INDEX_BUILD_H__
+
+//scans the whole open log with thread_count threads (0 picks one per cpu)
+//and fills the map with a confirmed start and end for every second in the
+//file.  returns the number of seconds found or -1 on failure.
+int build_log_index(int thread_count);
+
+#endif
@@ -0,0 +1,1012 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    line_filter.c
+// Notes:   tgrep TIME -e PATTERN.  Instead of pushing the whole time range
+//          through a pipe into grep, the range is cut into segments that are
+//          filtered on all cores at once and written back out in file order.
+//
+//          Fixed strings are found with a vector first/last byte search over
+//          the whole segment rather than line by line, so lines that can't
+//          match cost next to nothing.  Regexes get the same treatment using
+//          the longest run of plain characters they must contain, and
+//          regexec only runs on the lines that have it.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <regex.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LINE_FILTER_X86
+#include <immintrin.h>
+#endif
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "line_filter.h"
+#include "line_scan.h"
+#include "console_output.h"
+#include "stats.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//each thread takes this much of the range at a time
+#define FILTER_SEGMENT_SIZE     (4*1024*1024)
+
+//how far past a segment we read hoping to catch the end of its last line
+#define FILTER_READ_EXTRA       (64*1024)
+
+#define FILTER_MAX_THREADS      (256)
+
+//segments that can be done and waiting to be written, per thread.  keeps
+//one slow write from letting the threads run off with all the memory.
+#define FILTER_AHEAD_PER_THREAD (2)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//one -e or --regex.  literal is the fixed string, or for a regex the run of
+//plain characters every match has to contain (NULL if it hasn't got one)
+struct _filter_pattern {
+    char *literal;
+    size_t literal_length;
+    int is_regex;
+    regex_t regex;
+};
+
+typedef struct _filter_pattern filter_pattern;
+
+//the lines that start in [start, end) and what came out of them
+struct _filter_segment {
+    off_t start;
+    off_t end;
+    char *output;
+    size_t output_length;
+    size_t output_capacity;
+    long long int matches;
+    int done;
+    int failed;
+};
+
+typedef struct _filter_segment filter_segment;
+
+//everything the threads share for one filter_range call
+struct _filter_job {
+    const char *mapping;
+    range_reader reader;
+    off_t range_start;
+    off_t range_end;
+
+    filter_segment *segments;
+    int segment_count;
+    int next_segment;
+    int written_segments;
+    int ahead;
+    int stop;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+typedef struct _filter_job filter_job;
+
+typedef const char *(*literal_search_function)(const char *data, size_t length, const char *needle, size_t needle_length);
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static filter_pattern *patterns = NULL;
+static int pattern_count = 0;
+static int filter_threads = 0;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static filter_pattern *_new_pattern(void);
+static char *_regex_prefilter(const char *pattern, size_t *length);
+static void *_filter_thread(void *argument);
+static void _filter_segment(filter_job *job, filter_segment *segment, literal_search_function search);
+static void _filter_block(const char *data, size_t first_line, size_t length, filter_segment *segment, literal_search_function search);
+static size_t _next_candidate(filter_pattern *pattern, const char *data, size_t position, size_t length, literal_search_function search);
+static int _line_matches(filter_pattern *pattern, const char *line, size_t line_length);
+static int _append_line(filter_segment *segment, const char *line, size_t line_length);
+static literal_search_function _pick_search(void);
+static const char *_search_scalar(const char *data, size_t length, const char *needle, size_t needle_length);
+
+#ifdef LINE_FILTER_X86
+static const char *_search_sse2(const char *data, size_t length, const char *needle, size_t needle_length);
+static const char *_search_avx2(const char *data, size_t length, const char *needle, size_t needle_length);
+#endif
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    add_filter_literal
+// Notes:   A line can't contain a newline, so neither can the pattern
+//
+//******************************************************************************
+int add_filter_literal(const char *pattern)
+{
+    filter_pattern *new_pattern;
+
+    if(strchr(pattern, '\n') != NULL)
+    {
+        console_print_error("Patterns can't span lines.\n");
+        return -1;
+    }
+    new_pattern = _new_pattern();
+    if(new_pattern == NULL)
+    {
+        return -1;
+    }
+    new_pattern->literal = strdup(pattern);
+    new_pattern->literal_length = strlen(pattern);
+    if(new_pattern->literal == NULL)
+    {
+        pattern_count--;
+        console_print_error("Could not allocate filter pattern.\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    add_filter_regex
+// Notes:   Extended syntax, same as grep -E
+//
+//******************************************************************************
+int add_filter_regex(const char *pattern)
+{
+    filter_pattern *new_pattern = _new_pattern();
+    char message[256];
+    int result;
+
+    if(new_pattern == NULL)
+    {
+        return -1;
+    }
+    result = regcomp(&new_pattern->regex, pattern, REG_EXTENDED | REG_NOSUB | REG_NEWLINE);
+    if(result != 0)
+    {
+        regerror(result, &new_pattern->regex, message, sizeof(message));
+        console_print_error("Bad regex \"%s\": %s\n",pattern,message);
+        pattern_count--;
+        return -1;
+    }
+    new_pattern->is_regex = 1;
+    new_pattern->literal = _regex_prefilter(pattern, &new_pattern->literal_length);
+    if(new_pattern->literal != NULL)
+    {
+        console_print_debug("Regex \"%s\" prefiltered on \"%s\".\n",pattern,new_pattern->literal);
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    filter_enabled
+//******************************************************************************
+int filter_enabled(void)
+{
+    return pattern_count > 0;
+}
+
+
+
+//******************************************************************************
+// Name:    set_filter_threads
+// Notes:   -j
+//
+//******************************************************************************
+void set_filter_threads(int thread_count)
+{
+    filter_threads = thread_count;
+}
+
+
+
+//******************************************************************************
+// Name:    filter_range
+// Notes:   The threads grab segments in order and this thread writes them out
+//          in order as they finish.  A single thread just does it all here.
+//
+//******************************************************************************
+off_t filter_range(const char *mapping, range_reader reader, off_t start_offset, off_t end_offset, int out_fd)
+{
+    pthread_t threads[FILTER_MAX_THREADS];
+    literal_search_function search = _pick_search();
+    filter_segment *segment;
+    filter_job job;
+    long long int matches = 0;
+    off_t written = 0;
+    int thread_count = filter_threads;
+    int started = 0;
+    int i;
+
+    if((mapping == NULL && reader == NULL) || end_offset < start_offset || out_fd < 0)
+    {
+        return -1;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.mapping = mapping;
+    job.reader = reader;
+    job.range_start = start_offset;
+    job.range_end = end_offset;
+    job.segment_count = (int)((end_offset - start_offset + FILTER_SEGMENT_SIZE - 1) / FILTER_SEGMENT_SIZE);
+    if(job.segment_count == 0)
+    {
+        return 0;
+    }
+    job.segments = calloc((size_t)job.segment_count, sizeof(filter_segment));
+    if(job.segments == NULL)
+    {
+        console_print_error("Could not allocate filter segments.\n");
+        return -1;
+    }
+    for(i = 0; i < job.segment_count; i++)
+    {
+        job.segments[i].start = start_offset + (off_t)i * FILTER_SEGMENT_SIZE;
+        job.segments[i].end = job.segments[i].start + FILTER_SEGMENT_SIZE;
+        if(job.segments[i].end > end_offset)
+        {
+            job.segments[i].end = end_offset;
+        }
+    }
+
+    if(thread_count <= 0)
+    {
+        thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if(thread_count > FILTER_MAX_THREADS)
+    {
+        thread_count = FILTER_MAX_THREADS;
+    }
+    if(thread_count > job.segment_count)
+    {
+        thread_count = job.segment_count;
+    }
+    job.ahead = thread_count * FILTER_AHEAD_PER_THREAD;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    if(thread_count > 1)
+    {
+        for(i = 0; i < thread_count; i++)
+        {
+            if(pthread_create(&threads[started], NULL, _filter_thread, &job) == 0)
+            {
+                started++;
+            }
+        }
+    }
+    console_print_debug("Filtering %d segments with %d threads.\n",job.segment_count,started);
+
+    for(i = 0; i < job.segment_count; i++)
+    {
+        segment = &job.segments[i];
+
+        //no threads (or they didn't start), do it ourselves
+        if(started == 0)
+        {
+            _filter_segment(&job, segment, search);
+        }
+
+        pthread_mutex_lock(&job.lock);
+        while(!segment->done)
+        {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        if(segment->failed)
+        {
+            console_print_error("Could not read the log at %lld.\n",(long long int)segment->start);
+        }
+        else if(segment->output_length > 0)
+        {
+            if(output_buffer(segment->output, segment->output_length, out_fd) < (off_t)segment->output_length)
+            {
+                console_print_error("Output failed after %lld bytes.\n",(long long int)written);
+                segment->failed = 1;
+            }
+            written += (off_t)segment->output_length;
+        }
+        matches += segment->matches;
+        free(segment->output);
+        segment->output = NULL;
+
+        pthread_mutex_lock(&job.lock);
+        job.written_segments = i + 1;
+        if(segment->failed)
+        {
+            job.stop = 1;
+        }
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+
+        if(segment->failed)
+        {
+            break;
+        }
+    }
+
+    //anybody still going sees stop, or runs out of segments
+    pthread_mutex_lock(&job.lock);
+    job.stop = 1;
+    pthread_cond_broadcast(&job.changed);
+    pthread_mutex_unlock(&job.lock);
+    for(i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    for(i = 0; i < job.segment_count; i++)
+    {
+        free(job.segments[i].output);
+    }
+    free(job.segments);
+    pthread_cond_destroy(&job.changed);
+    pthread_mutex_destroy(&job.lock);
+
+    stats_add(STAT_FILTER_MATCHES, matches);
+    return written;
+}
+
+
+
+//******************************************************************************
+// Name:    _new_pattern
+// Notes:   Room for one more, cleared
+//
+//******************************************************************************
+static filter_pattern *_new_pattern(void)
+{
+    filter_pattern *grown = realloc(patterns, sizeof(filter_pattern) * (size_t)(pattern_count + 1));
+
+    if(grown == NULL)
+    {
+        console_print_error("Could not allocate filter pattern.\n");
+        return NULL;
+    }
+    patterns = grown;
+    memset(&patterns[pattern_count], 0, sizeof(filter_pattern));
+    return &patterns[pattern_count++];
+}
+
+
+
+//******************************************************************************
+// Name:    _regex_prefilter
+// Notes:   The longest run of plain characters the regex can't match
+//          without.  Anything optional ("x?", "x*", "x{0,}") ends a run
+//          before the optional character, and anything inside brackets or
+//          parentheses is skipped since a group can be optional too.  An
+//          alternation anywhere means there's no one string that has to be
+//          there, so no prefilter at all.  Returns NULL if there's nothing.
+//
+//******************************************************************************
+static char *_regex_prefilter(const char *pattern, size_t *length)
+{
+    size_t best_start = 0;
+    size_t best_length = 0;
+    size_t run_start = 0;
+    size_t run_length = 0;
+    size_t i;
+    int depth = 0;
+    char *literal;
+
+    if(strchr(pattern, '|') != NULL)
+    {
+        return NULL;
+    }
+
+    for(i = 0; pattern[i] != '\0'; i++)
+    {
+        char c = pattern[i];
+        char next = pattern[i + 1];
+
+        if(depth == 0 && strchr(".[]()*+?{}^$\\", c) == NULL)
+        {
+            //a quantifier that allows zero of this character ends the run
+            //before it
+            if(next == '*' || next == '?' || next == '{')
+            {
+                run_length = 0;
+                continue;
+            }
+            if(run_length == 0)
+            {
+                run_start = i;
+            }
+            run_length++;
+            if(run_length > best_length)
+            {
+                best_start = run_start;
+                best_length = run_length;
+            }
+            //one or more still has to have one, but the next character
+            //isn't necessarily straight after it
+            if(next == '+')
+            {
+                run_length = 0;
+            }
+            continue;
+        }
+
+        run_length = 0;
+        if(c == '\\' && next != '\0')
+        {
+            i++;
+        }
+        else if(c == '[')
+        {
+            //skip the whole bracket expression, a ']' first is part of it
+            i++;
+            if(pattern[i] == '^')
+            {
+                i++;
+            }
+            if(pattern[i] == ']')
+            {
+                i++;
+            }
+            while(pattern[i] != '\0' && pattern[i] != ']')
+            {
+                //[:class:], [=x=] and [.x.] can have a ']' of their own
+                //inside, only their closing ":]" (or "=]", ".]") ends them
+                if(pattern[i] == '[' && (pattern[i + 1] == ':' || pattern[i + 1] == '=' || pattern[i + 1] == '.'))
+                {
+                    char delimiter = pattern[i + 1];
+
+                    i += 2;
+                    while(pattern[i] != '\0' && !(pattern[i] == delimiter && pattern[i + 1] == ']'))
+                    {
+                        i++;
+                    }
+                    if(pattern[i] == '\0')
+                    {
+                        break;
+                    }
+                    i++;
+                }
+                i++;
+            }
+            if(pattern[i] == '\0')
+            {
+                break;
+            }
+        }
+        else if(c == '{')
+        {
+            //the counts aren't part of the text
+            while(pattern[i] != '\0' && pattern[i] != '}')
+            {
+                i++;
+            }
+            if(pattern[i] == '\0')
+            {
+                break;
+            }
+        }
+        else if(c == '(')
+        {
+            depth++;
+        }
+        else if(c == ')' && depth > 0)
+        {
+            depth--;
+        }
+    }
+
+    if(best_length == 0)
+    {
+        return NULL;
+    }
+    literal = malloc(best_length + 1);
+    if(literal == NULL)
+    {
+        return NULL;
+    }
+    memcpy(literal, pattern + best_start, best_length);
+    literal[best_length] = '\0';
+    *length = best_length;
+    return literal;
+}
+
+
+
+//******************************************************************************
+// Name:    _filter_thread
+// Notes:   Takes the next segment as long as it isn't too far ahead of the
+//          writer
+//
+//******************************************************************************
+static void *_filter_thread(void *argument)
+{
+    filter_job *job = argument;
+    literal_search_function search = _pick_search();
+    filter_segment *segment;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&job->lock);
+        while(!job->stop && job->next_segment < job->segment_count &&
+              job->next_segment >= job->written_segments + job->ahead)
+        {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if(job->stop || job->next_segment >= job->segment_count)
+        {
+            pthread_mutex_unlock(&job->lock);
+            return NULL;
+        }
+        segment = &job->segments[job->next_segment++];
+        pthread_mutex_unlock(&job->lock);
+
+        _filter_segment(job, segment, search);
+
+        pthread_mutex_lock(&job->lock);
+        pthread_cond_broadcast(&job->changed);
+        pthread_mutex_unlock(&job->lock);
+    }
+    return NULL;
+}
+
+
+
+//******************************************************************************
+// Name:    _filter_segment
+// Notes:   A line belongs to the segment it starts in.  So we look from the
+//          byte before the segment (to tell if the segment starts on a line)
+//          to the newline ending the last line that starts inside it, which
+//          can be past the segment's end.  The mapping has all that already,
+//          otherwise read it, reading more if the last line is a long one.
+//
+//******************************************************************************
+static void _filter_segment(filter_job *job, filter_segment *segment, literal_search_function search)
+{
+    off_t data_offset = (segment->start > job->range_start) ? segment->start - 1 : segment->start;
+    size_t scan_end = (size_t)(segment->end - data_offset);
+    size_t available = (size_t)(job->range_end - data_offset);
+    size_t read_length = scan_end + FILTER_READ_EXTRA;
+    const char *data = NULL;
+    const char *newline;
+    char *buffer = NULL;
+    char *grown;
+    ssize_t read_size;
+    size_t first_line = 0;
+    size_t length;
+
+    if(job->mapping != NULL)
+    {
+        data = job->mapping + data_offset;
+    }
+    else
+    {
+        for(;;)
+        {
+            if(read_length > available)
+            {
+                read_length = available;
+            }
+            grown = realloc(buffer, read_length);
+            if(grown == NULL)
+            {
+                segment->failed = 1;
+                break;
+            }
+            buffer = grown;
+            do
+            {
+                read_size = job->reader(buffer, read_length, data_offset);
+            } while(read_size < 0 && errno == EINTR);
+            if(read_size < 0)
+            {
+                segment->failed = 1;
+                break;
+            }
+
+            //the file can come up short if it shrank, go with what's there
+            if((size_t)read_size < read_length)
+            {
+                available = (size_t)read_size;
+                if(scan_end > available)
+                {
+                    scan_end = available;
+                }
+            }
+            if(read_length >= available || memchr(buffer + scan_end - 1, '\n', read_length - (scan_end - 1)) != NULL)
+            {
+                data = buffer;
+                break;
+            }
+            read_length *= 2;
+        }
+    }
+
+    if(data != NULL && scan_end > 0)
+    {
+        //the last line that starts inside the segment ends at the first
+        //newline at or after its last byte
+        newline = memchr(data + scan_end - 1, '\n', available - (scan_end - 1));
+        length = (newline == NULL) ? available : (size_t)(newline - data) + 1;
+
+        if(segment->start > job->range_start)
+        {
+            newline = memchr(data, '\n', scan_end);
+            first_line = (newline == NULL) ? length : (size_t)(newline - data) + 1;
+        }
+        _filter_block(data, first_line, length, segment, search);
+    }
+
+    free(buffer);
+    pthread_mutex_lock(&job->lock);
+    segment->done = 1;
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+
+//******************************************************************************
+// Name:    _filter_block
+// Notes:   Every pattern keeps the start of the next line it could match.
+//          The lowest one is the next line worth looking at; it's printed if
+//          any of the patterns sitting on it really match, and they all move
+//          on past it.  Lines nobody points at are never touched.
+//
+//******************************************************************************
+static void _filter_block(const char *data, size_t first_line, size_t length, filter_segment *segment, literal_search_function search)
+{
+    size_t *candidates = malloc(sizeof(size_t) * (size_t)pattern_count);
+    const char *newline;
+    size_t line;
+    size_t line_end;
+    int matched;
+    int i;
+
+    if(candidates == NULL)
+    {
+        segment->failed = 1;
+        return;
+    }
+    for(i = 0; i < pattern_count; i++)
+    {
+        candidates[i] = _next_candidate(&patterns[i], data, first_line, length, search);
+    }
+
+    for(;;)
+    {
+        line = length;
+        for(i = 0; i < pattern_count; i++)
+        {
+            if(candidates[i] < line)
+            {
+                line = candidates[i];
+            }
+        }
+        if(line >= length)
+        {
+            break;
+        }
+
+        newline = memchr(data + line, '\n', length - line);
+        line_end = (newline == NULL) ? length : (size_t)(newline - data);
+
+        matched = 0;
+        for(i = 0; i < pattern_count && !matched; i++)
+        {
+            if(candidates[i] == line)
+            {
+                matched = _line_matches(&patterns[i], data + line, line_end - line);
+            }
+        }
+        if(matched)
+        {
+            if(!_append_line(segment, data + line, line_end - line))
+            {
+                segment->failed = 1;
+                break;
+            }
+            segment->matches++;
+        }
+
+        for(i = 0; i < pattern_count; i++)
+        {
+            if(candidates[i] == line)
+            {
+                candidates[i] = _next_candidate(&patterns[i], data, line_end + 1, length, search);
+            }
+        }
+    }
+    free(candidates);
+}
+
+
+
+//******************************************************************************
+// Name:    _next_candidate
+// Notes:   The start of the first line at or after position that has the
+//          pattern's literal in it, or length if there isn't one.  A regex
+//          with no literal has to look at every line.
+//
+//******************************************************************************
+static size_t _next_candidate(filter_pattern *pattern, const char *data, size_t position, size_t length, literal_search_function search)
+{
+    const char *hit;
+    const char *line;
+
+    if(position >= length)
+    {
+        return length;
+    }
+    if(pattern->literal == NULL || pattern->literal_length == 0)
+    {
+        return position;
+    }
+
+    hit = search(data + position, length - position, pattern->literal, pattern->literal_length);
+    if(hit == NULL)
+    {
+        return length;
+    }
+    line = memrchr(data + position, '\n', (size_t)(hit - (data + position)));
+    return (line == NULL) ? position : (size_t)(line - data) + 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _line_matches
+// Notes:   A literal candidate is already a match.  regexec wants a string,
+//          REG_STARTEND saves copying the line out to terminate it.
+//
+//******************************************************************************
+static int _line_matches(filter_pattern *pattern, const char *line, size_t line_length)
+{
+    regmatch_t bounds;
+
+    if(!pattern->is_regex)
+    {
+        return 1;
+    }
+#ifdef REG_STARTEND
+    bounds.rm_so = 0;
+    bounds.rm_eo = (regoff_t)line_length;
+    return regexec(&pattern->regex, line, 1, &bounds, REG_STARTEND) == 0;
+#else
+    {
+        char *copy = malloc(line_length + 1);
+        int result;
+
+        (void)bounds;
+        if(copy == NULL)
+        {
+            return 0;
+        }
+        memcpy(copy, line, line_length);
+        copy[line_length] = '\0';
+        result = regexec(&pattern->regex, copy, 0, NULL, 0) == 0;
+        free(copy);
+        return result;
+    }
+#endif
+}
+
+
+
+//******************************************************************************
+// Name:    _append_line
+// Notes:   Adds the line and a newline to the segment's output
+//
+//******************************************************************************
+static int _append_line(filter_segment *segment, const char *line, size_t line_length)
+{
+    size_t needed = segment->output_length + line_length + 1;
+    size_t capacity = segment->output_capacity;
+    char *grown;
+
+    if(needed > capacity)
+    {
+        if(capacity == 0)
+        {
+            capacity = 64 * 1024;
+        }
+        while(capacity < needed)
+        {
+            capacity *= 2;
+        }
+        grown = realloc(segment->output, capacity);
+        if(grown == NULL)
+        {
+            return 0;
+        }
+        segment->output = grown;
+        segment->output_capacity = capacity;
+    }
+    memcpy(segment->output + segment->output_length, line, line_length);
+    segment->output[segment->output_length + line_length] = '\n';
+    segment->output_length = needed;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _pick_search
+// Notes:   Goes with whatever line_scan decided the cpu can do
+//
+//******************************************************************************
+static literal_search_function _pick_search(void)
+{
+#ifdef LINE_FILTER_X86
+    switch(get_line_scan_isa())
+    {
+    case LINE_SCAN_AVX2:
+        return _search_avx2;
+    case LINE_SCAN_SSE2:
+        return _search_sse2;
+    default:
+        break;
+    }
+#endif
+    return _search_scalar;
+}
+
+
+
+//******************************************************************************
+// Name:    _search_scalar
+// Notes:   memmem, which is no slouch either
+//
+//******************************************************************************
+static const char *_search_scalar(const char *data, size_t length, const char *needle, size_t needle_length)
+{
+    if(needle_length == 1)
+    {
+        return memchr(data, needle[0], length);
+    }
+    return memmem(data, length, needle, needle_length);
+}
+
+
+
+#ifdef LINE_FILTER_X86
+//******************************************************************************
+// Name:    _search_sse2
+// Notes:   Compare 16 positions at once against the needle's first byte and,
+//          needle_length - 1 further on, its last byte.  Only positions where
+//          both match get a memcmp.  What's left at the end goes to memmem.
+//
+//******************************************************************************
+__attribute__((target("sse2")))
+static const char *_search_sse2(const char *data, size_t length, const char *needle, size_t needle_length)
+{
+    __m128i first;
+    __m128i last;
+    unsigned int mask;
+    size_t i = 0;
+    int bit;
+
+    if(needle_length < 2)
+    {
+        return _search_scalar(data, length, needle, needle_length);
+    }
+    first = _mm_set1_epi8(needle[0]);
+    last = _mm_set1_epi8(needle[needle_length - 1]);
+
+    while(i + needle_length - 1 + 16 <= length)
+    {
+        mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(
+                   _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i *)(data + i))),
+                   _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i *)(data + i + needle_length - 1)))));
+        while(mask != 0)
+        {
+            bit = __builtin_ctz(mask);
+            if(memcmp(data + i + bit + 1, needle + 1, needle_length - 2) == 0)
+            {
+                return data + i + bit;
+            }
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+    return _search_scalar(data + i, length - i, needle, needle_length);
+}
+
+
+
+//******************************************************************************
+// Name:    _search_avx2
+// Notes:   Same idea, 32 positions at a time
+//
+//******************************************************************************
+__attribute__((target("avx2")))
+static const char *_search_avx2(const char *data, size_t length, const char *needle, size_t needle_length)
+{
+    __m256i first;
+    __m256i last;
+    unsigned int mask;
+    size_t i = 0;
+    int bit;
+
+    if(needle_length < 2)
+    {
+        return _search_scalar(data, length, needle, needle_length);
+    }
+    first = _mm256_set1_epi8(needle[0]);
+    last = _mm256_set1_epi8(needle[needle_length - 1]);
+
+    while(i + needle_length - 1 + 32 <= length)
+    {
+        mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(
+                   _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i *)(data + i))),
+                   _mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i *)(data + i + needle_length - 1)))));
+        while(mask != 0)
+        {
+            bit = __builtin_ctz(mask);
+            if(memcmp(data + i + bit + 1, needle + 1, needle_length - 2) == 0)
+            {
+                return data + i + bit;
+            }
+            mask &= mask - 1;
+        }
+        i += 32;
+    }
+    return _search_scalar(data + i, length - i, needle, needle_length);
+}
+#endif
@@ -0,0 +1,53 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    line_filter.h
+// Notes:   header for the line_filter module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_LINE_FILTER_H__
+#define __TGREP_LINE_FILTER_H__
+
+#include <sys/types.h>
+
+#include "range_output.h"
+
+//-e adds a fixed string and --regex an extended regex.  a line is printed
+//when any of them match.  returns -1 (after complaining) if the pattern is
+//no good.
+int add_filter_literal(const char *pattern);
+int add_filter_regex(const char *pattern);
+
+//1 once there's at least one pattern
+int filter_enabled(void);
+
+//threads for filter_range, 0 (the default) means one per cpu
+void set_filter_threads(int thread_count);
+
+//writes every line in [start_offset, end_offset) that matches to out_fd,
+//each with its newline, in file order.  the log comes from mapping if the
+//whole thing is mapped, from reader otherwise.  returns the bytes written
+//or -1 if it couldn't get going at all.
+off_t filter_range(const char *mapping, range_reader reader, off_t start_offset, off_t end_offset, int out_fd);
+
+#endif
@@ -0,0 +1,249 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    line_filter_check.c
+// Notes:   Regression check for the --regex filter.  Every pattern is run
+//          through filter_range (literal prefilter and all) and through a
+//          plain regexec of each line, and the two have to pick out the
+//          same lines.  The patterns are the ones the prefilter has got
+//          wrong before, bracket expressions with classes and the like.
+//          Not part of tgrep itself, build and run it with
+//          "make line_filter_check && ./line_filter_check".
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <regex.h>
+#include <sys/wait.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "line_filter.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+#define CHECK_LINES             (4000)
+#define CHECK_LINE_SIZE         (128)
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+
+//every one of these has a '[' or a ']' inside a bracket expression, or
+//something else the prefilter has to step over
+static const char *check_patterns[] =
+{
+    "[[:digit:]qqqqqqqqqqqq]0",
+    "[[:alpha:]]qqqqqqqq",
+    "[[:space:]xyzxyzxyz]7",
+    "[^[:digit:]]qqqqqqqq1",
+    "[[=a=]bbbbbbbbbb]c",
+    "[[.-.]zzzzzzzz]3",
+    "[]abcdefghij]0",
+    "[^]qqqqqqqq]1$",
+    "[[:digit:]]+ \\| Thi[s]",
+    "line (number)+ 0+[1-9]",
+    "qqq[[:digit:]]{2}",
+    "[a[:upper:]]eb  ?9"
+};
+
+#define CHECK_PATTERN_COUNT ((int)(sizeof(check_patterns) / sizeof(check_patterns[0])))
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static char *_make_lines(size_t *length);
+static long long int _count_regexec(const char *pattern, const char *data, size_t length);
+static long long int _count_filter(const char *pattern, const char *data, size_t length);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    main
+// Notes:   Exits 1 if any pattern disagrees
+//
+//******************************************************************************
+int main(void)
+{
+    long long int expected;
+    long long int got;
+    size_t length;
+    char *data = _make_lines(&length);
+    int failures = 0;
+    int i;
+
+    if(data == NULL)
+    {
+        fprintf(stderr, "Could not make the test lines.\n");
+        return 1;
+    }
+
+    for(i = 0; i < CHECK_PATTERN_COUNT; i++)
+    {
+        expected = _count_regexec(check_patterns[i], data, length);
+        got = _count_filter(check_patterns[i], data, length);
+        printf("%-32s regexec %6lld  filter %6lld  %s\n", check_patterns[i], expected, got,
+               (expected == got) ? "ok" : "FAIL");
+        failures += (expected != got);
+    }
+    free(data);
+    printf("%d patterns, %d failures\n", CHECK_PATTERN_COUNT, failures);
+    return failures ? 1 : 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _make_lines
+// Notes:   haproxy looking lines, with some of the odd characters the
+//          patterns are after sprinkled in
+//
+//******************************************************************************
+static char *_make_lines(size_t *length)
+{
+    static const char *extras[] = {"", "qqqqqqqqqqqq0", "]qqqqqqqq1", "Aeb 9", "-zzzzzzzz3", "Xqqqqqqqq", "bbbbbbbbbbc", " 7", "j0", "qqq42"};
+    char *data = malloc((size_t)CHECK_LINES * CHECK_LINE_SIZE);
+    size_t used = 0;
+    int i;
+
+    if(data == NULL)
+    {
+        return NULL;
+    }
+    for(i = 0; i < CHECK_LINES; i++)
+    {
+        used += (size_t)snprintf(data + used, CHECK_LINE_SIZE, "Feb  9 06:%02d:%02d  | 10.0.%d.%d | This is line number %d %s\n",
+                                 (i / 60) % 60, i % 60, i % 256, (i * 7) % 256, i, extras[(i * 13) % 10]);
+    }
+    *length = used;
+    return data;
+}
+
+
+
+//******************************************************************************
+// Name:    _count_regexec
+// Notes:   The answer, one regexec a line
+//
+//******************************************************************************
+static long long int _count_regexec(const char *pattern, const char *data, size_t length)
+{
+    long long int count = 0;
+    const char *line = data;
+    const char *end = data + length;
+    const char *eol;
+    char text[CHECK_LINE_SIZE];
+    regex_t regex;
+
+    if(regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB | REG_NEWLINE) != 0)
+    {
+        return -1;
+    }
+    while(line < end)
+    {
+        eol = memchr(line, '\n', (size_t)(end - line));
+        memcpy(text, line, (size_t)(eol - line));
+        text[eol - line] = '\0';
+        count += (regexec(&regex, text, 0, NULL, 0) == 0);
+        line = eol + 1;
+    }
+    regfree(&regex);
+    return count;
+}
+
+
+
+//******************************************************************************
+// Name:    _count_filter
+// Notes:   There's no taking a pattern back out of the filter, so each one
+//          runs in a child that writes the matches down a pipe
+//
+//******************************************************************************
+static long long int _count_filter(const char *pattern, const char *data, size_t length)
+{
+    long long int count = 0;
+    char buffer[65536];
+    ssize_t got;
+    ssize_t i;
+    int pipe_fds[2];
+    int status;
+    pid_t child;
+
+    if(pipe(pipe_fds) != 0)
+    {
+        return -1;
+    }
+    child = fork();
+    if(child < 0)
+    {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
+    }
+    if(child == 0)
+    {
+        close(pipe_fds[0]);
+        set_filter_threads(1);
+        if(add_filter_regex(pattern) < 0 || filter_range(data, NULL, 0, (off_t)length, pipe_fds[1]) < 0)
+        {
+            _exit(1);
+        }
+        _exit(0);
+    }
+
+    close(pipe_fds[1]);
+    while((got = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+    {
+        for(i = 0; i < got; i++)
+        {
+            count += (buffer[i] == '\n');
+        }
+    }
+    close(pipe_fds[0]);
+    if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+    return count;
+}
@@ -0,0 +1,377 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    line_scan.c
+// Notes:   The inner loop of everything that walks the log: split a buffer
+//          into lines and pull the stamp out of each one.  The vector
+//          versions find every newline in 64 bytes at a time as a bit mask
+//          and then just pop bits, and check a whole stamp with a handful of
+//          byte compares instead of a branch per character (the stamp
+//          checks themselves live in log_format, one per layout).  Which
+//          version runs is decided once, at run time, from what the cpu says
+//          it can do, so the same binary still runs on boxes without AVX2.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LINE_SCAN_X86
+#include <immintrin.h>
+#endif
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "line_scan.h"
+#include "log_format.h"
+#include "parse_time.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//how much the vector kernels look at per step, one bit per byte
+#define LINE_SCAN_BLOCK     (64)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+typedef uint64_t (*newline_mask_function)(const char *block);
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static line_scan_isa selected_isa = LINE_SCAN_SCALAR;
+static newline_mask_function newline_mask = NULL;
+static int vector_stamps = 0;
+
+//the index builder calls in from several threads at once
+static pthread_once_t isa_once = PTHREAD_ONCE_INIT;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void _choose_isa(void);
+static int _scan_scalar(const char *data, size_t length, scanned_line *lines, int max_lines, size_t *consumed,
+                        log_stamp_function check_stamp);
+static int _scan_vector(const char *data, size_t length, scanned_line *lines, int max_lines, size_t *consumed,
+                        log_stamp_function check_stamp);
+static void _set_line(scanned_line *line, const char *data, size_t length, size_t start, size_t line_length, int has_newline,
+                      log_stamp_function check_stamp);
+
+#ifdef LINE_SCAN_X86
+static uint64_t _newline_mask_sse2(const char *block);
+static uint64_t _newline_mask_avx2(const char *block);
+#endif
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    scan_log_lines
+// Notes:   Hands off to whichever kernel got picked, with the stamp check
+//          for the log's format
+//
+//******************************************************************************
+int scan_log_lines(const char *data, size_t length, scanned_line *lines, int max_lines, size_t *consumed)
+{
+    log_stamp_function check_stamp;
+
+    pthread_once(&isa_once, _choose_isa);
+    check_stamp = get_log_stamp_function(get_log_format(), vector_stamps);
+
+    if(newline_mask != NULL)
+    {
+        return _scan_vector(data, length, lines, max_lines, consumed, check_stamp);
+    }
+    return _scan_scalar(data, length, lines, max_lines, consumed, check_stamp);
+}
+
+
+
+//******************************************************************************
+// Name:    set_line_scan_isa
+// Notes:   Mostly for the benchmark.  Not something to flip while another
+//          thread is scanning.
+//
+//******************************************************************************
+int set_line_scan_isa(line_scan_isa isa)
+{
+    pthread_once(&isa_once, _choose_isa);
+
+    switch(isa)
+    {
+    case LINE_SCAN_SCALAR:
+        newline_mask = NULL;
+        vector_stamps = 0;
+        break;
+#ifdef LINE_SCAN_X86
+    case LINE_SCAN_SSE2:
+        if(!__builtin_cpu_supports("sse2"))
+        {
+            return 0;
+        }
+        newline_mask = _newline_mask_sse2;
+        vector_stamps = 1;
+        break;
+    case LINE_SCAN_AVX2:
+        if(!__builtin_cpu_supports("avx2"))
+        {
+            return 0;
+        }
+        newline_mask = _newline_mask_avx2;
+        vector_stamps = 1;
+        break;
+#endif
+    default:
+        return 0;
+    }
+    selected_isa = isa;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    get_line_scan_isa
+// Notes:   The kernel in use
+//
+//******************************************************************************
+line_scan_isa get_line_scan_isa(void)
+{
+    pthread_once(&isa_once, _choose_isa);
+    return selected_isa;
+}
+
+
+
+//******************************************************************************
+// Name:    get_line_scan_isa_name
+// Notes:   For -v, --stats and the benchmark
+//
+//******************************************************************************
+const char *get_line_scan_isa_name(line_scan_isa isa)
+{
+    switch(isa)
+    {
+    case LINE_SCAN_SSE2:
+        return "sse2";
+    case LINE_SCAN_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _choose_isa
+// Notes:   Best thing the cpu has
+//
+//******************************************************************************
+static void _choose_isa(void)
+{
+    newline_mask = NULL;
+    vector_stamps = 0;
+    selected_isa = LINE_SCAN_SCALAR;
+
+#ifdef LINE_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        newline_mask = _newline_mask_avx2;
+        vector_stamps = 1;
+        selected_isa = LINE_SCAN_AVX2;
+    }
+    else if(__builtin_cpu_supports("sse2"))
+    {
+        newline_mask = _newline_mask_sse2;
+        vector_stamps = 1;
+        selected_isa = LINE_SCAN_SSE2;
+    }
+#endif
+}
+
+
+
+//******************************************************************************
+// Name:    _scan_scalar
+// Notes:   The plain version, memchr from one line to the next
+//
+//******************************************************************************
+static int _scan_scalar(const char *data, size_t length, scanned_line *lines, int max_lines, size_t *consumed,
+                        log_stamp_function check_stamp)
+{
+    size_t line_start = 0;
+    const char *eol;
+    int count = 0;
+
+    while(count < max_lines && line_start < length)
+    {
+        eol = memchr(data + line_start, '\n', length - line_start);
+        if(eol == NULL)
+        {
+            _set_line(&lines[count++], data, length, line_start, length - line_start, 0, check_stamp);
+            line_start = length;
+            break;
+        }
+        _set_line(&lines[count++], data, length, line_start, (size_t)(eol - data) - line_start, 1, check_stamp);
+        line_start = (size_t)(eol - data) + 1;
+    }
+    *consumed = line_start;
+    return count;
+}
+
+
+
+//******************************************************************************
+// Name:    _scan_vector
+// Notes:   Gets the newlines for a whole block as a mask, then every set bit
+//          ends a line.  The last partial block goes through a zero padded
+//          copy so the kernels never read past the end of the buffer.
+//
+//******************************************************************************
+static int _scan_vector(const char *data, size_t length, scanned_line *lines, int max_lines, size_t *consumed,
+                        log_stamp_function check_stamp)
+{
+    char tail[LINE_SCAN_BLOCK];
+    size_t line_start = 0;
+    size_t block;
+    size_t position;
+    uint64_t mask;
+    int count = 0;
+
+    for(block = 0; block < length && count < max_lines; block += LINE_SCAN_BLOCK)
+    {
+        if(length - block >= LINE_SCAN_BLOCK)
+        {
+            mask = newline_mask(data + block);
+        }
+        else
+        {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + block, length - block);
+            mask = newline_mask(tail);
+        }
+
+        while(mask != 0)
+        {
+            if(count == max_lines)
+            {
+                *consumed = line_start;
+                return count;
+            }
+            position = block + (size_t)__builtin_ctzll(mask);
+            mask &= mask - 1;
+            _set_line(&lines[count++], data, length, line_start, position - line_start, 1, check_stamp);
+            line_start = position + 1;
+        }
+    }
+
+    if(count < max_lines && line_start < length)
+    {
+        _set_line(&lines[count++], data, length, line_start, length - line_start, 0, check_stamp);
+        line_start = length;
+    }
+    *consumed = line_start;
+    return count;
+}
+
+
+
+//******************************************************************************
+// Name:    _set_line
+// Notes:   Fills in one line, stamp included.  The stamp check gets to look
+//          past the end of the line (but not the buffer), the vector ones
+//          like 16 or 32 bytes.
+//
+//******************************************************************************
+static void _set_line(scanned_line *line, const char *data, size_t length, size_t start, size_t line_length, int has_newline,
+                      log_stamp_function check_stamp)
+{
+    line->start = start;
+    line->length = line_length;
+    line->has_newline = has_newline;
+    if(!check_stamp(data + start, line_length, length - start, &line->time))
+    {
+        line->time = EPOCH_TIME_NONE;
+    }
+}
+
+
+
+#ifdef LINE_SCAN_X86
+//******************************************************************************
+// Name:    _newline_mask_sse2
+// Notes:   Four 16 byte compares glued into one 64 bit mask
+//
+//******************************************************************************
+__attribute__((target("sse2")))
+static uint64_t _newline_mask_sse2(const char *block)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t mask0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)block), newline));
+    uint64_t mask1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 16)), newline));
+    uint64_t mask2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 32)), newline));
+    uint64_t mask3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 48)), newline));
+    return mask0 | (mask1 << 16) | (mask2 << 32) | (mask3 << 48);
+}
+
+
+
+//******************************************************************************
+// Name:    _newline_mask_avx2
+// Notes:   Same thing, two 32 byte compares
+//
+//******************************************************************************
+__attribute__((target("avx2")))
+static uint64_t _newline_mask_avx2(const char *block)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    uint64_t low = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)block), newline));
+    uint64_t high = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(block + 32)), newline));
+    return low | (high << 32);
+}
+#endif
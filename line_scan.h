@@ -0,0 +1,68 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    line_scan.h
+// Notes:   header for the line_scan module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_LINE_SCAN_H__
+#define __TGREP_LINE_SCAN_H__
+
+#include <stddef.h>
+
+#include "parse_time.h"
+
+//one line out of a buffer.  time is what its stamp says, in whatever layout
+//the log is (see log_format), or EPOCH_TIME_NONE when it hasn't got one.
+struct _scanned_line {
+    size_t start;
+    size_t length;
+    int has_newline;
+    epoch_time time;
+};
+
+typedef struct _scanned_line scanned_line;
+
+//the instruction sets the kernel knows.  the best one the cpu supports is
+//picked on first use.
+typedef enum
+{
+    LINE_SCAN_SCALAR = 0,
+    LINE_SCAN_SSE2,
+    LINE_SCAN_AVX2
+} line_scan_isa;
+
+//splits data into lines starting at data[0] and checks/parses each one's
+//stamp, up to max_lines at a time.  a last line with no newline is handed
+//back too (has_newline = 0), callers that expect more data can leave it for
+//later.  consumed is how far the returned lines reach.  returns the number
+//of lines.
+int scan_log_lines(const char *data, size_t length, scanned_line *lines, int max_lines, size_t *consumed);
+
+//force a particular kernel, for benchmarking.  returns 0 if this cpu (or
+//build) can't run it.
+int set_line_scan_isa(line_scan_isa isa);
+line_scan_isa get_line_scan_isa(void);
+const char *get_line_scan_isa_name(line_scan_isa isa);
+
+#endif
@@ -0,0 +1,337 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    line_scan_bench.c
+// Notes:   Microbenchmark for the line_scan kernels.  Runs the old per line
+//          loop (memchr, is_valid_log_time, parse_log_time) and every kernel
+//          this cpu can run over the same buffer, checks they all agree and
+//          prints the throughput.  Logs in the other formats (see
+//          log_format) get the per line parse_log_line_time as the baseline.
+//          Not part of tgrep itself, build it with "make line_scan_bench".
+//
+//          usage: line_scan_bench [LOG_FILE] [PASSES]
+//          without a file it makes up 64MB of haproxy looking lines.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "parse_time.h"
+#include "line_scan.h"
+#include "log_format.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+#define BENCH_SYNTHETIC_SIZE    (64*1024*1024)
+#define BENCH_DEFAULT_PASSES    (5)
+#define BENCH_BATCH             (256)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//what a pass found, every method has to come up with the same thing
+struct _bench_result {
+    long long int lines;
+    long long int stamped;
+    long long int time_sum;
+};
+
+typedef struct _bench_result bench_result;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static char *_load_file(const char *path, size_t *length);
+static char *_make_synthetic(size_t *length);
+static double _now(void);
+static void _baseline_pass(char *data, size_t length, bench_result *result);
+static void _line_scan_pass(char *data, size_t length, bench_result *result);
+static void _report(const char *name, double seconds, size_t length, bench_result *result, bench_result *expected);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    main
+// Notes:   Best of PASSES for each method
+//
+//******************************************************************************
+int main(int argc, char **argv)
+{
+    line_scan_isa isas[] = {LINE_SCAN_SCALAR, LINE_SCAN_SSE2, LINE_SCAN_AVX2};
+    bench_result expected;
+    bench_result result;
+    size_t length;
+    double best;
+    double start;
+    char *data;
+    int passes = BENCH_DEFAULT_PASSES;
+    int pass;
+    int i;
+
+    data = (argc > 1) ? _load_file(argv[1], &length) : _make_synthetic(&length);
+    if(data == NULL)
+    {
+        fprintf(stderr, "Could not load the test data.\n");
+        return 1;
+    }
+    if(argc > 2 && atoi(argv[2]) > 0)
+    {
+        passes = atoi(argv[2]);
+    }
+    if(!start_log_format(data, length, time(NULL)))
+    {
+        fprintf(stderr, "The test data doesn't start with a stamp.\n");
+        free(data);
+        return 1;
+    }
+    printf("%zu bytes of %s lines, best of %d passes\n", length, get_log_format_name(get_log_format()), passes);
+
+    best = 0;
+    for(pass = 0; pass < passes; pass++)
+    {
+        start = _now();
+        _baseline_pass(data, length, &expected);
+        if(pass == 0 || _now() - start < best)
+        {
+            best = _now() - start;
+        }
+    }
+    _report("baseline", best, length, &expected, &expected);
+
+    for(i = 0; i < (int)(sizeof(isas) / sizeof(isas[0])); i++)
+    {
+        if(!set_line_scan_isa(isas[i]))
+        {
+            printf("%-10s not supported here\n", get_line_scan_isa_name(isas[i]));
+            continue;
+        }
+        best = 0;
+        for(pass = 0; pass < passes; pass++)
+        {
+            start = _now();
+            _line_scan_pass(data, length, &result);
+            if(pass == 0 || _now() - start < best)
+            {
+                best = _now() - start;
+            }
+        }
+        _report(get_line_scan_isa_name(isas[i]), best, length, &result, &expected);
+    }
+
+    free(data);
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _load_file
+// Notes:   Reads the whole thing in
+//
+//******************************************************************************
+static char *_load_file(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    char *data;
+    long size;
+
+    if(file == NULL)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = (size > 0) ? malloc((size_t)size) : NULL;
+    if(data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size)
+    {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    *length = (size_t)size;
+    return data;
+}
+
+
+
+//******************************************************************************
+// Name:    _make_synthetic
+// Notes:   A couple of lines a second over two days, with the odd line that
+//          has no stamp so the reject path gets some exercise too.
+//
+//******************************************************************************
+static char *_make_synthetic(size_t *length)
+{
+    char *data = malloc(BENCH_SYNTHETIC_SIZE + 256);
+    size_t used = 0;
+    long long int line = 0;
+    int seconds;
+
+    if(data == NULL)
+    {
+        return NULL;
+    }
+    srand(1);
+    while(used < BENCH_SYNTHETIC_SIZE)
+    {
+        seconds = (int)((line / 2) % (2 * 86400));
+        if(line % 97 == 96)
+        {
+            used += (size_t)sprintf(data + used, "    continuation of the last request, no stamp here\n");
+        }
+        else
+        {
+            used += (size_t)sprintf(data + used, "Feb %2d %02d:%02d:%02d  | %d.%d.%d.%d | GET /some/path?id=%d HTTP/1.1 %d\n",
+                                    9 + seconds / 86400, (seconds / 3600) % 24, (seconds / 60) % 60, seconds % 60,
+                                    rand() % 256, rand() % 256, rand() % 256, rand() % 256, rand(), 200 + rand() % 4);
+        }
+        line++;
+    }
+    *length = used;
+    return data;
+}
+
+
+
+//******************************************************************************
+// Name:    _now
+// Notes:   Monotonic seconds
+//
+//******************************************************************************
+static double _now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+
+//******************************************************************************
+// Name:    _baseline_pass
+// Notes:   What parse_times_around_offset used to do for every line
+//
+//******************************************************************************
+static void _baseline_pass(char *data, size_t length, bench_result *result)
+{
+    size_t position = 0;
+    const char *eol;
+    size_t line_length;
+    epoch_time time;
+    int syslog_stamps = (get_log_format() == LOG_FORMAT_SYSLOG);
+
+    memset(result, 0, sizeof(*result));
+    while(position < length)
+    {
+        eol = memchr(data + position, '\n', length - position);
+        line_length = (eol == NULL) ? length - position : (size_t)(eol - (data + position));
+        result->lines++;
+        if(syslog_stamps ? (is_valid_log_time(data + position, line_length) &&
+                            parse_log_time(data + position, line_length, &time)) :
+                           parse_log_line_time(data + position, line_length, &time))
+        {
+            result->stamped++;
+            result->time_sum += time;
+        }
+        position += line_length + 1;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _line_scan_pass
+// Notes:   The same walk through scan_log_lines
+//
+//******************************************************************************
+static void _line_scan_pass(char *data, size_t length, bench_result *result)
+{
+    scanned_line lines[BENCH_BATCH];
+    size_t position = 0;
+    size_t consumed;
+    int count;
+    int i;
+
+    memset(result, 0, sizeof(*result));
+    while(position < length)
+    {
+        count = scan_log_lines(data + position, length - position, lines, BENCH_BATCH, &consumed);
+        if(count == 0)
+        {
+            break;
+        }
+        for(i = 0; i < count; i++)
+        {
+            result->lines++;
+            if(lines[i].time != EPOCH_TIME_NONE)
+            {
+                result->stamped++;
+                result->time_sum += lines[i].time;
+            }
+        }
+        position += consumed;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _report
+// Notes:   One line per method
+//
+//******************************************************************************
+static void _report(const char *name, double seconds, size_t length, bench_result *result, bench_result *expected)
+{
+    int agrees = (result->lines == expected->lines && result->stamped == expected->stamped &&
+                  result->time_sum == expected->time_sum);
+
+    printf("%-10s %8.1f MB/s %8.2f ns/line  %lld lines, %lld stamped%s\n", name,
+           (double)length / seconds / (1024.0 * 1024.0), seconds * 1e9 / (double)result->lines,
+           result->lines, result->stamped, agrees ? "" : "  MISMATCH");
+}
@@ -0,0 +1,616 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    log_format.c
+// Notes:   Where a line's stamp is and how to read it, for every layout of log
+//          tgrep knows.  A layout is one line of LOG_FORMAT_LAYOUTS: how to
+//          find the stamp, a template of it and the offsets of its fields.
+//          The macros at the bottom turn each one into its own check and
+//          parse routines (scalar and SSE2) with the template's character
+//          classes worked out at compile time, so nothing gets interpreted
+//          per line and the syslog one is the same handful of compares the
+//          hard coded version was.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LOG_FORMAT_X86
+#include <immintrin.h>
+#endif
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "log_format.h"
+#include "parse_time.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//how a layout finds its stamp: at the start of the line, after an RFC 5424
+//"<pri>version " or just inside the first '[' near the front
+#define LAYOUT_AT_START     (0)
+#define LAYOUT_AFTER_PRI    (1)
+#define LAYOUT_IN_BRACKET   (2)
+#define LAYOUT_BRACKET_SEARCH (128)
+
+//templates are at most this long, one bit per character in the masks
+#define LAYOUT_MAX          (32)
+
+//every layout, in log_format order.  in a template 'a' is any letter, '0'
+//any digit, '_' a blank or a digit, anything else has to be just that.
+//the offsets are into the template, -1 for fields the layout doesn't have.
+//a month that's 'a's in the template is a name, otherwise a number.
+//fraction is where a ".fff" (or ",fff") can follow the seconds.
+//
+//        id       locate             template                 year mon day hour min sec frac
+#define LOG_FORMAT_LAYOUTS(X) \
+        X(syslog,  LAYOUT_AT_START,   "aaa _0 00:00:00",       -1,  0,  4,  7,  10, 13, -1) \
+        X(iso8601, LAYOUT_AT_START,   "0000-00-00T00:00:00",    0,  5,  8,  11, 14, 17, 19) \
+        X(rfc5424, LAYOUT_AFTER_PRI,  "0000-00-00T00:00:00",    0,  5,  8,  11, 14, 17, 19) \
+        X(nginx,   LAYOUT_IN_BRACKET, "00/aaa/0000:00:00:00",   7,  3,  0,  12, 15, 18, -1)
+
+//the compile time half: a template's length, its characters (0 past the
+//end) and a mask of where it has a given character.  all of these fold
+//down to constants.
+#define TEMPLATE_LENGTH(t)      (sizeof(t) - 1)
+#define TEMPLATE_CHAR(t, i)     (((size_t)(i) < TEMPLATE_LENGTH(t)) ? (t)[(size_t)(i) % sizeof(t)] : '\0')
+#define TEMPLATE_BIT(t, c, i)   ((uint32_t)(TEMPLATE_CHAR(t, i) == (c)) << (i))
+#define TEMPLATE_BITS4(t, c, i) (TEMPLATE_BIT(t, c, i) | TEMPLATE_BIT(t, c, (i) + 1) | \
+                                 TEMPLATE_BIT(t, c, (i) + 2) | TEMPLATE_BIT(t, c, (i) + 3))
+#define TEMPLATE_BITS(t, c)     (TEMPLATE_BITS4(t, c, 0) | TEMPLATE_BITS4(t, c, 4) | TEMPLATE_BITS4(t, c, 8) | \
+                                 TEMPLATE_BITS4(t, c, 12) | TEMPLATE_BITS4(t, c, 16) | TEMPLATE_BITS4(t, c, 20) | \
+                                 TEMPLATE_BITS4(t, c, 24) | TEMPLATE_BITS4(t, c, 28))
+#define TEMPLATE_ALL_BITS(t)    ((uint32_t)((1ULL << TEMPLATE_LENGTH(t)) - 1))
+#define TEMPLATE_LITERAL_BITS(t) (TEMPLATE_ALL_BITS(t) & \
+                                  ~(TEMPLATE_BITS(t, 'a') | TEMPLATE_BITS(t, '0') | TEMPLATE_BITS(t, '_')))
+
+#define IS_DIGIT(x) ((unsigned char)((x) - '0') <= 9)
+#define DIGITS2(p) (((p)[0] - '0') * 10 + ((p)[1] - '0'))
+#define DIGITS4(p) (DIGITS2(p) * 100 + DIGITS2((p) + 2))
+
+//lines looked at to pick a format
+#define LOG_FORMAT_DETECT_LINES (64)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static log_format current_format = LOG_FORMAT_SYSLOG;
+static int forced_format = -1;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static log_format _detect_log_format(const char *data, size_t length);
+static inline const char *_locate_stamp(const char *line, size_t line_length, int locate, size_t length);
+static inline const char *_skip_priority(const char *line, size_t line_length);
+static inline int _match_scalar(const char *stamp, const char *literal, size_t length,
+                                uint32_t alpha_bits, uint32_t digit_bits, uint32_t blank_bits, uint32_t literal_bits);
+static inline int _read_stamp(const char *stamp, const char *line_end, int month_name, int year_at, int month_at,
+                              int day_at, int hour_at, int minute_at, int second_at, int fraction_at, epoch_time *time);
+static inline epoch_time _read_fraction(const char *text, const char *end);
+
+#ifdef LOG_FORMAT_X86
+static inline int _match_sse2(const char *stamp, const char *literal, size_t length,
+                              uint32_t alpha_bits, uint32_t digit_bits, uint32_t blank_bits, uint32_t literal_bits);
+#endif
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    _locate_stamp
+// Notes:   Where the stamp starts, or NULL if there's no room for one.
+//          locate is always a constant, so only one case survives in each
+//          layout's routine.
+//
+//******************************************************************************
+static inline __attribute__((always_inline)) const char *_locate_stamp(const char *line, size_t line_length, int locate, size_t length)
+{
+    const char *stamp;
+
+    switch(locate)
+    {
+    case LAYOUT_AFTER_PRI:
+        stamp = _skip_priority(line, line_length);
+        break;
+    case LAYOUT_IN_BRACKET:
+        stamp = memchr(line, '[', (line_length < LAYOUT_BRACKET_SEARCH) ? line_length : LAYOUT_BRACKET_SEARCH);
+        if(stamp != NULL)
+        {
+            stamp++;
+        }
+        break;
+    default:
+        stamp = line;
+        break;
+    }
+
+    if(stamp == NULL || (size_t)(line + line_length - stamp) < length)
+    {
+        return NULL;
+    }
+    return stamp;
+}
+
+
+
+//******************************************************************************
+// Name:    _skip_priority
+// Notes:   "<pri>version " in front of an RFC 5424 stamp, pri is 1-3 digits
+//          and the version 1-2.
+//
+//******************************************************************************
+static inline const char *_skip_priority(const char *line, size_t line_length)
+{
+    size_t i = 1;
+    size_t start;
+
+    if(line_length < 4 || line[0] != '<')
+    {
+        return NULL;
+    }
+    while(i < 4 && i < line_length && IS_DIGIT(line[i]))
+    {
+        i++;
+    }
+    if(i == 1 || i >= line_length || line[i] != '>')
+    {
+        return NULL;
+    }
+    start = ++i;
+    while(i < start + 2 && i < line_length && IS_DIGIT(line[i]))
+    {
+        i++;
+    }
+    if(i == start || i >= line_length || line[i] != ' ')
+    {
+        return NULL;
+    }
+    return line + i + 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _match_scalar
+// Notes:   Builds a mask per kind of character one byte at a time, then the
+//          layout's masks say which bytes had to be what.
+//
+//******************************************************************************
+static inline __attribute__((always_inline)) int _match_scalar(const char *stamp, const char *literal, size_t length,
+                                                              uint32_t alpha_bits, uint32_t digit_bits, uint32_t blank_bits, uint32_t literal_bits)
+{
+    uint32_t alpha = 0;
+    uint32_t space = 0;
+    uint32_t digit = 0;
+    uint32_t same = 0;
+    unsigned char c;
+    size_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        c = (unsigned char)stamp[i];
+        alpha |= (uint32_t)((unsigned char)((c | 0x20) - 'a') <= 25) << i;
+        space |= (uint32_t)(c == ' ') << i;
+        digit |= (uint32_t)IS_DIGIT(c) << i;
+        same |= (uint32_t)(c == (unsigned char)literal[i]) << i;
+    }
+    return (alpha & alpha_bits) == alpha_bits &&
+           (digit & digit_bits) == digit_bits &&
+           ((space | digit) & blank_bits) == blank_bits &&
+           (same & literal_bits) == literal_bits;
+}
+
+
+
+//******************************************************************************
+// Name:    _read_stamp
+// Notes:   Only ever called on a stamp that matched its template, so every
+//          digit is a digit.  The letters only had to be letters, this is
+//          where it turns out whether they're a month.  Stamps without a
+//          year get theirs from the table set_log_time_start filled in.
+//
+//******************************************************************************
+static inline __attribute__((always_inline)) int _read_stamp(const char *stamp, const char *line_end, int month_name, int year_at,
+                                                            int month_at, int day_at, int hour_at, int minute_at, int second_at,
+                                                            int fraction_at, epoch_time *time)
+{
+    int clock = DIGITS2(stamp + hour_at) * 3600 + DIGITS2(stamp + minute_at) * 60 + DIGITS2(stamp + second_at);
+    int month = month_name ? parse_log_month(stamp + month_at) : DIGITS2(stamp + month_at) - 1;
+    int day = ((stamp[day_at] == ' ') ? 0 : (stamp[day_at] - '0') * 10) + (stamp[day_at + 1] - '0');
+
+    if(month < 0 || month > 11)
+    {
+        return 0;
+    }
+    if(year_at < 0)
+    {
+        *time = combine_log_time(month, day, clock);
+        return 1;
+    }
+    if(day < 1 || day > 31)
+    {
+        return 0;
+    }
+    *time = combine_dated_log_time(DIGITS4(stamp + year_at), month, day, clock);
+    if(fraction_at >= 0)
+    {
+        *time += _read_fraction(stamp + fraction_at, line_end);
+    }
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _read_fraction
+// Notes:   The milliseconds of a ".fff" after the seconds, any digits past
+//          three don't matter.
+//
+//******************************************************************************
+static inline epoch_time _read_fraction(const char *text, const char *end)
+{
+    epoch_time milliseconds = 0;
+    epoch_time scale = EPOCH_TIME_PER_SECOND / 10;
+
+    if(text >= end || (*text != '.' && *text != ','))
+    {
+        return 0;
+    }
+    for(text++; text < end && scale > 0 && IS_DIGIT(*text); text++)
+    {
+        milliseconds += (*text - '0') * scale;
+        scale /= 10;
+    }
+    return milliseconds;
+}
+
+
+
+#ifdef LOG_FORMAT_X86
+//******************************************************************************
+// Name:    _match_sse2
+// Notes:   Same masks, 16 bytes at a time.  Unsigned min trick for the
+//          ranges: x - lo is in range exactly when min(x - lo, hi - lo)
+//          leaves it alone.  The caller makes sure there are 16 (or 32 for
+//          the long templates) bytes to read.
+//
+//******************************************************************************
+__attribute__((target("sse2")))
+static inline __attribute__((always_inline)) int _match_sse2(const char *stamp, const char *literal, size_t length,
+                                                            uint32_t alpha_bits, uint32_t digit_bits, uint32_t blank_bits, uint32_t literal_bits)
+{
+    uint32_t alpha = 0;
+    uint32_t space = 0;
+    uint32_t digit = 0;
+    uint32_t same = 0;
+    size_t half;
+
+    for(half = 0; half < length; half += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(stamp + half));
+        __m128i digits = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+        __m128i letters = _mm_sub_epi8(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+
+        digit |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits)) << half;
+        alpha |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(25)), letters)) << half;
+        space |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '))) << half;
+        same |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_loadu_si128((const __m128i *)(literal + half)))) << half;
+    }
+    return (alpha & alpha_bits) == alpha_bits &&
+           (digit & digit_bits) == digit_bits &&
+           ((space | digit) & blank_bits) == blank_bits &&
+           (same & literal_bits) == literal_bits;
+}
+#endif
+
+
+
+//******************************************************************************
+// Name:    _check_<layout>_scalar / _check_<layout>_sse2
+// Notes:   One pair per line of LOG_FORMAT_LAYOUTS.  Everything about the
+//          layout goes in as a constant, so after inlining each one is its
+//          own straight line check.  The SSE2 one falls back to the scalar
+//          match when the buffer ends too close to read a whole vector.
+//
+//******************************************************************************
+#define LAYOUT_MATCH_ARGUMENTS(template) \
+    TEMPLATE_BITS(template, 'a'), TEMPLATE_BITS(template, '0'), TEMPLATE_BITS(template, '_'), TEMPLATE_LITERAL_BITS(template)
+
+#define LAYOUT_READ_ARGUMENTS(template, year, month, day, hour, minute, second, fraction) \
+    TEMPLATE_CHAR(template, month) == 'a', year, month, day, hour, minute, second, fraction
+
+#define LAYOUT_SCALAR_FUNCTION(id, locate, template, year, month, day, hour, minute, second, fraction) \
+static const char _##id##_literal[LAYOUT_MAX] = template; \
+static int _check_##id##_scalar(const char *line, size_t line_length, size_t available, epoch_time *time) \
+{ \
+    const char *stamp = _locate_stamp(line, line_length, locate, TEMPLATE_LENGTH(template)); \
+    (void)available; \
+    if(stamp == NULL || \
+       !_match_scalar(stamp, _##id##_literal, TEMPLATE_LENGTH(template), LAYOUT_MATCH_ARGUMENTS(template))) \
+    { \
+        return 0; \
+    } \
+    return _read_stamp(stamp, line + line_length, \
+                       LAYOUT_READ_ARGUMENTS(template, year, month, day, hour, minute, second, fraction), time); \
+}
+
+#define LAYOUT_SSE2_FUNCTION(id, locate, template, year, month, day, hour, minute, second, fraction) \
+__attribute__((target("sse2"))) \
+static int _check_##id##_sse2(const char *line, size_t line_length, size_t available, epoch_time *time) \
+{ \
+    const char *stamp = _locate_stamp(line, line_length, locate, TEMPLATE_LENGTH(template)); \
+    int matched; \
+    if(stamp == NULL) \
+    { \
+        return 0; \
+    } \
+    if((size_t)(line + available - stamp) >= ((TEMPLATE_LENGTH(template) + 15) & ~(size_t)15)) \
+    { \
+        matched = _match_sse2(stamp, _##id##_literal, TEMPLATE_LENGTH(template), LAYOUT_MATCH_ARGUMENTS(template)); \
+    } \
+    else \
+    { \
+        matched = _match_scalar(stamp, _##id##_literal, TEMPLATE_LENGTH(template), LAYOUT_MATCH_ARGUMENTS(template)); \
+    } \
+    if(!matched) \
+    { \
+        return 0; \
+    } \
+    return _read_stamp(stamp, line + line_length, \
+                       LAYOUT_READ_ARGUMENTS(template, year, month, day, hour, minute, second, fraction), time); \
+}
+
+#define LAYOUT_SCALAR_ENTRY(id, ...) _check_##id##_scalar,
+#define LAYOUT_SSE2_ENTRY(id, ...) _check_##id##_sse2,
+#define LAYOUT_NAME_ENTRY(id, ...) #id,
+#define LAYOUT_FRACTION_ENTRY(id, locate, template, year, month, day, hour, minute, second, fraction) ((fraction) >= 0),
+
+LOG_FORMAT_LAYOUTS(LAYOUT_SCALAR_FUNCTION)
+
+static const log_stamp_function scalar_functions[LOG_FORMAT_COUNT] = { LOG_FORMAT_LAYOUTS(LAYOUT_SCALAR_ENTRY) };
+static const char *format_names[LOG_FORMAT_COUNT] = { LOG_FORMAT_LAYOUTS(LAYOUT_NAME_ENTRY) };
+static const int format_fractions[LOG_FORMAT_COUNT] = { LOG_FORMAT_LAYOUTS(LAYOUT_FRACTION_ENTRY) };
+
+#ifdef LOG_FORMAT_X86
+LOG_FORMAT_LAYOUTS(LAYOUT_SSE2_FUNCTION)
+
+static const log_stamp_function sse2_functions[LOG_FORMAT_COUNT] = { LOG_FORMAT_LAYOUTS(LAYOUT_SSE2_ENTRY) };
+#endif
+
+
+
+//******************************************************************************
+// Name:    set_log_format_name
+// Notes:   For --format
+//
+//******************************************************************************
+int set_log_format_name(const char *name)
+{
+    int i;
+
+    if(strcmp(name, "auto") == 0)
+    {
+        forced_format = -1;
+        return 1;
+    }
+    for(i = 0; i < LOG_FORMAT_COUNT; i++)
+    {
+        if(strcmp(name, format_names[i]) == 0)
+        {
+            forced_format = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    get_forced_log_format
+// Notes:   -1 means auto
+//
+//******************************************************************************
+int get_forced_log_format(void)
+{
+    return forced_format;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_format
+// Notes:   The format start_log_format settled on
+//
+//******************************************************************************
+log_format get_log_format(void)
+{
+    return current_format;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_format_name
+// Notes:   For -v, --stats and --format
+//
+//******************************************************************************
+const char *get_log_format_name(log_format format)
+{
+    if((int)format < 0 || format >= LOG_FORMAT_COUNT)
+    {
+        return "unknown";
+    }
+    return format_names[format];
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_time_resolution
+// Notes:   Syslog and nginx stamps stop at the second, so a line stamped
+//          06:52:30 could be from any time in it
+//
+//******************************************************************************
+epoch_time get_log_time_resolution(void)
+{
+    if(get_log_time_field() == LOG_TIME_FIELD_ACCEPT || format_fractions[current_format])
+    {
+        return 1;
+    }
+    return EPOCH_TIME_PER_SECOND;
+}
+
+
+
+//******************************************************************************
+// Name:    start_log_format
+// Notes:   Syslog stamps also need the year table built from the first line,
+//          the others just need the first line to have a stamp.
+//
+//******************************************************************************
+int start_log_format(const char *data, size_t length, time_t reference)
+{
+    const char *eol;
+    size_t line_length;
+    epoch_time time;
+
+    if(data == NULL)
+    {
+        return 0;
+    }
+
+    current_format = (forced_format >= 0) ? (log_format)forced_format : _detect_log_format(data, length);
+    if(current_format == LOG_FORMAT_SYSLOG)
+    {
+        return set_log_time_start(data, length, reference);
+    }
+
+    eol = memchr(data, '\n', length);
+    line_length = (eol == NULL) ? length : (size_t)(eol - data);
+    return scalar_functions[current_format](data, line_length, line_length, &time);
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_stamp_function
+// Notes:   line_scan asks for this once per batch of lines
+//
+//******************************************************************************
+log_stamp_function get_log_stamp_function(log_format format, int vector)
+{
+#ifdef LOG_FORMAT_X86
+    if(vector)
+    {
+        return sse2_functions[format];
+    }
+#else
+    (void)vector;
+#endif
+    return scalar_functions[format];
+}
+
+
+
+//******************************************************************************
+// Name:    parse_log_line_time
+// Notes:   The scalar check, the line is all there is to read
+//
+//******************************************************************************
+int parse_log_line_time(const char *line, size_t length, epoch_time *time)
+{
+    return scalar_functions[current_format](line, length, length, time);
+}
+
+
+
+//******************************************************************************
+// Name:    _detect_log_format
+// Notes:   Every layout gets a go at the first lines of the log and the one
+//          that reads the most of them wins, syslog if nothing does (so
+//          the log gets turned down the same way it always was).  Syslog
+//          stamps come out of a year table that isn't built yet, but only
+//          whether they match matters here.
+//
+//******************************************************************************
+static log_format _detect_log_format(const char *data, size_t length)
+{
+    int counts[LOG_FORMAT_COUNT];
+    const char *eol;
+    size_t position = 0;
+    size_t line_length;
+    epoch_time time;
+    int best = LOG_FORMAT_SYSLOG;
+    int lines;
+    int i;
+
+    memset(counts, 0, sizeof(counts));
+    for(lines = 0; lines < LOG_FORMAT_DETECT_LINES && position < length; lines++)
+    {
+        eol = memchr(data + position, '\n', length - position);
+        line_length = (eol == NULL) ? length - position : (size_t)(eol - (data + position));
+        for(i = 0; i < LOG_FORMAT_COUNT; i++)
+        {
+            counts[i] += scalar_functions[i](data + position, line_length, line_length, &time);
+        }
+        position += line_length + 1;
+    }
+
+    for(i = 0; i < LOG_FORMAT_COUNT; i++)
+    {
+        if(counts[i] > counts[best])
+        {
+            best = i;
+        }
+    }
+    return (log_format)best;
+}
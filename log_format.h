@@ -0,0 +1,84 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    log_format.h
+// Notes:   header for the log_format module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_LOG_FORMAT_H__
+#define __TGREP_LOG_FORMAT_H__
+
+#include <stddef.h>
+#include <time.h>
+
+#include "parse_time.h"
+
+//the layouts of stamp tgrep can read.  the numbers end up in map files, so
+//new ones go on the end.
+//  syslog   "Feb  9 06:52:00 ..." at the start of the line, no year
+//  iso8601  "2026-02-09T06:52:00[.fff][zone] ..." at the start of the line
+//  rfc5424  "<34>1 2026-02-09T06:52:00[.fff][zone] ..."
+//  nginx    "1.2.3.4 - - [09/Feb/2026:06:52:00 +0000] ...", the first [...]
+//zones are ignored, every stamp is taken as the log's wall clock.
+typedef enum
+{
+    LOG_FORMAT_SYSLOG = 0,
+    LOG_FORMAT_ISO8601,
+    LOG_FORMAT_RFC5424,
+    LOG_FORMAT_NGINX,
+    LOG_FORMAT_COUNT
+} log_format;
+
+//checks one line for a stamp and gives back its time.  the line is
+//line_length bytes, but there are available bytes readable from line (at
+//least line_length) so the vector versions can look past its end.
+typedef int (*log_stamp_function)(const char *line, size_t line_length, size_t available, epoch_time *time);
+
+//"auto" (the default) works the format out from each log's first window,
+//anything else forces it.  returns 0 for a name it doesn't know.
+int set_log_format_name(const char *name);
+
+//the forced format, or -1 for auto
+int get_forced_log_format(void);
+
+//the format of the log that was opened last
+log_format get_log_format(void);
+const char *get_log_format_name(log_format format);
+
+//the finest step line times can show in the current format and time field,
+//1 with milliseconds or EPOCH_TIME_PER_SECOND when they stop at the second
+epoch_time get_log_time_resolution(void);
+
+//picks the format for a log from the window at its very start (or takes
+//the forced one) and gets the year guessing ready for syslog stamps, see
+//set_log_time_start.  returns 0 if the first line doesn't have a stamp.
+int start_log_format(const char *data, size_t length, time_t reference);
+
+//the check for a format, the SSE2 one if vector is set and it's built in
+log_stamp_function get_log_stamp_function(log_format format, int vector);
+
+//the time of one whole line in the current format, for code that walks
+//the log a line at a time
+int parse_log_line_time(const char *line, size_t length, epoch_time *time);
+
+#endif
@@ -0,0 +1,385 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    log_gen.c
+// Notes:   Writes synthetic_log logs for benchmarking, a lot faster than
+//          makelog.pl: the file is cut into chunks and every thread makes
+//          and writes whichever chunk is next.  With --virtual it only
+//          writes the spec, which tgrep reads as the whole log without it
+//          ever touching the disk.  Not part of tgrep itself, build it with
+//          "make log_gen".
+//
+//          usage: log_gen [--shape NAME] [--size N[KMGT]] [--start STAMP]
+//                         [--duration SECONDS] [--line-length N] [--seed N]
+//                         [-j THREADS] [--virtual] OUTPUT
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "synthetic_log.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+#define GEN_CHUNK_SIZE          (4*1024*1024)
+#define GEN_MAX_THREADS         (64)
+#define GEN_SPEC_MAX            (4096)
+
+#define OPTION_SHAPE            (256)
+#define OPTION_SIZE             (257)
+#define OPTION_START            (258)
+#define OPTION_DURATION         (259)
+#define OPTION_LINE_LENGTH      (260)
+#define OPTION_SEED             (261)
+#define OPTION_VIRTUAL          (262)
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static int output_fd = -1;
+static off_t output_size = 0;
+static off_t next_chunk = 0;
+static int write_failed = 0;
+static pthread_mutex_t chunk_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void _usage(void);
+static int _append_setting(char *text, size_t size, const char *key, const char *value);
+static void *_writer_thread(void *unused);
+static int _write_virtual(const char *path, const synthetic_spec *spec);
+static double _now(void);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    main
+// Notes:   The options are turned into spec text and parsed like a spec file
+//          would be, so the two can't disagree about what a setting means.
+//
+//******************************************************************************
+int main(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        {"shape",       required_argument, 0, OPTION_SHAPE},
+        {"size",        required_argument, 0, OPTION_SIZE},
+        {"start",       required_argument, 0, OPTION_START},
+        {"duration",    required_argument, 0, OPTION_DURATION},
+        {"line-length", required_argument, 0, OPTION_LINE_LENGTH},
+        {"seed",        required_argument, 0, OPTION_SEED},
+        {"virtual",     no_argument,       0, OPTION_VIRTUAL},
+        {"threads",     required_argument, 0, 'j'},
+        {"help",        no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    const char *shape = "uniform";
+    char settings[GEN_SPEC_MAX] = "";
+    char text[GEN_SPEC_MAX];
+    pthread_t threads[GEN_MAX_THREADS];
+    synthetic_spec spec;
+    int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int virtual_log = 0;
+    int ok = 1;
+    double start;
+    double seconds;
+    int option;
+    int i;
+
+    while((option = getopt_long(argc, argv, "j:h", long_options, NULL)) != -1)
+    {
+        switch(option)
+        {
+        case OPTION_SHAPE:
+            shape = optarg;
+            break;
+        case OPTION_SIZE:
+            ok = ok && _append_setting(settings, sizeof(settings), "size", optarg);
+            break;
+        case OPTION_START:
+            ok = ok && _append_setting(settings, sizeof(settings), "start", optarg);
+            break;
+        case OPTION_DURATION:
+            ok = ok && _append_setting(settings, sizeof(settings), "duration", optarg);
+            break;
+        case OPTION_LINE_LENGTH:
+            ok = ok && _append_setting(settings, sizeof(settings), "line_length", optarg);
+            break;
+        case OPTION_SEED:
+            ok = ok && _append_setting(settings, sizeof(settings), "seed", optarg);
+            break;
+        case OPTION_VIRTUAL:
+            virtual_log = 1;
+            break;
+        case 'j':
+            thread_count = atoi(optarg);
+            break;
+        default:
+            _usage();
+            return 1;
+        }
+    }
+    if(optind != argc - 1 || !ok)
+    {
+        _usage();
+        return 1;
+    }
+    if(thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    if(thread_count > GEN_MAX_THREADS)
+    {
+        thread_count = GEN_MAX_THREADS;
+    }
+
+    snprintf(text, sizeof(text), "%sshape=%s\n%s", SYNTHETIC_SPEC_MAGIC, shape, settings);
+    if(synthetic_spec_parse(text, strlen(text), &spec) < 0 || synthetic_log_open(&spec) < 0)
+    {
+        fprintf(stderr, "Bad settings for the log.\n");
+        return 1;
+    }
+
+    if(virtual_log)
+    {
+        ok = _write_virtual(argv[optind], &spec);
+        synthetic_log_close();
+        return ok ? 0 : 1;
+    }
+
+    output_fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(output_fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror( errno ));
+        return 1;
+    }
+    output_size = synthetic_log_size();
+    if(ftruncate(output_fd, output_size) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror( errno ));
+        close(output_fd);
+        return 1;
+    }
+
+    start = _now();
+    for(i = 0; i < thread_count; i++)
+    {
+        if(pthread_create(&threads[i], NULL, _writer_thread, NULL) != 0)
+        {
+            break;
+        }
+    }
+    thread_count = i;
+    if(thread_count == 0)
+    {
+        _writer_thread(NULL);
+    }
+    for(i = 0; i < thread_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    seconds = _now() - start;
+
+    if(close(output_fd) != 0)
+    {
+        write_failed = 1;
+    }
+    synthetic_log_close();
+    if(write_failed)
+    {
+        fprintf(stderr, "%s: writing failed\n", argv[optind]);
+        return 1;
+    }
+    fprintf(stderr, "%s log, %lld bytes in %.2fs (%.0f MB/s)\n", synthetic_shape_name(spec.shape),
+            (long long int)output_size, seconds, (double)output_size / seconds / (1024.0 * 1024.0));
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _usage
+// Notes:   Lists the shapes too
+//
+//******************************************************************************
+static void _usage(void)
+{
+    int i;
+
+    fprintf(stderr, "usage: log_gen [--shape NAME] [--size N[KMGT]] [--start \"Mmm dd hh:mm:ss\"]\n"
+                    "               [--duration SECONDS] [--line-length N] [--seed N]\n"
+                    "               [-j THREADS] [--virtual] OUTPUT\n"
+                    "shapes:");
+    for(i = 0; i < SHAPE_COUNT; i++)
+    {
+        fprintf(stderr, " %s", synthetic_shape_name((synthetic_shape)i));
+    }
+    fprintf(stderr, "\n--virtual writes a spec file that tgrep reads as the log itself.\n");
+}
+
+
+
+//******************************************************************************
+// Name:    _append_setting
+// Notes:   0 if it doesn't fit
+//
+//******************************************************************************
+static int _append_setting(char *text, size_t size, const char *key, const char *value)
+{
+    size_t used = strlen(text);
+    int wanted = snprintf(text + used, size - used, "%s=%s\n", key, value);
+
+    return wanted > 0 && (size_t)wanted < size - used;
+}
+
+
+
+//******************************************************************************
+// Name:    _writer_thread
+// Notes:   Takes the next chunk until there aren't any
+//
+//******************************************************************************
+static void *_writer_thread(void *unused)
+{
+    char *buffer = malloc(GEN_CHUNK_SIZE);
+    off_t offset;
+    size_t length;
+    ssize_t made;
+    ssize_t written;
+    size_t done;
+
+    (void)unused;
+    if(buffer == NULL)
+    {
+        write_failed = 1;
+        return NULL;
+    }
+
+    for(;;)
+    {
+        pthread_mutex_lock(&chunk_lock);
+        offset = next_chunk;
+        next_chunk += GEN_CHUNK_SIZE;
+        pthread_mutex_unlock(&chunk_lock);
+        if(offset >= output_size || write_failed)
+        {
+            break;
+        }
+
+        length = (output_size - offset < GEN_CHUNK_SIZE) ? (size_t)(output_size - offset) : GEN_CHUNK_SIZE;
+        made = synthetic_log_read(buffer, length, offset);
+        if(made != (ssize_t)length)
+        {
+            write_failed = 1;
+            break;
+        }
+        for(done = 0; done < length; done += (size_t)written)
+        {
+            written = pwrite(output_fd, buffer + done, length - done, offset + (off_t)done);
+            if(written < 0 && errno == EINTR)
+            {
+                written = 0;
+                continue;
+            }
+            if(written <= 0)
+            {
+                write_failed = 1;
+                break;
+            }
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+
+
+//******************************************************************************
+// Name:    _write_virtual
+// Notes:   Just the spec, tgrep does the rest
+//
+//******************************************************************************
+static int _write_virtual(const char *path, const synthetic_spec *spec)
+{
+    char text[GEN_SPEC_MAX];
+    FILE *file;
+    int length = synthetic_spec_format(spec, text, sizeof(text));
+
+    file = fopen(path, "w");
+    if(file == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror( errno ));
+        return 0;
+    }
+    fwrite(text, 1, (size_t)length, file);
+    if(fclose(file) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror( errno ));
+        return 0;
+    }
+    fprintf(stderr, "virtual %s log, %lld bytes\n", synthetic_shape_name(spec->shape), (long long int)synthetic_log_size());
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _now
+// Notes:   Monotonic seconds
+//
+//******************************************************************************
+static double _now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
@@ -0,0 +1,294 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    log_set.c
+// Notes:   Works out which files make up a rotation set (haproxy.log,
+//          haproxy.log.1, haproxy.log.2, ...) and what order they go in.
+//          Files are ordered by modification time, a rotated file stops
+//          being written the moment it's rotated, and ties are broken by the
+//          rotation number (bigger is older).
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "log_set.h"
+#include "console_output.h"
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static int _add_entry(log_set_entry **entries, int *entry_count, int *entry_capacity, const char *path, int quiet);
+static int _add_directory(log_set_entry **entries, int *entry_count, int *entry_capacity, const char *path);
+static int _add_glob(log_set_entry **entries, int *entry_count, int *entry_capacity, const char *pattern);
+static int _rotation_number(const char *path);
+static int _compare_entries(const void *a, const void *b);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    expand_log_set
+// Notes:   Directories contribute every regular, non-hidden file inside them.
+//          Anything that doesn't exist but has glob characters in it gets
+//          expanded here, for when the shell didn't (quoted patterns).
+//
+//******************************************************************************
+int expand_log_set(char **file_args, int file_arg_count, log_set_entry **entries)
+{
+    int entry_count = 0;
+    int entry_capacity = 0;
+    struct stat arg_stat;
+    int i;
+
+    *entries = NULL;
+    for(i = 0; i < file_arg_count; i++)
+    {
+        if(stat(file_args[i], &arg_stat) == 0 && S_ISDIR(arg_stat.st_mode))
+        {
+            _add_directory(entries, &entry_count, &entry_capacity, file_args[i]);
+        }
+        else if(stat(file_args[i], &arg_stat) != 0 && strpbrk(file_args[i], "*?[") != NULL)
+        {
+            _add_glob(entries, &entry_count, &entry_capacity, file_args[i]);
+        }
+        else
+        {
+            _add_entry(entries, &entry_count, &entry_capacity, file_args[i], 0);
+        }
+    }
+
+    if(entry_count > 1)
+    {
+        qsort(*entries, entry_count, sizeof(log_set_entry), _compare_entries);
+    }
+    return entry_count;
+}
+
+
+
+//******************************************************************************
+// Name:    free_log_set
+// Notes:   Frees the list from expand_log_set
+//
+//******************************************************************************
+void free_log_set(log_set_entry *entries, int entry_count)
+{
+    int i;
+    for(i = 0; i < entry_count; i++)
+    {
+        free(entries[i].path);
+    }
+    free(entries);
+}
+
+
+
+//******************************************************************************
+// Name:    _add_entry
+// Notes:   Stats the file and tacks it on the end of the list.  Explicitly
+//          named files that can't be used are complained about, files we
+//          found ourselves in a directory just get skipped.
+//
+//******************************************************************************
+static int _add_entry(log_set_entry **entries, int *entry_count, int *entry_capacity, const char *path, int quiet)
+{
+    struct stat file_stat;
+
+    if(stat(path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    {
+        if(!quiet)
+        {
+            console_print_error("Invalid log file specification: %s\n",path);
+        }
+        return 0;
+    }
+
+    if(*entry_count == *entry_capacity)
+    {
+        int new_capacity = (*entry_capacity == 0) ? 16 : *entry_capacity * 2;
+        log_set_entry *new_entries = realloc(*entries, new_capacity * sizeof(log_set_entry));
+        if(new_entries == NULL)
+        {
+            return 0;
+        }
+        *entries = new_entries;
+        *entry_capacity = new_capacity;
+    }
+
+    (*entries)[*entry_count].path = strdup(path);
+    if((*entries)[*entry_count].path == NULL)
+    {
+        return 0;
+    }
+    (*entries)[*entry_count].file_stat = file_stat;
+    (*entry_count)++;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _add_directory
+// Notes:   Every regular file in the directory, skipping dot files (which
+//          is where editors and logrotate leave their temporaries).
+//
+//******************************************************************************
+static int _add_directory(log_set_entry **entries, int *entry_count, int *entry_capacity, const char *path)
+{
+    DIR *directory = opendir(path);
+    struct dirent *entry;
+    char *full_path;
+    int added = 0;
+
+    if(directory == NULL)
+    {
+        console_print_error("Could not open directory: %s\n",path);
+        return 0;
+    }
+
+    while((entry = readdir(directory)) != NULL)
+    {
+        if(entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        full_path = malloc(strlen(path) + strlen(entry->d_name) + 2);
+        if(full_path == NULL)
+        {
+            break;
+        }
+        sprintf(full_path, "%s/%s", path, entry->d_name);
+        added += _add_entry(entries, entry_count, entry_capacity, full_path, 1);
+        free(full_path);
+    }
+    closedir(directory);
+    return added;
+}
+
+
+
+//******************************************************************************
+// Name:    _add_glob
+// Notes:   Lets the C library do the pattern matching
+//
+//******************************************************************************
+static int _add_glob(log_set_entry **entries, int *entry_count, int *entry_capacity, const char *pattern)
+{
+    glob_t matches;
+    size_t i;
+    int added = 0;
+
+    if(glob(pattern, 0, NULL, &matches) != 0)
+    {
+        console_print_error("Nothing matches %s\n",pattern);
+        return 0;
+    }
+    for(i = 0; i < matches.gl_pathc; i++)
+    {
+        added += _add_entry(entries, entry_count, entry_capacity, matches.gl_pathv[i], 1);
+    }
+    globfree(&matches);
+    return added;
+}
+
+
+
+//******************************************************************************
+// Name:    _rotation_number
+// Notes:   haproxy.log -> 0, haproxy.log.3 -> 3, haproxy.log.3.gz -> 3
+//
+//******************************************************************************
+static int _rotation_number(const char *path)
+{
+    const char *end = path + strlen(path);
+    const char *digits;
+
+    //skip a compression suffix if there is one
+    if(end - path > 3 && strcmp(end - 3, ".gz") == 0)
+    {
+        end -= 3;
+    }
+    else if(end - path > 4 && strcmp(end - 4, ".zst") == 0)
+    {
+        end -= 4;
+    }
+
+    digits = end;
+    while(digits > path && digits[-1] >= '0' && digits[-1] <= '9')
+    {
+        digits--;
+    }
+    if(digits == end || digits == path || digits[-1] != '.')
+    {
+        return 0;
+    }
+    return atoi(digits);
+}
+
+
+
+//******************************************************************************
+// Name:    _compare_entries
+// Notes:   Oldest first
+//
+//******************************************************************************
+static int _compare_entries(const void *a, const void *b)
+{
+    const log_set_entry *left = a;
+    const log_set_entry *right = b;
+    int left_rotation;
+    int right_rotation;
+
+    if(left->file_stat.st_mtime != right->file_stat.st_mtime)
+    {
+        return (left->file_stat.st_mtime < right->file_stat.st_mtime) ? -1 : 1;
+    }
+
+    left_rotation = _rotation_number(left->path);
+    right_rotation = _rotation_number(right->path);
+    if(left_rotation != right_rotation)
+    {
+        return (left_rotation > right_rotation) ? -1 : 1;
+    }
+    return strcmp(left->path, right->path);
+}
@@ -0,0 +1,49 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    log_set.h
+// Notes:   header for the log_set module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_LOG_SET_H__
+#define __TGREP_LOG_SET_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+//one file of a rotation set.  the stat is taken while expanding so we can
+//decide whether a file is worth opening without touching it.
+struct _log_set_entry {
+    char *path;
+    struct stat file_stat;
+};
+
+typedef struct _log_set_entry log_set_entry;
+
+//turns the file arguments (plain files, directories and quoted glob patterns)
+//into one list ordered oldest file first, so the set reads like a single log.
+//returns the number of entries, and the list must go back to free_log_set.
+int expand_log_set(char **file_args, int file_arg_count, log_set_entry **entries);
+void free_log_set(log_set_entry *entries, int entry_count);
+
+#endif
@@ -36,6 +36,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <limits.h>
+#include <getopt.h>
 
 
 
@@ -43,9 +44,17 @@
 // Project includes
 //******************************************************************************
 #include "parse_time.h"
+#include "log_format.h"
 #include "map_file.h"
+#include "map_arena.h"
 #include "file_scan.h"
 #include "console_output.h"
+#include "stats.h"
+#include "index_build.h"
+#include "log_set.h"
+#include "line_filter.h"
+#include "query_daemon.h"
+#include "follow_log.h"
 
 
 
@@ -54,6 +63,93 @@
 //******************************************************************************
 #define DEFAULT_LOG_FILE "/logs/haproxy.log"
 
+//long-only options get values outside of the char range so they can't
+//collide with the short ones
+#define OPTION_STATS        (256)
+#define OPTION_READER       (257)
+#define OPTION_BUILD_INDEX  (258)
+#define OPTION_PROBES       (259)
+#define OPTION_IO           (260)
+#define OPTION_REGEX        (261)
+#define OPTION_DAEMON       (262)
+#define OPTION_CLIENT       (263)
+#define OPTION_EXPLAIN      (264)
+#define OPTION_RANGES       (265)
+#define OPTION_TIME_FIELD   (266)
+#define OPTION_FORMAT       (267)
+#define OPTION_HUGE_PAGES   (268)
+#define OPTION_MAP_BUDGET   (269)
+
+//what -f does with a log: nothing, follow it until the end of the search,
+//or (for a single time rather than a range) follow it for good
+#define FOLLOW_NONE         (0)
+#define FOLLOW_UNTIL_END    (1)
+#define FOLLOW_FOREVER      (2)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//one search, or one window of the file that gets dumped.  searches without
+//a date are milliseconds into the day and ones without a year are still to
+//be put in one (see parse_search_string), windows are always epoch times.
+struct _search_range {
+    epoch_time start_time;
+    epoch_time end_time;
+    int dated;
+};
+
+typedef struct _search_range search_range;
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static struct option long_options[] =
+{
+    {"verbose", no_argument, NULL, 'v'},
+    {"debug",   no_argument, NULL, 'd'},
+    {"help",    no_argument, NULL, 'h'},
+    {"follow",  no_argument, NULL, 'f'},
+    {"stats",   no_argument, NULL, OPTION_STATS},
+    {"explain", no_argument, NULL, OPTION_EXPLAIN},
+    {"reader",  required_argument, NULL, OPTION_READER},
+    {"build-index", no_argument, NULL, OPTION_BUILD_INDEX},
+    {"threads", required_argument, NULL, 'j'},
+    {"probes",  required_argument, NULL, OPTION_PROBES},
+    {"io",      required_argument, NULL, OPTION_IO},
+    {"regexp",  required_argument, NULL, 'e'},
+    {"regex",   required_argument, NULL, OPTION_REGEX},
+    {"daemon",  optional_argument, NULL, OPTION_DAEMON},
+    {"client",  optional_argument, NULL, OPTION_CLIENT},
+    {"ranges",  required_argument, NULL, OPTION_RANGES},
+    {"time-field", required_argument, NULL, OPTION_TIME_FIELD},
+    {"format",  required_argument, NULL, OPTION_FORMAT},
+    {"huge-pages", no_argument, NULL, OPTION_HUGE_PAGES},
+    {"map-budget", required_argument, NULL, OPTION_MAP_BUDGET},
+    {NULL,      0,           NULL, 0}
+};
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static int _run_search(char **args, int arg_count, int build_index_mode, int thread_count, int follow_mode);
+static int _answer_query(char **args, int arg_count);
+static int _read_ranges_file(const char *path, char ***lines);
+static int _search_log_file(log_set_entry *entry, int build_index_mode, int thread_count, int follow, const search_range *searches, int search_count);
+static int _open_log_entry(log_set_entry *entry, int build_index_mode, const search_range *searches, int search_count);
+static int _is_search_range(const char *time_string);
+static int _build_file_windows(const search_range *searches, int search_count, epoch_time file_start_time, epoch_time file_end_time, search_range **windows);
+static int _compare_ranges(const void *a, const void *b);
+static int _parse_byte_size(const char *text, size_t *bytes);
+static int _build_search_windows(const search_range *search, epoch_time file_start_time, epoch_time file_end_time, search_range *windows);
+static int _start_follow(const char *path, const search_range *search, int follow);
+
 
 
 //******************************************************************************
@@ -75,7 +171,15 @@ int main(int argc, char **argv)
 
     //process the options that we have.
     int opt;
-    while((opt = getopt(argc,argv,"vdh")) != -1)
+    int build_index_mode = 0;
+    int thread_count = 0;
+    int daemon_mode = 0;
+    int client_mode = 0;
+    int follow_mode = 0;
+    char *socket_path = NULL;
+    char *ranges_path = NULL;
+    size_t map_budget;
+    while((opt = getopt_long(argc,argv,"vdhfj:e:",long_options,NULL)) != -1)
     {
         switch(opt)
         {
@@ -89,224 +193,862 @@ int main(int argc, char **argv)
             console_print_help();
             return 0;
             break;
+        case 'f':
+            follow_mode = 1;
+            break;
+        case OPTION_STATS:
+            stats_enable();
+            break;
+        case OPTION_EXPLAIN:
+            console_enable_explain();
+            break;
+        case OPTION_BUILD_INDEX:
+            build_index_mode = 1;
+            break;
+        case 'j':
+            thread_count = atoi(optarg);
+            set_filter_threads(thread_count);
+            break;
+        case 'e':
+            if(add_filter_literal(optarg) < 0)
+            {
+                return 0;
+            }
+            break;
+        case OPTION_REGEX:
+            if(add_filter_regex(optarg) < 0)
+            {
+                return 0;
+            }
+            break;
+        case OPTION_PROBES:
+            set_probe_count(atoi(optarg));
+            break;
+        case OPTION_IO:
+            if(strcmp(optarg,"sync") == 0)
+            {
+                set_log_io_engine(LOG_IO_SYNC);
+            }
+            else if(strcmp(optarg,"uring") == 0)
+            {
+                set_log_io_engine(LOG_IO_URING);
+            }
+            else
+            {
+                console_print_error("Unknown I/O engine \"%s\", use sync or uring.\n",optarg);
+                return 0;
+            }
+            break;
+        case OPTION_DAEMON:
+        case OPTION_CLIENT:
+            daemon_mode = (opt == OPTION_DAEMON);
+            client_mode = (opt == OPTION_CLIENT);
+            free(socket_path);
+            socket_path = (optarg != NULL) ? strdup(optarg) : get_default_socket_path();
+            break;
+        case OPTION_RANGES:
+            ranges_path = optarg;
+            break;
+        case OPTION_TIME_FIELD:
+            if(strcmp(optarg,"syslog") == 0)
+            {
+                set_log_time_field(LOG_TIME_FIELD_SYSLOG);
+            }
+            else if(strcmp(optarg,"accept") == 0)
+            {
+                set_log_time_field(LOG_TIME_FIELD_ACCEPT);
+            }
+            else
+            {
+                console_print_error("Unknown time field \"%s\", use syslog or accept.\n",optarg);
+                return 0;
+            }
+            break;
+        case OPTION_FORMAT:
+            if(!set_log_format_name(optarg))
+            {
+                console_print_error("Unknown log format \"%s\", use auto, syslog, iso8601, rfc5424 or nginx.\n",optarg);
+                return 0;
+            }
+            break;
+        case OPTION_HUGE_PAGES:
+            set_map_arena_huge_pages(1);
+            break;
+        case OPTION_MAP_BUDGET:
+            if(!_parse_byte_size(optarg, &map_budget))
+            {
+                console_print_error("Bad map budget \"%s\", use bytes with an optional K, M or G.\n",optarg);
+                return 0;
+            }
+            set_map_budget(map_budget);
+            break;
+        case OPTION_READER:
+            if(strcmp(optarg,"mmap") == 0)
+            {
+                set_log_reader(LOG_READER_MMAP);
+            }
+            else if(strcmp(optarg,"read") == 0)
+            {
+                set_log_reader(LOG_READER_READ);
+            }
+            else
+            {
+                console_print_error("Unknown reader \"%s\", use mmap or read.\n",optarg);
+                return 0;
+            }
+            break;
         case '?':
             //i know that getopt dumps its own little message but i want to
             //have it in RED!
-            console_print_error("Unknown option -%c.\n",optopt);
+            if(optopt != 0)
+            {
+                console_print_error("Unknown option -%c.\n",optopt);
+            }
+            else
+            {
+                console_print_error("Unknown option %s.\n",argv[optind-1]);
+            }
             console_print_error("Try %s -h for help.\n",argv[0]);
             return 0;
             break;
         }
     }
 
-    //now process the times and filename (if present)
-    int i;
-    int found_file_name = 0;
+    int status;
+    stats_timer_start(STAT_TIMER_TOTAL);
+    if(daemon_mode)
+    {
+        //everything on the daemon's command line (-e, --io, --stats...)
+        //applies to every query it answers
+        status = run_query_daemon(socket_path, _answer_query);
+        free(socket_path);
+        return status;
+    }
 
-    //so I double scan the options because I want to make sure that the file
-    //gets opened before I start working on the search string, that way I
-    //can just process the search and end times in the loop
-    for(i = optind; i < argc; i++)
+    //the --ranges list just gets tacked onto the command line, the searches
+    //in it go wherever the ones typed in would (daemon included)
+    char **args = argv + optind;
+    int arg_count = argc - optind;
+    char **range_lines = NULL;
+    int range_count = 0;
+    if(ranges_path != NULL)
     {
-        if(is_valid_search_time(argv[i]))
+        range_count = _read_ranges_file(ranges_path, &range_lines);
+        if(range_count < 0 || (args = malloc((arg_count + range_count + 1) * sizeof(char *))) == NULL)
         {
-            console_print_debug("Ignoring found search string for now.\n");
+            free(socket_path);
+            return 0;
         }
-        else
+        memcpy(args, argv + optind, arg_count * sizeof(char *));
+        for(int i = 0; i < range_count; i++)
         {
-            if(open_log_file(argv[i]) >0)
-            {
-                found_file_name =1;
-                break;
-            }
-            else
-            {
-                console_print_error("Invalid log file specification.\n");
-                return 0;
-            }
+            args[arg_count++] = range_lines[i];
         }
     }
 
-
-    //we didn't find a filename within our list of args, so we need to just
-    //use the default.  This is sort of interesting, i'm up in the air on
-    //whether to default to this if you get a BAD name in the arg list...
-    //I'll probably just return then so that you only get this if you haven't
-    //added an arg.
-    if(found_file_name == 0)
+    //a follow never finishes, it'd tie the daemon up for good
+    if(client_mode && !build_index_mode && !follow_mode)
     {
-        if(open_log_file(DEFAULT_LOG_FILE) > 0)
+        if(filter_enabled())
         {
-            //good!
+            console_print_error("-e and --regex go on the daemon's command line, not the client's.\n");
+            free(socket_path);
+            return 0;
         }
-        else
+        status = run_query_client(socket_path, args, arg_count);
+        if(status < 0)
         {
-            console_print_error("Could not open: %s\n",DEFAULT_LOG_FILE);
-            return 0;
+            console_print_info("Searching without the daemon.\n");
         }
     }
+    else
+    {
+        status = -1;
+    }
+    free(socket_path);
 
-    //at this point we know a bit about the file, so let's grab some info so
-    //we can cook our data a bit
-
-    int file_start_time = get_log_start_time();
-    if(file_start_time < 0)
+    if(status < 0)
     {
-        console_print_error("Invalid log file.\n");
-        return 0;
+        status = _run_search(args, arg_count, build_index_mode, thread_count, follow_mode);
+        stats_timer_stop(STAT_TIMER_TOTAL);
+        stats_print();
     }
-    //the end time already has it's day added, if it's needed.  all handled
-    //inline
-    int file_end_time = get_log_end_time();
-    if(file_end_time < 0 || file_end_time < file_start_time)
+
+    if(ranges_path != NULL)
     {
-        //wtf
-        console_print_error("Invalid log file.\n");
-        return 0;
+        for(int i = 0; i < range_count; i++)
+        {
+            free(range_lines[i]);
+        }
+        free(range_lines);
+        free(args);
     }
+    return status;
+}
 
-    char *file_hash = get_file_hash();
-    load_map_file(file_hash);
 
 
-    //SECOND LOOP
-    //figure out the search times.
-    int search_start_time = 0;
-    int search_end_time = 0;
-    int search_duration = 0;
+//******************************************************************************
+// Name:    _read_ranges_file
+// Notes:   One search string per line (10:00:05-10:00:25, 06:52...), "-" is
+//          stdin.  Blank lines and # comments are skipped.  Anything else
+//          that isn't a search time is an error, it'd otherwise get taken
+//          for a log file name.  Returns the number of lines, or -1.
+//
+//******************************************************************************
+static int _read_ranges_file(const char *path, char ***lines)
+{
+    FILE *file = (strcmp(path,"-") == 0) ? stdin : fopen(path,"r");
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t length;
+    char **list = NULL;
+    char **grown;
+    int count = 0;
+    int allocated = 0;
+    int line_number = 0;
+    int bad = 0;
+
+    if(file == NULL)
+    {
+        console_print_error("Could not open ranges file: %s\n",path);
+        return -1;
+    }
 
-    //keep track of whether we need to run a second search due to some
-    //goofy ambiguity inthe log files.
-    int second_search_start_time = 0;
-    int second_search_end_time = 0;
-    int found_search_string = 0;
-    for(i = optind; i < argc; i++)
+    while((length = getline(&line, &line_size, file)) >= 0)
     {
-        if(is_valid_search_time(argv[i]))
+        line_number++;
+        while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' ||
+                             line[length - 1] == ' ' || line[length - 1] == '\t'))
+        {
+            line[--length] = '\0';
+        }
+        char *text = line + strspn(line," \t");
+        if(*text == '\0' || *text == '#')
         {
-            found_search_string = 1;
-            console_print_info("Found search time: \"%s\"\n",argv[i]);
-
-            //so, we've got our search times, finally! let's get them in and
-            //process them a bit so that they make sense within the context of our
-            //application and the current log file.
-            //i.e if there's more than 24 hours
-            //example, log file covers 6:00 AM DAY 1 - 8:00 AM DAY 2 and the search
-            //is for something like 6:30-7:00, this should be broken in 2, i'll add a
-            //command line for no breaking of searches if I decide that this is actually
-            //a bad idea.
-
-            //so this is really a baseline
-            parse_search_string(argv[i], &search_start_time, &search_end_time);
-
-            //start with the end time larger than the start time to make life easy.
-            search_duration = search_end_time - search_start_time;
-            while(search_duration < 0)
+            continue;
+        }
+        if(!is_valid_search_time(text,strlen(text)))
+        {
+            console_print_error("%s:%d: \"%s\" is not a search time.\n",path,line_number,text);
+            bad = 1;
+            continue;
+        }
+        if(count == allocated)
+        {
+            allocated = (allocated == 0) ? 64 : allocated * 2;
+            grown = realloc(list, allocated * sizeof(char *));
+            if(grown == NULL)
             {
-                search_duration += SECONDS_PER_DAY;
+                bad = 1;
+                break;
             }
+            list = grown;
+        }
+        if((list[count] = strdup(text)) == NULL)
+        {
+            bad = 1;
+            break;
+        }
+        count++;
+    }
+    free(line);
+    if(file != stdin)
+    {
+        fclose(file);
+    }
 
-            second_search_start_time = search_start_time + SECONDS_PER_DAY;
+    if(bad)
+    {
+        while(count > 0)
+        {
+            free(list[--count]);
+        }
+        free(list);
+        return -1;
+    }
+    *lines = list;
+    return count;
+}
 
-            search_end_time = search_start_time + search_duration;
-            second_search_start_time = search_start_time + SECONDS_PER_DAY;
-            second_search_end_time = second_search_start_time + search_duration;
 
-            if(search_start_time < file_start_time)
-            {
-                search_start_time = file_start_time;
-            }
 
-            if(search_end_time > file_end_time)
-            {
-                search_end_time = file_end_time;
-            }
-            console_print_debug("Start: %d End: %d.\n",search_start_time, search_end_time);
-            if(search_start_time > search_end_time)
-            {
-                console_print_debug("Search 1 is INvalid.\n");
-            }
-            else
-            {
-                console_print_debug("Search 1 is valid.\n");
-            }
+//******************************************************************************
+// Name:    _run_search
+// Notes:   Everything after the options: sort out the search times and the
+//          log set, then search (or index) every file in it.  Any number of
+//          search times can be given, each file gets all of them in one go
+//          with the output in time order.  With -f the newest file of the
+//          set gets followed (one search only), and a single time (no
+//          range) means follow from then on with no end.  Returns 1 if
+//          anything got searched, which is what tgrep exits with.
+//
+//******************************************************************************
+static int _run_search(char **args, int arg_count, int build_index_mode, int thread_count, int follow_mode)
+{
+    //now process the times and filename (if present)
+    int i;
+    search_range *searches = malloc((arg_count + 1) * sizeof(search_range));
+    int search_count = 0;
+    char **file_args = malloc((arg_count + 1) * sizeof(char *));
+    int file_arg_count = 0;
 
-            if(second_search_start_time < file_start_time)
+    if(file_args == NULL || searches == NULL)
+    {
+        free(file_args);
+        free(searches);
+        return 0;
+    }
+
+    //anything that looks like a search time is a search, everything else
+    //is part of the log set
+    for(i = 0; i < arg_count; i++)
+    {
+        if(is_valid_search_time(args[i],strlen(args[i])))
+        {
+            console_print_info("Found search time: \"%s\"\n",args[i]);
+            if(follow_mode)
             {
-                second_search_start_time = file_start_time;
+                follow_mode = _is_search_range(args[i]) ? FOLLOW_UNTIL_END : FOLLOW_FOREVER;
             }
 
-            if(second_search_end_time > file_end_time)
+            //without a date this is really a baseline, each file cooks it
+            //against its own start and end times
+            parse_search_string(args[i], strlen(args[i]), &searches[search_count].start_time, &searches[search_count].end_time,
+                                &searches[search_count].dated);
+
+            //searching the older files of the set, "from then on" is
+            //everything up to a day later, or everything after a date
+            if(follow_mode == FOLLOW_FOREVER)
             {
-                second_search_end_time = file_end_time;
+                searches[search_count].end_time = searches[search_count].dated ? EPOCH_TIME_MAX : searches[search_count].start_time - 1;
             }
-            console_print_debug("Start: %d End: %d.\n",second_search_start_time, second_search_end_time);
-            if(second_search_start_time > second_search_end_time)
+            search_count++;
+        }
+        else
+        {
+            file_args[file_arg_count++] = args[i];
+        }
+    }
+
+    //if we didn't find a search string, do nothing
+    if(search_count == 0 && !build_index_mode)
+    {
+        console_print_error("No search string found.\n");
+        free(file_args);
+        free(searches);
+        return 0;
+    }
+
+    //there's only the one end of the log to follow
+    if(follow_mode && search_count > 1)
+    {
+        console_print_error("-f follows a single search time.\n");
+        free(file_args);
+        free(searches);
+        return 0;
+    }
+
+    //we didn't find a filename within our list of args, so we need to just
+    //use the default.
+    if(file_arg_count == 0)
+    {
+        file_args[file_arg_count++] = DEFAULT_LOG_FILE;
+    }
+
+    //a single plain file is the original behaviour, bail if it's no good.
+    //sets just skip whatever they can't use.
+    log_set_entry *log_set = NULL;
+    int log_set_count = expand_log_set(file_args, file_arg_count, &log_set);
+    free(file_args);
+    if(log_set_count == 0)
+    {
+        free_log_set(log_set, log_set_count);
+        free(searches);
+        return 0;
+    }
+    console_print_info("Searching %d log file(s).\n",log_set_count);
+
+    int searched = 0;
+    for(i = 0; i < log_set_count; i++)
+    {
+        if(_search_log_file(&log_set[i], build_index_mode, thread_count, (i == log_set_count - 1) ? follow_mode : FOLLOW_NONE,
+                            searches, search_count) > 0)
+        {
+            searched++;
+        }
+        else if(log_set_count == 1)
+        {
+            break;
+        }
+    }
+    free_log_set(log_set, log_set_count);
+    free(searches);
+
+    return searched > 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _answer_query
+// Notes:   What the daemon runs for each client
+//
+//******************************************************************************
+static int _answer_query(char **args, int arg_count)
+{
+    return _run_search(args, arg_count, 0, 0, 0);
+}
+
+
+
+//******************************************************************************
+// Name:    _search_log_file
+// Notes:   Everything we used to do to the one log file: open it, pull in its
+//          map, search (or index) it and save the map back.  In the daemon a
+//          log it already has open skips straight to the search, and stays
+//          open afterwards.  With follow the log gets searched up to its end
+//          and then followed (see FOLLOW_*).
+//          With several windows to dump, all of their boundaries get found
+//          in one sweep first (resolve_time_offsets), so the searches for
+//          each window are answered from the map.
+//          Returns 1 if the file was searched, 0 if it was skipped and -1 if
+//          it was no good.
+//
+//******************************************************************************
+static int _search_log_file(log_set_entry *entry, int build_index_mode, int thread_count, int follow, const search_range *searches, int search_count)
+{
+    search_range *windows = NULL;
+    epoch_time *boundaries;
+    int window_count;
+    char time_text[2][LOG_TIME_TEXT_SIZE];
+    off_t start_offset;
+    off_t end_offset;
+    int resident = 0;
+    int following = 0;
+    int status;
+    int i;
+
+    if(!build_index_mode && attach_resident_log(&entry->file_stat))
+    {
+        console_print_info("Using the already open %s\n",entry->path);
+        resident = 1;
+    }
+    else
+    {
+        //a followed log always gets opened, even if nothing's in range yet
+        status = _open_log_entry(entry, build_index_mode || follow != FOLLOW_NONE, searches, search_count);
+        if(status <= 0)
+        {
+            return status;
+        }
+    }
+
+    //building the index is all we do in this mode, no search string needed
+    if(build_index_mode)
+    {
+        if(build_log_index(thread_count) < 0)
+        {
+            console_print_error("Could not build the index for %s.\n",entry->path);
+            close_log_file();
+            clear_map();
+            return -1;
+        }
+    }
+    else if(follow != FOLLOW_NONE &&
+            (following = _start_follow(entry->path, &searches[0], follow)) >= 0)
+    {
+        stats_add(STAT_FILES_SEARCHED, 1);
+    }
+    else
+    {
+        stats_add(STAT_FILES_SEARCHED, 1);
+        window_count = _build_file_windows(searches, search_count, get_log_start_time(), get_log_end_time(), &windows);
+        boundaries = malloc((window_count > 0 ? window_count : 1) * 2 * sizeof(epoch_time));
+        if(boundaries == NULL)
+        {
+            window_count = 0;
+        }
+
+        //the end of a window is found as the start of the second after it
+        if(window_count > 1)
+        {
+            for(i = 0; i < window_count; i++)
             {
-                console_print_debug("Search 2 is INvalid.\n");
+                boundaries[i * 2] = windows[i].start_time;
+                boundaries[i * 2 + 1] = windows[i].end_time + 1;
             }
-            else
+            stats_timer_start(STAT_TIMER_SEARCH);
+            resolve_time_offsets(boundaries, window_count * 2);
+            stats_timer_stop(STAT_TIMER_SEARCH);
+        }
+
+        for(i = 0; i < window_count; i++)
+        {
+            console_print_info("Scanning for times %s - %s.\n",format_log_time(windows[i].start_time, time_text[0]),
+                               format_log_time(windows[i].end_time, time_text[1]));
+
+            //get the disk going on the front of the range while the end is
+            //still being searched for, then ask for the rest
+            stats_timer_start(STAT_TIMER_SEARCH);
+            start_offset = find_time_start_offset(windows[i].start_time);
+            prefetch_log_range(start_offset, -1);
+            end_offset = find_time_end_offset(windows[i].end_time);
+            stats_timer_stop(STAT_TIMER_SEARCH);
+            if(end_offset >= 0)
             {
-                console_print_debug("Search 2 is valid.\n");
+                prefetch_log_range(start_offset, end_offset);
             }
+            dump_file_range(start_offset, end_offset);
+        }
+        free(windows);
+        free(boundaries);
+    }
 
-            //donezo.
-            break;
+    //store the map file.  a resident log's map gets saved when the daemon
+    //lets go of it.
+    if(!resident)
+    {
+        char *file_hash = get_file_hash();
+        if(file_hash != NULL)
+        {
+            stats_timer_start(STAT_TIMER_MAP_SAVE);
+            save_map_file(file_hash, get_file_fingerprint(), get_log_file_size());
+            stats_timer_stop(STAT_TIMER_MAP_SAVE);
+            free(file_hash);
         }
+    }
+    if(!keep_resident_log())
+    {
+        close_log_file();
+        clear_map();
+    }
 
+    //the map's saved and the log closed, follow keeps its own descriptor
+    if(following > 0)
+    {
+        follow_log_run();
     }
+    return 1;
+}
 
 
-    //if we didn't find a search string, do nothing
-    if(found_search_string == 0)
+
+//******************************************************************************
+// Name:    _start_follow
+// Notes:   follow_log_start for the one search, with a date that has no
+//          year put in the log's (see _build_search_windows) and the start
+//          taken back to a whole second the way _build_file_windows does
+//
+//******************************************************************************
+static int _start_follow(const char *path, const search_range *search, int follow)
+{
+    epoch_time start_time = search->start_time;
+    epoch_time end_time = search->end_time;
+
+    if(search->dated == SEARCH_DATED_NO_YEAR)
     {
-        console_print_error("No search string found.\n");
-        return 0;
+        resolve_search_year(&start_time, &end_time, get_log_start_time(), get_log_end_time());
     }
+    start_time -= start_time % get_log_time_resolution();
+    return follow_log_start(path, start_time, (follow == FOLLOW_FOREVER) ? -1 : end_time, search->dated);
+}
+
+
 
-    //perform the searches if we need to.
-    if(search_start_time <= search_end_time)
+//******************************************************************************
+// Name:    _open_log_entry
+// Notes:   Opens the log and pulls in its map.  If the file's saved map says
+//          none of it can be in range we don't even open it.  Returns 1 if
+//          the log is open, 0 if it was skipped and -1 if it was no good.
+//
+//******************************************************************************
+static int _open_log_entry(log_set_entry *entry, int build_index_mode, const search_range *searches, int search_count)
+{
+    search_range *windows;
+    int window_count = -1;
+    epoch_time peek_start_time;
+    epoch_time peek_end_time;
+    int status;
+
+    char *file_hash = get_file_hash_for_stat(&entry->file_stat);
+    if(file_hash == NULL)
     {
-        console_print_info("Scanning for times %d - %d.\n",search_start_time, search_end_time);
-        dump_file_range(find_time_start_offset(search_start_time),find_time_end_offset(search_end_time));
+        return -1;
     }
 
-    if(second_search_start_time <= second_search_end_time)
+    if(!build_index_mode &&
+       peek_map_file(file_hash, get_log_size_for_stat(&entry->file_stat), entry->file_stat.st_mtime, &peek_start_time, &peek_end_time))
     {
-        console_print_info("Scanning for times %d - %d.\n",second_search_start_time, second_search_end_time);
-        dump_file_range(find_time_start_offset(second_search_start_time),find_time_end_offset(second_search_end_time));
+        window_count = _build_file_windows(searches, search_count, peek_start_time, peek_end_time, &windows);
+        free(windows);
     }
+    if(window_count == 0)
+    {
+        console_print_info("Skipping %s, nothing in range.\n",entry->path);
+        stats_add(STAT_FILES_SKIPPED, 1);
+        free(file_hash);
+        return 0;
+    }
+    free(file_hash);
 
-    //store the map file
-    save_map_file(file_hash);
-    return 1;
-}
-
+    stats_timer_start(STAT_TIMER_OPEN);
+    status = open_log_file(entry->path);
+    stats_timer_stop(STAT_TIMER_OPEN);
+    if(status <= 0)
+    {
+        console_print_error("Could not open: %s\n",entry->path);
+        return -1;
+    }
 
+    //at this point we know a bit about the file, so let's grab some info so
+    //we can cook our data a bit
 
+    epoch_time file_start_time = get_log_start_time();
+    //the end time already has it's day added, if it's needed.  all handled
+    //inline
+    epoch_time file_end_time = get_log_end_time();
+    if(file_start_time < 0 || file_end_time < 0 || file_end_time < file_start_time)
+    {
+        //wtf
+        console_print_error("Invalid log file: %s\n",entry->path);
+        close_log_file();
+        clear_map();
+        return -1;
+    }
 
+    //the hash comes from the file we actually opened, the name may have been
+    //rotated onto something else since we looked
+    stats_timer_start(STAT_TIMER_MAP_LOAD);
+    file_hash = get_file_hash();
+    uint64_t file_fingerprint = get_file_fingerprint();
+    off_t file_size = get_log_file_size();
+    off_t mapped_size = load_map_file(file_hash, file_fingerprint, file_size);
+    if(mapped_size == -1)
+    {
+        //maybe an older tgrep left one behind under the old naming scheme
+        char *legacy_hash = get_legacy_file_hash();
+        mapped_size = load_map_file(legacy_hash, file_fingerprint, file_size);
+        free(legacy_hash);
+    }
+    if(mapped_size >= 0 && mapped_size < file_size)
+    {
+        extend_log_map(mapped_size);
+    }
+    stats_timer_stop(STAT_TIMER_MAP_LOAD);
+    free(file_hash);
+    return 1;
+}
 
 
 
+//******************************************************************************
+// Name:    _is_search_range
+// Notes:   A range has a hyphen after the date (if there is one)
+//
+//******************************************************************************
+static int _is_search_range(const char *time_string)
+{
+    const char *clock = strpbrk(time_string, "Tt");
+    return strchr((clock != NULL) ? clock : time_string, '-') != NULL;
+}
 
 
 
+//******************************************************************************
+// Name:    _build_file_windows
+// Notes:   Every search's windows for one file (see _build_search_windows),
+//          in time order, with the ones that overlap or touch merged so no
+//          line gets printed twice.  The windows get allocated, the caller
+//          frees them.  Returns how many there are, or -1 if there wasn't
+//          the memory.
+//
+//******************************************************************************
+static int _build_file_windows(const search_range *searches, int search_count, epoch_time file_start_time, epoch_time file_end_time, search_range **windows)
+{
+    epoch_time day_count = (file_end_time / EPOCH_TIME_PER_DAY) - (file_start_time / EPOCH_TIME_PER_DAY) + 1;
+    epoch_time resolution = get_log_time_resolution();
+    int window_count = 0;
+    int merged_count = 0;
+    int i;
 
+    //an undated search can land once on every day of the log
+    *windows = malloc((size_t)search_count * (size_t)((day_count > 1) ? day_count : 1) * sizeof(search_range));
+    if(*windows == NULL)
+    {
+        return -1;
+    }
+    for(i = 0; i < search_count; i++)
+    {
+        window_count += _build_search_windows(&searches[i], file_start_time, file_end_time, *windows + window_count);
+    }
 
+    //lines stamped to the second are all keyed on its start, so a window
+    //that starts part way through one takes in the whole second
+    for(i = 0; i < window_count; i++)
+    {
+        (*windows)[i].start_time -= (*windows)[i].start_time % resolution;
+    }
+    if(window_count < 2)
+    {
+        return window_count;
+    }
 
+    qsort(*windows, window_count, sizeof(search_range), _compare_ranges);
+    for(i = 1; i < window_count; i++)
+    {
+        if((*windows)[i].start_time <= (*windows)[merged_count].end_time + 1)
+        {
+            if((*windows)[i].end_time > (*windows)[merged_count].end_time)
+            {
+                (*windows)[merged_count].end_time = (*windows)[i].end_time;
+            }
+        }
+        else
+        {
+            (*windows)[++merged_count] = (*windows)[i];
+        }
+    }
+    console_print_debug("%d windows merged into %d.\n",window_count, merged_count + 1);
+    return merged_count + 1;
+}
 
 
 
+//******************************************************************************
+// Name:    _compare_ranges
+// Notes:   qsort() order for _build_file_windows, by start time
+//
+//******************************************************************************
+static int _compare_ranges(const void *a, const void *b)
+{
+    const search_range *first = a;
+    const search_range *second = b;
 
+    if(first->start_time != second->start_time)
+    {
+        return (first->start_time < second->start_time) ? -1 : 1;
+    }
+    return (first->end_time > second->end_time) - (first->end_time < second->end_time);
+}
 
 
 
+//******************************************************************************
+// Name:    _build_search_windows
+// Notes:   Cooks one search against one file's start and end.  A search
+//          with a date is the one window, clipped to the file.  One without
+//          goes on every day the log covers, e.g. a log from 6:00 AM DAY 1
+//          to 8:00 AM DAY 3 searched for 6:30-7:00 gets it on all three days.
+//          A range that goes past midnight starts on each day and finishes
+//          on the next one.  Returns how many of the windows are valid,
+//          they're packed at the front of the array.
+//
+//******************************************************************************
+static int _build_search_windows(const search_range *search, epoch_time file_start_time, epoch_time file_end_time, search_range *windows)
+{
+    int window_count = 0;
+    epoch_time search_duration;
+    epoch_time window_start;
+    epoch_time window_end;
+    epoch_time day;
 
+    if(search->dated)
+    {
+        //a date with no year goes in whichever one puts it over this log
+        window_start = search->start_time;
+        window_end = search->end_time;
+        if(search->dated == SEARCH_DATED_NO_YEAR)
+        {
+            resolve_search_year(&window_start, &window_end, file_start_time, file_end_time);
+        }
+        if(window_start < file_start_time)
+        {
+            window_start = file_start_time;
+        }
+        if(window_end > file_end_time)
+        {
+            window_end = file_end_time;
+        }
+        if(window_start > window_end)
+        {
+            return 0;
+        }
+        windows[0].start_time = window_start;
+        windows[0].end_time = window_end;
+        windows[0].dated = SEARCH_DATED;
+        return 1;
+    }
 
+    //start with the end time larger than the start time to make life easy.
+    search_duration = search->end_time - search->start_time;
+    while(search_duration < 0)
+    {
+        search_duration += EPOCH_TIME_PER_DAY;
+    }
 
+    for(day = file_start_time - (file_start_time % EPOCH_TIME_PER_DAY); day <= file_end_time; day += EPOCH_TIME_PER_DAY)
+    {
+        window_start = day + search->start_time;
+        window_end = window_start + search_duration;
 
+        if(window_start < file_start_time)
+        {
+            window_start = file_start_time;
+        }
 
+        if(window_end > file_end_time)
+        {
+            window_end = file_end_time;
+        }
+        if(window_start > window_end)
+        {
+            continue;
+        }
+        windows[window_count].start_time = window_start;
+        windows[window_count].end_time = window_end;
+        windows[window_count].dated = SEARCH_DATED;
+        window_count++;
+    }
+    console_print_debug("%d window(s) for the search.\n",window_count);
+    return window_count;
+}
 
 
 
+//******************************************************************************
+// Name:    _parse_byte_size
+// Notes:   Bytes, with an optional K/M/G (powers of 1024)
+//
+//******************************************************************************
+static int _parse_byte_size(const char *text, size_t *bytes)
+{
+    char *suffix;
+    unsigned long long int size = strtoull(text, &suffix, 10);
 
+    if(suffix == text || text[0] == '-')
+    {
+        return 0;
+    }
+    switch(*suffix)
+    {
+    case 'G': case 'g':
+        size *= 1024;
+        //fall through
+    case 'M': case 'm':
+        size *= 1024;
+        //fall through
+    case 'K': case 'k':
+        size *= 1024;
+        suffix++;
+        break;
+    default:
+        break;
+    }
+    if(*suffix != '\0')
+    {
+        return 0;
+    }
+    *bytes = (size_t)size;
+    return 1;
+}
@@ -0,0 +1,387 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    map_arena.c
+// Notes:   Where the time map keeps its items.  New items are bumped out of
+//          big blocks instead of going to malloc one chunk at a time, and the
+//          sorted array is one mapping that grows with mremap, so a full day
+//          of seconds sits in a couple of contiguous runs of memory and goes
+//          back to the kernel in a couple of munmaps.  Nothing here is thread
+//          safe, neither is the map.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "map_arena.h"
+#include "console_output.h"
+#include "stats.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//an ordinary block holds 2k map items, a huge one is a whole huge page
+#define MAP_ARENA_BLOCK_SIZE    ((size_t)64 * 1024)
+#define MAP_ARENA_HUGE_SIZE     ((size_t)2 * 1024 * 1024)
+
+//everything handed out is aligned to this, and the block header is padded
+//to a cache line so the first item starts on one
+#define MAP_ARENA_ALIGN         ((size_t)16)
+#define MAP_ARENA_HEADER_SIZE   ((sizeof(map_arena_block) + 63) & ~(size_t)63)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//sits at the front of its own mapping
+struct _map_arena_block {
+    map_arena_block *next;
+    size_t size;
+    size_t used;
+    int huge;
+};
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static int huge_pages = 0;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void *_map_pages(size_t *size, int *huge);
+static size_t _round_size(size_t size, int huge);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    set_map_arena_huge_pages
+// Notes:   Only affects memory mapped from here on
+//
+//******************************************************************************
+void set_map_arena_huge_pages(int enable)
+{
+    huge_pages = enable;
+}
+
+
+
+//******************************************************************************
+// Name:    get_map_arena_huge_pages
+// Notes:   For the stats label
+//
+//******************************************************************************
+int get_map_arena_huge_pages(void)
+{
+    return huge_pages;
+}
+
+
+
+//******************************************************************************
+// Name:    map_arena_allocate
+// Notes:   Bumps along the newest block.  Anything that won't fit starts a
+//          new one, big enough for it if it's bigger than a block.
+//
+//******************************************************************************
+void *map_arena_allocate(map_arena *arena, size_t size)
+{
+    map_arena_block *block = arena->blocks;
+    size_t block_size;
+    int huge;
+    void *result;
+
+    size = (size + MAP_ARENA_ALIGN - 1) & ~(MAP_ARENA_ALIGN - 1);
+    if(block == NULL || block->size - block->used < size)
+    {
+        block_size = MAP_ARENA_HEADER_SIZE + size;
+        if(block_size < MAP_ARENA_BLOCK_SIZE)
+        {
+            block_size = MAP_ARENA_BLOCK_SIZE;
+        }
+        block = _map_pages(&block_size, &huge);
+        if(block == NULL)
+        {
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = MAP_ARENA_HEADER_SIZE;
+        block->huge = huge;
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->block_count++;
+        arena->reserved += block_size;
+    }
+
+    result = (char *)block + block->used;
+    block->used += size;
+    arena->used += size;
+    return result;
+}
+
+
+
+//******************************************************************************
+// Name:    map_arena_reset
+// Notes:   The newest block is the one that's still warm
+//
+//******************************************************************************
+void map_arena_reset(map_arena *arena)
+{
+    map_arena_block *keep = arena->blocks;
+
+    if(keep == NULL)
+    {
+        return;
+    }
+    arena->blocks = keep->next;
+    map_arena_release(arena);
+
+    keep->next = NULL;
+    keep->used = MAP_ARENA_HEADER_SIZE;
+    arena->blocks = keep;
+    arena->block_count = 1;
+    arena->reserved = keep->size;
+}
+
+
+
+//******************************************************************************
+// Name:    map_arena_release
+// Notes:   One munmap per block, however many items were in them
+//
+//******************************************************************************
+void map_arena_release(map_arena *arena)
+{
+    map_arena_block *next;
+
+    while(arena->blocks != NULL)
+    {
+        next = arena->blocks->next;
+        munmap(arena->blocks, arena->blocks->size);
+        arena->blocks = next;
+    }
+    arena->block_count = 0;
+    arena->reserved = 0;
+    arena->used = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    map_region_reserve
+// Notes:   Growing an ordinary region is an mremap, the kernel moves the
+//          pages rather than us copying them.  Explicit huge pages can't
+//          always be remapped so those get a fresh mapping and a copy.
+//
+//******************************************************************************
+int map_region_reserve(map_region *region, size_t size)
+{
+    size_t new_size = size;
+    void *base;
+    int huge;
+
+    if(size <= region->reserved)
+    {
+        return 1;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    if(region->base != NULL && !region->huge)
+    {
+        new_size = _round_size(size, huge_pages);
+        base = mremap(region->base, region->reserved, new_size, MREMAP_MAYMOVE);
+        if(base == MAP_FAILED)
+        {
+            console_print_debug("Could not grow the map to %zu bytes.\n",new_size);
+            return 0;
+        }
+        region->base = base;
+        region->reserved = new_size;
+        return 1;
+    }
+#endif
+
+    base = _map_pages(&new_size, &huge);
+    if(base == NULL)
+    {
+        return 0;
+    }
+    if(region->base != NULL)
+    {
+        memcpy(base, region->base, region->reserved);
+        munmap(region->base, region->reserved);
+    }
+    region->base = base;
+    region->reserved = new_size;
+    region->huge = huge;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    map_region_release
+// Notes:   Back to empty
+//
+//******************************************************************************
+void map_region_release(map_region *region)
+{
+    if(region->base != NULL)
+    {
+        munmap(region->base, region->reserved);
+    }
+    region->base = NULL;
+    region->reserved = 0;
+    region->huge = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    map_arena_add_usage
+// Notes:   The block headers count as used, they're not free for items
+//
+//******************************************************************************
+void map_arena_add_usage(const map_arena *arena, map_arena_usage *usage)
+{
+    const map_arena_block *block;
+
+    usage->reserved += arena->reserved;
+    usage->used += arena->used + (size_t)arena->block_count * MAP_ARENA_HEADER_SIZE;
+    usage->blocks += arena->block_count;
+    for(block = arena->blocks; block != NULL; block = block->next)
+    {
+        usage->huge_blocks += block->huge;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    map_region_add_usage
+// Notes:   A region is one block
+//
+//******************************************************************************
+void map_region_add_usage(const map_region *region, size_t used, map_arena_usage *usage)
+{
+    if(region->base == NULL)
+    {
+        return;
+    }
+    usage->reserved += region->reserved;
+    usage->used += used;
+    usage->blocks++;
+    usage->huge_blocks += region->huge;
+}
+
+
+
+//******************************************************************************
+// Name:    _map_pages
+// Notes:   Anonymous memory, size gets rounded up to what was really mapped.
+//          With huge pages on, explicit ones are tried first (they need the
+//          admin to have reserved some), then ordinary pages with a hint
+//          that transparent huge pages would be welcome.  huge says whether
+//          the explicit ones worked.
+//
+//******************************************************************************
+static void *_map_pages(size_t *size, int *huge)
+{
+    void *pages;
+
+    *huge = 0;
+#ifdef MAP_HUGETLB
+    if(huge_pages)
+    {
+        size_t huge_size = _round_size(*size, 1);
+        pages = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(pages != MAP_FAILED)
+        {
+            *size = huge_size;
+            *huge = 1;
+            stats_add(STAT_MAP_BLOCKS, 1);
+            stats_add(STAT_MAP_HUGE_BLOCKS, 1);
+            return pages;
+        }
+    }
+#endif
+
+    *size = _round_size(*size, huge_pages);
+    pages = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(pages == MAP_FAILED)
+    {
+        console_print_debug("Could not map %zu bytes for the map.\n",*size);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if(huge_pages)
+    {
+        madvise(pages, *size, MADV_HUGEPAGE);
+    }
+#endif
+    stats_add(STAT_MAP_BLOCKS, 1);
+    return pages;
+}
+
+
+
+//******************************************************************************
+// Name:    _round_size
+// Notes:   Up to a whole number of pages, huge ones if asked
+//
+//******************************************************************************
+static size_t _round_size(size_t size, int huge)
+{
+    size_t page_size = huge ? MAP_ARENA_HUGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+
+    return (size + page_size - 1) / page_size * page_size;
+}
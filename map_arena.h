@@ -0,0 +1,98 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    map_arena.h
+// Notes:   header for the map_arena module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_MAP_ARENA_H__
+#define __TGREP_MAP_ARENA_H__
+
+#include <stddef.h>
+
+//lots of small things with the same lifetime (the map's new items).  they
+//come out of big blocks one after another and all go back at once.
+typedef struct _map_arena_block map_arena_block;
+
+struct _map_arena {
+    map_arena_block *blocks;
+    int block_count;
+    size_t reserved;
+    size_t used;
+};
+
+typedef struct _map_arena map_arena;
+
+//an empty arena, nothing's reserved until the first allocation
+#define MAP_ARENA_INIT {NULL, 0, 0, 0}
+
+//one big thing that can grow (the map's sorted array).  growing keeps the
+//contents, but the base can move.
+struct _map_region {
+    void *base;
+    size_t reserved;
+    int huge;
+};
+
+typedef struct _map_region map_region;
+
+#define MAP_REGION_INIT {NULL, 0, 0}
+
+//what some arenas and regions are holding, added up
+struct _map_arena_usage {
+    size_t reserved;
+    size_t used;
+    int blocks;
+    int huge_blocks;
+};
+
+typedef struct _map_arena_usage map_arena_usage;
+
+//--huge-pages, blocks and regions after this get 2MB pages: explicit huge
+//pages if the system has some set aside, transparent ones otherwise
+void set_map_arena_huge_pages(int enable);
+int get_map_arena_huge_pages(void);
+
+//size bytes out of the arena, 16 byte aligned, or NULL if there's no more
+//memory.  it's good until the next reset or release.
+void *map_arena_allocate(map_arena *arena, size_t size);
+
+//forgets everything that was handed out.  the newest block is kept so an
+//arena that fills and empties over and over doesn't keep going back to the
+//kernel.
+void map_arena_reset(map_arena *arena);
+
+//gives every block back
+void map_arena_release(map_arena *arena);
+
+//makes sure the region holds at least size bytes, keeping what's in it.
+//returns 0 (leaving the region alone) if there isn't the memory.
+int map_region_reserve(map_region *region, size_t size);
+void map_region_release(map_region *region);
+
+//add an arena's or a region's numbers to usage, used is how much of the
+//region the caller says it's using
+void map_arena_add_usage(const map_arena *arena, map_arena_usage *usage);
+void map_region_add_usage(const map_region *region, size_t used, map_arena_usage *usage);
+
+#endif
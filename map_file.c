@@ -21,7 +21,14 @@
 //          whether or not those offsets are confirmed to be the start/end or
 //          if they're just our current best guess.
 //
-//          The mapping list is internally stored as an ordered linked list.
+//          The map is internally stored as a sorted array plus a small sorted
+//          index of items created since the last merge, both binary searched.
+//          The memory for both comes from map_arena.
+//
+//          A map has a budget.  Once it's over, the seconds far from any
+//          recent search get thinned out to one checkpoint a minute (then
+//          coarser if that's not enough), which just leaves the probes a
+//          little further to go when a search lands there.
 //
 //
 // Rev:     17-Feb-2011 Initial Rev
@@ -40,7 +47,9 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <errno.h>
+#include <stdint.h>
 
 
 
@@ -48,14 +57,148 @@
 // Project includes
 //******************************************************************************
 #include "map_file.h"
+#include "map_arena.h"
+#include "log_format.h"
 #include "console_output.h"
+#include "stats.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//how many pending items we let pile up before a merge is worth the copy
+#define MAP_PENDING_MERGE_COUNT  (256)
+
+//the budget unless --map-budget says otherwise, two million items.  a map
+//over budget gets thinned to this fraction of it so it isn't thinned again
+//on every merge after.
+#define MAP_DEFAULT_BUDGET       ((size_t)64 * 1024 * 1024)
+#define MAP_BUDGET_TARGET(n)     ((n) / 4 * 3)
+
+//searched times we remember, and how far either side of one the map keeps
+//every item it has
+#define MAP_HOT_QUERIES          (64)
+#define MAP_HOT_RADIUS           (10 * 60 * EPOCH_TIME_PER_SECOND)
+
+//v1 was the original text format, it has no header at all.  v2 keyed the
+//fingerprint on the log's size and mtime, v3 only on its first line and keeps
+//the size separately so a map can follow a growing log.  v4 has epoch times
+//instead of seconds from the first day, v5 has them in milliseconds and
+//says which field of the line they came from, and the layout of the
+//stamps (log_format, 0 is syslog in maps from before there was a choice).
+#define MAP_FILE_MAGIC           "TGREPMAP"
+#define MAP_FILE_VERSION         (5)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+//a whole map parked outside the module (see detach_map).  it's always
+//merged first so there's only the sorted array to carry, which is in either
+//the region or the mapping.  the times searched for in this log come along
+//so the budget keeps detail around them and nobody else's.
+struct _map_context {
+   map_item *items;
+   int count;
+   map_region region;
+   char *mapping;
+   size_t mapping_size;
+   epoch_time hot_times[MAP_HOT_QUERIES];
+   int hot_count;
+   int hot_next;
+};
+
+//what sits at the front of every map file.  the items follow immediately,
+//it's padded out to 64 bytes so they stay nicely aligned when mapped.
+struct _map_file_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t entry_size;
+   uint64_t fingerprint;
+   uint64_t entry_count;
+   int64_t log_size;
+   uint32_t crc;
+   uint32_t time_field;
+   uint32_t log_format;
+   uint32_t reserved[3];
+};
+
+typedef struct _map_file_header map_file_header;
+
+//the on-disk layout depends on these never changing by accident.  map_item
+//is 8+8+8+4+4 bytes with no padding, which is also what lets
+//resolve_time_offsets compare items with memcmp.
+_Static_assert(sizeof(map_item) == 32, "map_item layout changed, bump MAP_FILE_VERSION");
+_Static_assert(sizeof(map_file_header) == 64, "map file header must stay 64 bytes");
 
 
 
 //******************************************************************************
 // Module Specific Global Variables
 //******************************************************************************
-static map_item *map_head;
+
+//the bulk of the map, one contiguous array sorted by time.  it lives in
+//sorted_region, which grows in place as items get merged in, unless it
+//came straight out of a map file.
+static map_item *map_items = NULL;
+static int map_count = 0;
+static map_region sorted_region = MAP_REGION_INIT;
+
+//items created since the last merge.  they're bumped out of the arena so
+//their addresses never move, and the index keeps pointers to them sorted by
+//time so lookups can binary search both.  a merge empties the arena in one go.
+static map_arena pending_arena = MAP_ARENA_INIT;
+static map_item **pending_index = NULL;
+static int pending_count = 0;
+static int pending_capacity = 0;
+
+//bytes of items the map may keep, 0 for no limit
+static size_t map_budget = MAP_DEFAULT_BUDGET;
+
+//the last few times searched for in this map's log, oldest overwritten
+//first
+static epoch_time hot_times[MAP_HOT_QUERIES];
+static int hot_count = 0;
+static int hot_next = 0;
+
+//what an over budget map gets thinned to, one item per this much time.
+//seconds first, for maps with millisecond keys.
+static const epoch_time coarsen_steps[] =
+{
+   EPOCH_TIME_PER_SECOND,
+   60 * EPOCH_TIME_PER_SECOND,
+   10 * 60 * EPOCH_TIME_PER_SECOND,
+   60 * 60 * EPOCH_TIME_PER_SECOND,
+   EPOCH_TIME_PER_DAY
+};
+
+#define COARSEN_STEP_COUNT ((int)(sizeof(coarsen_steps) / sizeof(coarsen_steps[0])))
+
+//when the sorted array came straight out of a map file this is the mapping
+//it lives in, until the first merge copies it into sorted_region
+static char *map_items_mapping = NULL;
+static size_t map_items_mapping_size = 0;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void _release_map_items(void);
+static int _lower_bound(epoch_time time);
+static int _pending_lower_bound(epoch_time time);
+static void _note_map_usage(void);
+static void _enforce_map_budget(void);
+static int _coarsen_map(epoch_time step, const epoch_time *hot, int hot_total);
+static int _compare_times(const void *a, const void *b);
+static off_t _load_binary_map_file(int fd, map_file_header *header, uint64_t fingerprint, off_t log_size);
+static int _load_text_map_file(char *full_path);
+static int _absorb_map_item(const map_item *source);
+static int _write_all(int fd, const void *data, size_t size);
+static uint32_t _crc32(const void *data, size_t size);
 
 
 
@@ -70,14 +213,17 @@ static map_item *map_head;
 //******************************************************************************
 // Name:    create_new_map_item
 // Notes:   Does one of 2 things, it will create a new map item if there doesn't
-//          already exist one within the list.  Otherwise it will just return
-//          the one that already exists.
+//          already exist one within the map.  Otherwise it will just return
+//          the one that already exists.  New items go into the pending index,
+//          probes tend to create them in order so that's usually an append.
 //
 //******************************************************************************  
-map_item *create_new_map_item(int time)
+map_item *create_new_map_item(epoch_time time)
 {
    //start by just seeing if we already have an entry in our data structure
    map_item *temp = find_exact_map_item(time);
+   int position;
+
    if(temp!=NULL)
    {
       //easy button
@@ -86,9 +232,15 @@ map_item *create_new_map_item(int time)
    //we don't have one already, let's do some adding
    
    //create a new map item;
-   temp = malloc(sizeof(map_item));
+   temp = map_arena_allocate(&pending_arena, sizeof(map_item));
+   if(temp == NULL)
+   {
+      return NULL;
+   }
    
-   //default all elements
+   //default all elements.  there's no padding to clear, map_item is
+   //32 bytes of fields (see the asserts on the on-disk layout)
+   memset(temp, 0, sizeof(map_item));
    temp->time = time;
 
    //64-bit offsets
@@ -96,45 +248,123 @@ map_item *create_new_map_item(int time)
    temp->ending_offset = (off_t) -1;
    temp->starting_offset_confirmed = 0;
    temp->ending_offset_confirmed = 0;
-   temp->next = NULL;
    
-   //add it into the list
-   if(map_head == NULL)
-   {
-      map_head = temp;
-   }
-   else
+   //add it into the pending index
+   if(pending_count == pending_capacity)
    {
-      //keep track of previous item so that we can update it's pointer
-      //when iterator is the next largest time
-      map_item *prev = map_head;
-      map_item *iterator;
-      
-      for(iterator = map_head; iterator != NULL ; iterator = iterator->next)
+      int new_capacity = (pending_capacity == 0) ? MAP_PENDING_MERGE_COUNT : pending_capacity * 2;
+      map_item **new_index = realloc(pending_index, new_capacity * sizeof(map_item *));
+      if(new_index == NULL)
       {
-         if(iterator->time > temp->time)
-         {
-            break;
-         }
-         
-         prev = iterator;
+         return NULL;
       }
-      
-      //take some extra care to make sure we do this right if we're trying
-      //to update the head item
-      if(prev == map_head && map_head->time > temp->time)
+      pending_index = new_index;
+      pending_capacity = new_capacity;
+   }
+
+   position = _pending_lower_bound(time);
+   memmove(&pending_index[position + 1], &pending_index[position], (pending_count - position) * sizeof(map_item *));
+   pending_index[position] = temp;
+   pending_count++;
+
+   console_print_debug("Map entry created for time <%lld>.\n",(long long int)temp->time);
+   return temp;
+}
+
+
+
+//******************************************************************************
+// Name:    merge_map_items
+// Notes:   Folds the pending items into the sorted array.  This moves items
+//          around, so it must only be called when nobody is holding on to a
+//          map_item pointer.  Unless forced, small pending sets are left
+//          alone since the binary search copes with them just fine.
+//
+//******************************************************************************
+void merge_map_items(int force)
+{
+   size_t needed;
+   int i;
+   int j;
+   int k;
+
+   if(pending_count == 0 || (!force && pending_count < MAP_PENDING_MERGE_COUNT))
+   {
+      return;
+   }
+
+   //the array has to be ours to grow in.  one that's still in its map file
+   //gets copied out the first time, which is the only copy a loaded map
+   //ever gets.  growing doubles so a map built an item at a time isn't
+   //remapped every merge.
+   needed = (size_t)(map_count + pending_count) * sizeof(map_item);
+   if(!map_region_reserve(&sorted_region, (needed > sorted_region.reserved) ? needed * 2 : needed))
+   {
+      //we can keep limping along on the pending index
+      console_print_debug("Could not merge map items.\n");
+      return;
+   }
+   if(map_items_mapping != NULL)
+   {
+      memcpy(sorted_region.base, map_items, (size_t)map_count * sizeof(map_item));
+      munmap(map_items_mapping, map_items_mapping_size);
+      map_items_mapping = NULL;
+      map_items_mapping_size = 0;
+   }
+   map_items = sorted_region.base;
+
+   //from the back, so every item has moved before anything lands on it
+   i = map_count - 1;
+   j = pending_count - 1;
+   k = map_count + pending_count - 1;
+   while(j >= 0)
+   {
+      if(i >= 0 && map_items[i].time > pending_index[j]->time)
       {
-         temp->next = map_head;
-         map_head = temp;
+         map_items[k--] = map_items[i--];
       }
       else
       {
-         prev->next = temp;
-         temp->next = iterator;
-      }      
+         map_items[k--] = *pending_index[j--];
+      }
+   }
+   map_count += pending_count;
+
+   //the most the map ever holds is right before the arena empties
+   _note_map_usage();
+   map_arena_reset(&pending_arena);
+   pending_count = 0;
+   _enforce_map_budget();
+}
+
+
+
+//******************************************************************************
+// Name:    set_map_budget
+// Notes:   0 turns the budget off
+//
+//******************************************************************************
+void set_map_budget(size_t bytes)
+{
+   map_budget = bytes;
+}
+
+
+
+//******************************************************************************
+// Name:    note_map_query
+// Notes:   The searches call this with every time they look for, the map
+//          keeps full detail around the last MAP_HOT_QUERIES of them
+//
+//******************************************************************************
+void note_map_query(epoch_time time)
+{
+   hot_times[hot_next] = time;
+   hot_next = (hot_next + 1) % MAP_HOT_QUERIES;
+   if(hot_count < MAP_HOT_QUERIES)
+   {
+      hot_count++;
    }
-   console_print_debug("Map entry created for time <%d>.\n",temp->time);
-   return temp;
 }
    
    
@@ -147,18 +377,20 @@ map_item *create_new_map_item(int time)
 //          application logic in it.
 //
 //******************************************************************************  
-map_item *find_exact_map_item(int time)
+map_item *find_exact_map_item(epoch_time time)
 {
-   map_item *iterator = NULL;
-   for(iterator = map_head; iterator != NULL; iterator = iterator->next)
+   int position = _lower_bound(time);
+   if(position < map_count && map_items[position].time == time)
    {
-      //break if it's early
-      if(iterator->time == time)
-      {
-         break;
-      }
+      return &map_items[position];
+   }
+
+   position = _pending_lower_bound(time);
+   if(position < pending_count && pending_index[position]->time == time)
+   {
+      return pending_index[position];
    }
-   return iterator;
+   return NULL;
 }
 
 
@@ -169,28 +401,18 @@ map_item *find_exact_map_item(int time)
 //          doesn't exist, we just return a null pointer.
 //
 //******************************************************************************
-map_item *find_prev_map_item(int time)
+map_item *find_prev_map_item(epoch_time time)
 {
-   //handle the special case first
-   if(time <= map_head->time)
-   {
-      return NULL;
-   }
-   
-   //keep track of our iterator and the previous item
-   map_item *iterator = NULL;
-   map_item *prev = map_head;
-   
-   for(iterator = map_head; iterator != NULL; iterator = iterator->next)
+   //the item just before each lower bound is the best candidate from that
+   //half of the map, take whichever is closer
+   int position = _lower_bound(time);
+   map_item *prev = (position > 0) ? &map_items[position - 1] : NULL;
+
+   position = _pending_lower_bound(time);
+   if(position > 0 && (prev == NULL || pending_index[position - 1]->time > prev->time))
    {
-      if(iterator->time >= time)
-      {
-         break;
-      }
-      prev = iterator;
+      prev = pending_index[position - 1];
    }
-   
-   
    return prev;
 }
 
@@ -202,20 +424,20 @@ map_item *find_prev_map_item(int time)
 //          if one doesn't exist, we just return a null pointer.
 //
 //******************************************************************************
-map_item *find_next_map_item(int time)
+map_item *find_next_map_item(epoch_time time)
 {
-   map_item *iterator;
-   
-   for(iterator = map_head; iterator != NULL; iterator = iterator->next)
+   //lower bound of time+1 is the first item strictly after time
+   int position = _lower_bound(time + 1);
+   map_item *next = (position < map_count) ? &map_items[position] : NULL;
+
+   position = _pending_lower_bound(time + 1);
+   if(position < pending_count && (next == NULL || pending_index[position]->time < next->time))
    {
-      if(iterator->time > time)
-      {
-         break;
-      }
+      next = pending_index[position];
    }
    
-   //this will naturally be null when we search for the last item in the list
-   return iterator;
+   //this will naturally be null when we search for the last item in the map
+   return next;
 }
 
 
@@ -259,11 +481,12 @@ void create_map_file_directory(void)
 //******************************************************************************
 void print_map(void)
 {
-   map_item *iterator;
+   int i;
+   merge_map_items(1);
    console_print_debug("Printing map file...\n");
-   for(iterator = map_head; iterator != NULL; iterator = iterator->next)
+   for(i = 0; i < map_count; i++)
    {
-     console_print_debug("<t:%d, s:%lld(%d), e:%lld(%d)>\n",iterator->time,iterator->starting_offset,iterator->starting_offset_confirmed,iterator->ending_offset,iterator->ending_offset_confirmed);
+     console_print_debug("<t:%lld, s:%lld(%d), e:%lld(%d)>\n",(long long int)map_items[i].time,map_items[i].starting_offset,map_items[i].starting_offset_confirmed,map_items[i].ending_offset,map_items[i].ending_offset_confirmed);
    }
 }
 
@@ -275,35 +498,40 @@ void print_map(void)
 // Notes:   returns the lowest time that we have.  
 //
 //******************************************************************************
-int get_log_start_time(void)
+epoch_time get_log_start_time(void)
 {
-   if(map_head == NULL)
+   epoch_time time = -1;
+   if(map_count > 0)
    {
-      return -1;
+      time = map_items[0].time;
    }
-   return map_head->time;   
+   if(pending_count > 0 && (time == -1 || pending_index[0]->time < time))
+   {
+      time = pending_index[0]->time;
+   }
+   return time;
 }
 
 
 
 //******************************************************************************
 // Name:    get_log_end_time
-// Notes:   Returns the time of the highest entry we have
+// Notes:   Returns the time of the highest entry we have.  Both halves of the
+//          map are sorted so this is just a look at the last of each.
 //
 //******************************************************************************
-int get_log_end_time(void)
+epoch_time get_log_end_time(void)
 {
-   //this is a shitty way to get the end, but we only all this once at the 
-   //start
-   map_item *iterator;
-   for(iterator = map_head; iterator->next != NULL; iterator = iterator->next)
+   epoch_time time = -1;
+   if(map_count > 0)
+   {
+      time = map_items[map_count - 1].time;
+   }
+   if(pending_count > 0 && pending_index[pending_count - 1]->time > time)
    {
-      //do something super funny and awesome...perhaps related to underpants
-      //gnomes.  
+      time = pending_index[pending_count - 1]->time;
    }
-   //iterator->next == NULL which means it's the last entry in the ordered
-   //list
-   return iterator->time;
+   return time;
 }
 
 
@@ -311,123 +539,811 @@ int get_log_end_time(void)
 //******************************************************************************
 // Name:    load_map_file
 // Notes:   tries to pull in the pre-existing map file that has been made for a
-//          file.
+//          file.  Current maps are mapped straight into memory and used in
+//          place.  Original text maps get read the old way, they were named
+//          after the log's mtime so they can only have come from this exact
+//          file, and the next save writes them out in the new format.
+//
+//          Returns the size the log was when the map was saved, or -1 if
+//          there wasn't a usable map.
 //
 //******************************************************************************
-void load_map_file(char *file_name)
+off_t load_map_file(char *file_name, uint64_t fingerprint, off_t log_size)
 {
-   int read_count = 0;
+   char *full_path = get_map_file_path(file_name);
+   map_file_header header;
+   off_t mapped_size = -1;
+   int fd;
+
+   if(full_path == NULL)
+   {
+      return -1;
+   }
+   console_print_info("Using map file: %s\n",full_path);
 
+   fd = open(full_path, O_RDONLY);
+   if(fd < 0)
+   {
+      console_print_info("Map file not found: %s\n",full_path);
+      free(full_path);
+      return -1;
+   }
+
+   if(pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+      memcmp(header.magic, MAP_FILE_MAGIC, sizeof(header.magic)) == 0)
+   {
+      mapped_size = _load_binary_map_file(fd, &header, fingerprint, log_size);
+      close(fd);
+   }
+   else
+   {
+      //text maps only ever held syslog stamps
+      close(fd);
+      if(get_log_time_field() == LOG_TIME_FIELD_SYSLOG && get_log_format() == LOG_FORMAT_SYSLOG &&
+         _load_text_map_file(full_path) > 0)
+      {
+         console_print_info("Text map file will be upgraded to version %d.\n",MAP_FILE_VERSION);
+         mapped_size = log_size;
+      }
+   }
+   free(full_path);
+   if(mapped_size >= 0)
+   {
+      stats_add(STAT_MAP_ENTRIES_LOADED, map_count + pending_count);
+   }
+   return mapped_size;
+}
+
+
+
+//******************************************************************************
+// Name:    peek_map_file
+// Notes:   Just the header and the two end items, without loading anything.
+//          The map only counts if the log hasn't changed since it was saved:
+//          same size, and not modified after the map was written.  There's
+//          no fingerprint check (that needs the log open, which is the whole
+//          point of not doing this), but the map name already pins the inode.
+//
+//******************************************************************************
+int peek_map_file(char *file_name, off_t log_size, time_t log_mtime, epoch_time *start_time, epoch_time *end_time)
+{
+   char *full_path = get_map_file_path(file_name);
+   map_file_header header;
+   struct stat map_stat;
+   map_item first;
+   map_item last;
+   int found = 0;
+   int fd;
+
+   if(full_path == NULL)
+   {
+      return 0;
+   }
+   fd = open(full_path, O_RDONLY);
+   free(full_path);
+   if(fd < 0)
+   {
+      return 0;
+   }
+
+   if(pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+      memcmp(header.magic, MAP_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.version == MAP_FILE_VERSION &&
+      header.entry_size == sizeof(map_item) &&
+      header.time_field == (uint32_t)get_log_time_field() &&
+      (get_forced_log_format() < 0 || header.log_format == (uint32_t)get_forced_log_format()) &&
+      header.entry_count > 0 &&
+      header.log_size == (int64_t)log_size &&
+      fstat(fd, &map_stat) == 0 &&
+      map_stat.st_mtime >= log_mtime &&
+      pread(fd, &first, sizeof(first), sizeof(header)) == sizeof(first) &&
+      pread(fd, &last, sizeof(last), sizeof(header) + (header.entry_count - 1) * sizeof(map_item)) == sizeof(last))
+   {
+      *start_time = first.time;
+      *end_time = last.time;
+      found = 1;
+   }
+   close(fd);
+   return found;
+}
+
+
+
+//******************************************************************************
+// Name:    clear_map
+// Notes:   Throws away everything we know, mapped or not, so the next log
+//          file starts from nothing.
+//
+//******************************************************************************
+void clear_map(void)
+{
+   map_arena_usage usage;
+
+   get_map_usage(&usage);
+   if(usage.reserved > 0)
+   {
+      console_print_info("Map held %d entries in %zu KB (%zu KB reserved in %d block%s, %d huge).\n",
+                         map_count + pending_count,usage.used / 1024,usage.reserved / 1024,usage.blocks,
+                         (usage.blocks == 1) ? "" : "s",usage.huge_blocks);
+      _note_map_usage();
+   }
+   map_arena_release(&pending_arena);
+   pending_count = 0;
+   _release_map_items();
+   hot_count = 0;
+   hot_next = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    get_map_usage
+// Notes:   A map still sitting in its map file counts the whole mapping
+//
+//******************************************************************************
+void get_map_usage(map_arena_usage *usage)
+{
+   memset(usage, 0, sizeof(*usage));
+   map_arena_add_usage(&pending_arena, usage);
+   map_region_add_usage(&sorted_region, (size_t)map_count * sizeof(map_item), usage);
+   if(map_items_mapping != NULL)
+   {
+      usage->reserved += map_items_mapping_size;
+      usage->used += map_items_mapping_size;
+      usage->blocks++;
+   }
+}
+
+
+
+//******************************************************************************
+// Name:    unconfirm_map_end
+// Notes:   The log grew, so the lines of the last time we saw may not have
+//          ended where the file used to.  Same thing the loader does for a
+//          map saved when the log was shorter.
+//
+//******************************************************************************
+void unconfirm_map_end(void)
+{
+   merge_map_items(1);
+   if(map_count > 0)
+   {
+      map_items[map_count - 1].ending_offset_confirmed = 0;
+   }
+}
+
+
+
+//******************************************************************************
+// Name:    detach_map
+// Notes:   Takes the whole map out of the module, leaving it empty like
+//          clear_map would, so the daemon can keep it for the next query
+//          on the same log.
+//
+//******************************************************************************
+map_context *detach_map(void)
+{
+   map_context *context;
+
+   //a failed merge leaves items pending, those can't come along
+   merge_map_items(1);
+   if(pending_count != 0)
+   {
+      return NULL;
+   }
+   context = malloc(sizeof(map_context));
+   if(context == NULL)
+   {
+      return NULL;
+   }
+
+   context->items = map_items;
+   context->count = map_count;
+   context->region = sorted_region;
+   context->mapping = map_items_mapping;
+   context->mapping_size = map_items_mapping_size;
+   memcpy(context->hot_times, hot_times, sizeof(hot_times));
+   context->hot_count = hot_count;
+   context->hot_next = hot_next;
+
+   map_items = NULL;
+   map_count = 0;
+   sorted_region = (map_region)MAP_REGION_INIT;
+   map_items_mapping = NULL;
+   map_items_mapping_size = 0;
+   hot_count = 0;
+   hot_next = 0;
+   return context;
+}
+
+
+
+//******************************************************************************
+// Name:    attach_map
+// Notes:   Puts a detached map back, whatever was loaded gets thrown away.
+//          The context is freed.
+//
+//******************************************************************************
+void attach_map(map_context *context)
+{
+   if(context == NULL)
+   {
+      return;
+   }
+
+   clear_map();
+   map_items = context->items;
+   map_count = context->count;
+   sorted_region = context->region;
+   map_items_mapping = context->mapping;
+   map_items_mapping_size = context->mapping_size;
+   memcpy(hot_times, context->hot_times, sizeof(hot_times));
+   hot_count = context->hot_count;
+   hot_next = context->hot_next;
+   free(context);
+}
+
+
+
+//******************************************************************************
+// Name:    save_map_file
+// Notes:   This dumps the map file to the specified file within the map file
+//          directory
+//
+//          The file is a fixed header followed by the sorted item array exactly
+//          as it sits in memory, so the next run can just map it.  A CRC over
+//          the items catches truncated or hand edited files.  We write to a
+//          temporary and rename it over the old one, that way a map that's
+//          currently mapped (maybe by us) never changes underneath anybody.
+//
+//******************************************************************************
+void save_map_file(char *file_name, uint64_t fingerprint, off_t log_size)
+{
+   char *full_path = get_map_file_path(file_name);
+   char *temp_path = NULL;
+   map_file_header header;
+   size_t items_size;
+   int fd;
+
+   if(full_path == NULL)
+   {
+      return;
+   }
+
+   temp_path = malloc(strlen(full_path) + 5);
+   if(temp_path == NULL)
+   {
+      free(full_path);
+      return;
+   }
+   strcpy(temp_path, full_path);
+   strcat(temp_path, ".tmp");
+
+   //a budget that went down since the map was loaded still applies
+   merge_map_items(1);
+   _enforce_map_budget();
+   items_size = (size_t)map_count * sizeof(map_item);
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+   header.version = MAP_FILE_VERSION;
+   header.entry_size = sizeof(map_item);
+   header.fingerprint = fingerprint;
+   header.entry_count = (uint64_t)map_count;
+   header.log_size = (int64_t)log_size;
+   header.crc = _crc32(map_items, items_size);
+   header.time_field = (uint32_t)get_log_time_field();
+   header.log_format = (uint32_t)get_log_format();
+
+   fd = open(temp_path, O_WRONLY | O_TRUNC | O_CREAT, 0666);
+   if(fd>=0)
+   {
+      console_print_info("Saving map file: %s\n",full_path);
+
+      //if we're at all short on either write the size check on load throws
+      //the file away, so there's nothing clever to do beyond not installing it.
+      if(_write_all(fd, &header, sizeof(header)) && _write_all(fd, map_items, items_size))
+      {
+         close(fd);
+         if(rename(temp_path, full_path) != 0)
+         {
+            console_print_info("%s\n",strerror( errno ));
+            unlink(temp_path);
+         }
+      }
+      else
+      {
+         console_print_debug("Short write on map file, not saving it.\n");
+         close(fd);
+         unlink(temp_path);
+      }
+   }
+   else
+   {
+      console_print_info("%s\n",strerror( errno ));
+   }
+   free(temp_path);
+   free(full_path);
+}
+
+
+
+//******************************************************************************
+// Name:    get_map_file_path
+// Notes:   Builds ~/.tgrepmapfiles/<file_name>.  Caller frees.  Other modules keep
+//          their own caches in the same place.
+//
+//******************************************************************************
+char *get_map_file_path(const char *file_name)
+{
    char *folder = "/.tgrepmapfiles/";
    char *home = getenv("HOME");
    char *full_path = NULL;
-   
+
+   if(home == NULL || file_name == NULL)
+   {
+      return NULL;
+   }
+
    int home_len = strlen(home);
    int file_len = strlen(file_name);
    int folder_len = strlen(folder);
    
    full_path = malloc(home_len + file_len + folder_len + 1);
+   if(full_path == NULL)
+   {
+      return NULL;
+   }
    strcpy(full_path, home);
    strcat(full_path, folder);
    strcat(full_path,file_name);
-   console_print_info("Using map file: %s\n",full_path);
-   
+   return full_path;
+}
+
+
+
+//******************************************************************************
+// Name:    _release_map_items
+// Notes:   Lets go of the sorted array, however it was obtained
+//
+//******************************************************************************
+static void _release_map_items(void)
+{
+   if(map_items_mapping != NULL)
+   {
+      munmap(map_items_mapping, map_items_mapping_size);
+      map_items_mapping = NULL;
+      map_items_mapping_size = 0;
+   }
+   map_region_release(&sorted_region);
+   map_items = NULL;
+   map_count = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _lower_bound
+// Notes:   Index of the first item in the sorted array whose time is >= time.
+//          Written so the compiler can turn the compare into a cmov, there's
+//          no branch for the predictor to get wrong on every step.
+//
+//******************************************************************************
+static int _lower_bound(epoch_time time)
+{
+   const map_item *base = map_items;
+   int n = map_count;
+   int half;
+
+   if(n == 0)
+   {
+      return 0;
+   }
+
+   while(n > 1)
+   {
+      half = n / 2;
+      base = (base[half].time < time) ? base + half : base;
+      n -= half;
+   }
+   return (int)(base - map_items) + (base->time < time);
+}
+
+
+
+//******************************************************************************
+// Name:    _pending_lower_bound
+// Notes:   Same thing for the pending index.
+//
+//******************************************************************************
+static int _pending_lower_bound(epoch_time time)
+{
+   map_item * const *base = pending_index;
+   int n = pending_count;
+   int half;
+
+   if(n == 0)
+   {
+      return 0;
+   }
+
+   while(n > 1)
+   {
+      half = n / 2;
+      base = (base[half]->time < time) ? base + half : base;
+      n -= half;
+   }
+   return (int)(base - pending_index) + ((*base)->time < time);
+}
+
+
+
+//******************************************************************************
+// Name:    _note_map_usage
+// Notes:   Keeps --stats up to date with the biggest map so far
+//
+//******************************************************************************
+static void _note_map_usage(void)
+{
+   map_arena_usage usage;
+
+   if(stats_enabled())
+   {
+      get_map_usage(&usage);
+      stats_max(STAT_MAP_PEAK_BYTES, (long long int)usage.reserved);
+   }
+}
+
+
+
+//******************************************************************************
+// Name:    _enforce_map_budget
+// Notes:   Thins the map until it's comfortably under budget.  Each pass
+//          goes one step coarser away from the recent searches, and if the
+//          coarsest of those still doesn't do it the searched spots get
+//          thinned too.  Only ever called when nobody holds map_item
+//          pointers, and there's nothing pending.
+//
+//******************************************************************************
+static void _enforce_map_budget(void)
+{
+   epoch_time hot[MAP_HOT_QUERIES];
+   int target;
+   int before = map_count;
+   int pass;
+
+   if(map_budget == 0 || pending_count != 0 || (size_t)map_count * sizeof(map_item) <= map_budget)
+   {
+      return;
+   }
+   target = (int)MAP_BUDGET_TARGET(map_budget / sizeof(map_item));
+
+   memcpy(hot, hot_times, (size_t)hot_count * sizeof(epoch_time));
+   qsort(hot, (size_t)hot_count, sizeof(epoch_time), _compare_times);
+   for(pass = 0; pass < COARSEN_STEP_COUNT * 2 && map_count > target; pass++)
+   {
+      _coarsen_map(coarsen_steps[pass % COARSEN_STEP_COUNT], hot, (pass < COARSEN_STEP_COUNT) ? hot_count : 0);
+   }
+
+   stats_add(STAT_MAP_ENTRIES_COARSENED, before - map_count);
+   console_print_info("Map went over its %zu byte budget, thinned it from %d to %d entries.\n",
+                      map_budget,before,map_count);
+}
+
+
+
+//******************************************************************************
+// Name:    _coarsen_map
+// Notes:   Keeps the first item of every step (its start is the checkpoint
+//          a search needs), everything within MAP_HOT_RADIUS of a hot time,
+//          and the first and last items since they're the ends of the log.
+//          The rest are dropped in place.  What's left is still all true,
+//          the gaps just aren't confirmed any more so searches probe them.
+//          The steps all divide each other, so a coarser pass keeps a subset
+//          of what a finer one did.  hot has to be sorted.  Returns how many
+//          went.
+//
+//******************************************************************************
+static int _coarsen_map(epoch_time step, const epoch_time *hot, int hot_total)
+{
+   epoch_time bucket;
+   epoch_time last_bucket = 0;
+   int kept = 0;
+   int dropped;
+   int h = 0;
+   int i;
+
+   for(i = 0; i < map_count; i++)
+   {
+      bucket = map_items[i].time / step;
+      while(h < hot_total && hot[h] + MAP_HOT_RADIUS < map_items[i].time)
+      {
+         h++;
+      }
+      if(i == 0 || i == map_count - 1 || bucket != last_bucket ||
+         (h < hot_total && hot[h] - MAP_HOT_RADIUS <= map_items[i].time))
+      {
+         map_items[kept++] = map_items[i];
+      }
+      last_bucket = bucket;
+   }
+   dropped = map_count - kept;
+   map_count = kept;
+   return dropped;
+}
+
+
+
+//******************************************************************************
+// Name:    _compare_times
+// Notes:   qsort() order for the hot times
+//
+//******************************************************************************
+static int _compare_times(const void *a, const void *b)
+{
+   epoch_time first = *(const epoch_time *)a;
+   epoch_time second = *(const epoch_time *)b;
+
+   return (first > second) - (first < second);
+}
+
+
+
+//******************************************************************************
+// Name:    _load_binary_map_file
+// Notes:   Checks that the map is one we understand and was made for this log
+//          file, then maps it private and writable so probes can keep
+//          updating items in place without touching the file.  Anything that
+//          was learned before the load (the probes at the start and end of
+//          the log) gets folded back in on top.
+//
+//          If the log has grown since the save everything we knew still
+//          holds except the end of the last item, which may well have kept
+//          going into the new data.  If it shrank it got truncated (or
+//          copytruncate'd) and the map is useless.
+//
+//******************************************************************************
+static off_t _load_binary_map_file(int fd, map_file_header *header, uint64_t fingerprint, off_t log_size)
+{
+   struct stat map_stat;
+   size_t items_size;
+   char *mapping;
+   map_item *learned;
+   int learned_count;
+   map_region learned_region;
+   int i;
+
+   if(header->version != MAP_FILE_VERSION || header->entry_size != sizeof(map_item))
+   {
+      console_print_info("Discarding map file with version %u.\n",header->version);
+      return -1;
+   }
+   if(header->time_field != (uint32_t)get_log_time_field())
+   {
+      console_print_info("Discarding map file, its times come from a different field.\n");
+      return -1;
+   }
+   if(header->log_format != (uint32_t)get_log_format())
+   {
+      console_print_info("Discarding map file, it was built for %s stamps.\n",get_log_format_name((log_format)header->log_format));
+      return -1;
+   }
+   if(header->fingerprint != fingerprint)
+   {
+      console_print_info("Discarding map file, the log was rotated or replaced.\n");
+      return -1;
+   }
+   if(header->log_size > (int64_t)log_size)
+   {
+      console_print_info("Discarding map file, the log was truncated.\n");
+      return -1;
+   }
+
+   items_size = (size_t)header->entry_count * sizeof(map_item);
+   if(fstat(fd, &map_stat) != 0 || (size_t)map_stat.st_size != sizeof(*header) + items_size)
+   {
+      console_print_info("Discarding truncated map file.\n");
+      return -1;
+   }
+   if(header->entry_count == 0)
+   {
+      return -1;
+   }
+
+   mapping = mmap(NULL, (size_t)map_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+   if(mapping == MAP_FAILED)
+   {
+      console_print_info("%s\n",strerror( errno ));
+      return -1;
+   }
+   if(_crc32(mapping + sizeof(*header), items_size) != header->crc)
+   {
+      console_print_info("Discarding map file with a bad checksum.\n");
+      munmap(mapping, (size_t)map_stat.st_size);
+      return -1;
+   }
+
+   //swap the mapped array in, then put back whatever we already knew
+   merge_map_items(1);
+   learned = map_items;
+   learned_count = map_count;
+   learned_region = sorted_region;
+   sorted_region = (map_region)MAP_REGION_INIT;
+
+   map_items = (map_item *)(mapping + sizeof(*header));
+   map_count = (int)header->entry_count;
+   map_items_mapping = mapping;
+   map_items_mapping_size = (size_t)map_stat.st_size;
+
+   if(header->log_size < (int64_t)log_size)
+   {
+      map_items[map_count - 1].ending_offset_confirmed = 0;
+   }
+
+   for(i = 0; i < learned_count; i++)
+   {
+      _absorb_map_item(&learned[i]);
+   }
+   map_region_release(&learned_region);
+   console_print_info("Mapped %d entries from map file.\n",map_count);
+   return (off_t)header->log_size;
+}
+
+
+
+//******************************************************************************
+// Name:    _load_text_map_file
+// Notes:   The original map format, one line per item with a simple additive
+//          checksum on the end.  Only kept around so we can upgrade them.
+//          Its times count from midnight of the log's first day, which
+//          parse_time knows once the log is open.
+//
+//******************************************************************************
+static int _load_text_map_file(char *full_path)
+{
+   int read_count = 0;
+
    //I'm cheesing this a bit because i want the simplicity of a nice
    //formatted get line interface
-   FILE *fd = fopen(full_path, "r" );
+   epoch_time start_day_time = get_log_start_day_time();
+   FILE *fd = (start_day_time < 0) ? NULL : fopen(full_path, "r" );
    if(fd!=NULL)
    {
       int t;
-      off_t so;
+      long long int so;
       int so_c;
-      off_t eo;
+      long long int eo;
       int eo_c;
       long long int cs;
-      console_print_info("Loading map file: %s\n",full_path);
+      map_item loaded;
+      console_print_info("Loading text map file: %s\n",full_path);
       while(6==fscanf(fd, "%d %lld %d %lld %d %lld\n", &t, &so, &so_c, &eo, &eo_c, &cs))
       {
          if((t+so+so_c+eo+eo_c)==cs)
          {
             console_print_debug("Found map item for time: %d\n",t);   
-            map_item *nm = create_new_map_item(t);
-            if(nm != NULL)
+            memset(&loaded, 0, sizeof(loaded));
+            loaded.time = start_day_time + t * EPOCH_TIME_PER_SECOND;
+            loaded.starting_offset = so;
+            loaded.starting_offset_confirmed = so_c;
+            loaded.ending_offset = eo;
+            loaded.ending_offset_confirmed = eo_c;
+            if(_absorb_map_item(&loaded))
             {
                read_count++;
-               nm->starting_offset = so;
-               nm->starting_offset_confirmed = so_c;
-               nm->ending_offset = eo;
-               nm->ending_offset_confirmed = eo_c;
             }
          }
       }
       console_print_info("Read in %d entries from map file.\n",read_count);
       fclose(fd);
+      merge_map_items(1);
    }
-   else
+   return read_count;
+}
+
+
+
+//******************************************************************************
+// Name:    _absorb_map_item
+// Notes:   Merges what some other source knows about a time into our map.  A
+//          confirmed offset always wins, otherwise we keep the widest guess
+//          (lowest start, highest end) like the probes do.
+//
+//******************************************************************************
+static int _absorb_map_item(const map_item *source)
+{
+   map_item *target = create_new_map_item(source->time);
+   if(target == NULL)
    {
-      console_print_info("Map file not found: %s\n",full_path);
+      return 0;
    }
+
+   if(!target->starting_offset_confirmed)
+   {
+      if(source->starting_offset_confirmed ||
+         (source->starting_offset != -1 &&
+          (target->starting_offset == -1 || source->starting_offset < target->starting_offset)))
+      {
+         target->starting_offset = source->starting_offset;
+         target->starting_offset_confirmed = source->starting_offset_confirmed;
+      }
+   }
+
+   if(!target->ending_offset_confirmed)
+   {
+      if(source->ending_offset_confirmed || source->ending_offset > target->ending_offset)
+      {
+         target->ending_offset = source->ending_offset;
+         target->ending_offset_confirmed = source->ending_offset_confirmed;
+      }
+   }
+   return 1;
 }
 
 
 
 //******************************************************************************
-// Name:    save_map_file
-// Notes:   This dumps the map file to the specified file within the map file
-//          directory
+// Name:    _write_all
+// Notes:   write() until it's all out or the disk says no
 //
-//          This actually keeps a simple additive checksum for everything in the
-//          line to prevent someone from modifying the file by hand (it's
-//          trivial to get around, but stops stupidity).
+//******************************************************************************
+static int _write_all(int fd, const void *data, size_t size)
+{
+   const char *working = data;
+   ssize_t written;
+
+   while(size > 0)
+   {
+      written = write(fd, working, size);
+      if(written < 0 && errno == EINTR)
+      {
+         continue;
+      }
+      if(written <= 0)
+      {
+         return 0;
+      }
+      working += written;
+      size -= (size_t)written;
+   }
+   return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _crc32
+// Notes:   Plain table driven CRC-32 (the zlib/ethernet one).  The table gets
+//          built the first time through.
 //
 //******************************************************************************
-void save_map_file(char *file_name)
+static uint32_t _crc32(const void *data, size_t size)
 {
-   char output_buffer[1024];
-   
-   char *folder = "/.tgrepmapfiles/";
-   char *home = getenv("HOME");
-   char *full_path = NULL;
-   
-   int home_len = strlen(home);
-   int file_len = strlen(file_name);
-   int folder_len = strlen(folder);
-   
-   full_path = malloc(home_len + file_len + folder_len + 1);
-   strcpy(full_path, home);
-   strcat(full_path, folder);
-   strcat(full_path,file_name);
-   
-   int fd = open(full_path, O_RDWR | O_TRUNC | O_CREAT, 0666);
-   if(fd>0)
+   static uint32_t table[256];
+   static int table_ready = 0;
+   const unsigned char *working = data;
+   uint32_t crc = 0xFFFFFFFFu;
+   uint32_t value;
+   int i;
+   int bit;
+
+   if(!table_ready)
    {
-      console_print_info("Saving map file: %s\n",full_path);
-      map_item *iterator = map_head;
-      for(;iterator!=NULL;iterator=iterator->next)
+      for(i = 0; i < 256; i++)
       {
-         int t = iterator->time;
-         off_t so = iterator->starting_offset;
-         int so_c = iterator->starting_offset_confirmed;
-         off_t eo = iterator->ending_offset;
-         int eo_c = iterator->ending_offset_confirmed;
-         long long int cs = t + so + so_c + eo + eo_c;
-         sprintf(output_buffer,"%d %lld %d %lld %d %lld\n",t,so,so_c,eo,eo_c,cs);
-         int resp = write(fd,output_buffer,strlen(output_buffer));
-         
-         //we're not going to do anything but output some debug messages here
-         //if we're at all short on our write, the checksums will fail the
-         //line/lines.
-         if(resp < strlen(output_buffer))
+         value = (uint32_t)i;
+         for(bit = 0; bit < 8; bit++)
          {
-            console_print_debug("Only wrote %d of %d requested to map file\n.",resp,strlen(output_buffer));
+            value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
          }
-         
+         table[i] = value;
       }
-      close(fd);
+      table_ready = 1;
    }
-   else
+
+   while(size-- > 0)
    {
-      console_print_info("%s\n",strerror( errno ));
-   }      
+      crc = table[(crc ^ *working++) & 0xFF] ^ (crc >> 8);
+   }
+   return crc ^ 0xFFFFFFFFu;
 }
-
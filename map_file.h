@@ -29,10 +29,21 @@
 #ifndef __TGREP_MAP_FILE_H__
 #define __TGREP_MAP_FILE_H__
 
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "parse_time.h"
+#include "map_arena.h"
+
+//map items get written to (and mapped back from) the map files exactly as
+//they are laid out here, so any change to this structure needs a new map
+//file version.
+
 struct _map_item {
    
-   //time as reference to 0 from starting day
-   int time;
+   //the time this item is for, epoch milliseconds (see parse_time).  a
+   //whole second unless the line times carry a fraction
+   epoch_time time;
    
    //position of the first character of the first line
    off_t starting_offset;
@@ -44,10 +55,6 @@ struct _map_item {
    //found the start and end.  Otherwise we're just using guesses
    int starting_offset_confirmed;
    int ending_offset_confirmed;
-
-   //used for the run time data structure so we can insert in the middle to
-   //keep the list nice and ordered.
-   struct _map_item *next;
 };
 
 typedef struct _map_item map_item;
@@ -56,29 +63,74 @@ typedef struct _map_item map_item;
 //creating a new map item will create a new map item for time in the correct
 //position and return a pointer to it.  If the time already exists it will
 //return the existing map item.   
-map_item *create_new_map_item(int time);   
+map_item *create_new_map_item(epoch_time time);   
+
+//pointers handed out by the create/find functions stay good until the next
+//merge, which packs new items into the sorted array.  only call this when no
+//map_item pointers are being held.  without force, it only merges once enough
+//new items have piled up to be worth it.
+void merge_map_items(int force);
    
 //we're passing around real pointers to the structure so we should be able to 
 //just modify this in place as I don't want the map items to have a lot of 
 //programming logic in them, just scanning and ordering  
-map_item *find_exact_map_item(int time);
-map_item *find_prev_map_item(int time);
-map_item *find_next_map_item(int time);   
+map_item *find_exact_map_item(epoch_time time);
+map_item *find_prev_map_item(epoch_time time);
+map_item *find_next_map_item(epoch_time time);   
 
 //pre cooked files need to be stored so we can speed up the lookup
 void create_map_file_directory(void);
 
+//full path of file_name inside the map file directory, caller frees
+char *get_map_file_path(const char *file_name);
+
 //not sure where this needs to go, it's more related to the file, but the
 //map structure actually HAS the information handy
-int get_log_start_time(void);
-int get_log_end_time(void);
+epoch_time get_log_start_time(void);
+epoch_time get_log_end_time(void);
 
 //debugging tool used to verify the map file creation is going as planned
 //shouldn't be used for real builds!
 void print_map(void);
 
 //now we're going to make the file functions in order to pre parse the data on
-//run.
-void load_map_file(char *file_name);
-void save_map_file(char *file_name);
+//run.  the fingerprint comes from the log file and makes sure we never use a
+//map that was built for some other file.  log_size is how big the log is
+//right now, load hands back how big it was when the map was saved (or -1 if
+//there was no usable map) so the caller can pick up any new data.
+off_t load_map_file(char *file_name, uint64_t fingerprint, off_t log_size);
+void save_map_file(char *file_name, uint64_t fingerprint, off_t log_size);
+
+//a quick look at a saved map without loading it, for deciding whether a log
+//is worth opening at all.  gives the first and last times and returns 1 only
+//if the map still describes the log exactly (same size, saved after its last
+//modification), 0 otherwise.
+int peek_map_file(char *file_name, off_t log_size, time_t log_mtime, epoch_time *start_time, epoch_time *end_time);
+
+//empties the map so a different log file can be searched.  with -v it says
+//how much memory the map took first.
+void clear_map(void);
+
+//the memory the map is using right now
+void get_map_usage(map_arena_usage *usage);
+
+//the most bytes of items a map keeps (and saves), 0 for no limit.  past it
+//the map drops detail far from recent searches, see note_map_query.
+void set_map_budget(size_t bytes);
+
+//the searches say what times they're after, the map keeps every item it
+//has around those when it has to thin itself out
+void note_map_query(epoch_time time);
+
+//for the daemon, which keeps maps around between queries: detach takes the
+//map out (leaving the module empty, like clear_map), attach puts it back and
+//frees the context
+typedef struct _map_context map_context;
+
+map_context *detach_map(void);
+void attach_map(map_context *context);
+
+//the log grew past where the map last saw it end, so the lines of its last
+//time may still be going
+void unconfirm_map_end(void);
 #endif
@@ -17,8 +17,11 @@
 //******************************************************************************
 // Name:    parse_time.c
 // Notes:   This file has the helper functions to parse the log and search
-//          times.  Times are represented as number of seconds past 00:00:00 on
-//          the first log file day
+//          times.  Times are represented as milliseconds since the epoch,
+//          with the year worked out from the log's mtime (see
+//          set_log_time_start).  Everything works on (pointer, length) spans
+//          and nothing here allocates, the probes call it once a line from
+//          several threads.
 //
 // Rev:     17-Feb-2011 Initial Rev
 //
@@ -30,7 +33,6 @@
 //******************************************************************************
 // Library includes
 //******************************************************************************
-#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -48,10 +50,56 @@
 //******************************************************************************
 
 //Little tools to make the code easier to read and more consise
-#define IS_CHAR(x) (((x | 0x20) >= 'a') && ((x | 0x20) <= 'z'))
-#define IS_NUM(x) (x >='0' && x <='9')
-#define IS_SPACE(x) (x == ' ')
-#define IS_COLON(x) (x == ':')
+#define IS_CHAR(x) ((((x) | 0x20) >= 'a') && (((x) | 0x20) <= 'z'))
+#define IS_NUM(x) ((x) >='0' && (x) <='9')
+#define IS_SPACE(x) ((x) == ' ')
+#define IS_COLON(x) ((x) == ':')
+
+//the three letters of a month name, lowercased, as one number to switch on
+#define MONTH_KEY(a,b,c) (((a) << 16) | ((b) << 8) | (c))
+
+//a stamp's day is two digits (or a blank and a digit), so it can't go past
+//99 however broken the line is
+#define LOG_DAY_COUNT (100)
+
+//the syslog stamp, 'a' is a letter, '0' a digit, '_' a blank or a digit and
+//anything else is itself.  the digits are always in the same place so
+//they're read straight out of the line.
+#define SYSLOG_LAYOUT "aaa _0 00:00:00"
+#define SYSLOG_DATE_LENGTH (6)
+#define SYSLOG_HOUR_AT (7)
+#define SYSLOG_MINUTE_AT (10)
+#define SYSLOG_SECOND_AT (13)
+
+//the longest search string we'll consider, and the longest hh:mm:ss part
+//of one end of it
+#define SEARCH_STRING_MAX (64)
+#define SEARCH_CLOCK_MAX (8)
+
+//"dd/Mmm/yyyy:hh:mm:ss.mmm", the inside of haproxy's accept date, and how
+//far into a line we'll look for its '['
+#define ACCEPT_DATE_LENGTH (24)
+#define ACCEPT_DATE_SEARCH (256)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//one end of a search string, picked apart but not turned into a time yet
+struct _search_point {
+    int has_date;
+    int year;
+    int month;
+    int day;
+    const char *clock;
+    size_t clock_length;
+    int fraction;
+    int fraction_digits;
+};
+
+typedef struct _search_point search_point;
 
 
 
@@ -59,12 +107,26 @@
 // Module Specific Global Variables
 //******************************************************************************
 
-//this keeps track of the first and second log days (or one log day)
-static int log_time_start_day = -1;
+//midnight of every month and day a stamp can show, with the year already
+//sorted out, so turning a stamp into a time is a lookup and an add
+static epoch_time log_day_times[12][LOG_DAY_COUNT];
+static int log_start_month = -1;
+static int log_start_day = -1;
+static log_time_field time_field = LOG_TIME_FIELD_SYSLOG;
 
 //internal helpers
-static int parse_search_time(char *time_string, int pad);
-static int parse_log_day(char *time_string);
+static int _clock_seconds(const char *text, size_t length, int pad);
+static int _log_day(const char *line);
+static int _matches_layout(const char *text, const char *layout, size_t length);
+static int _split_search_string(const char *text, size_t length, search_point *first, search_point *second, int *is_range);
+static int _parse_search_point(const char *text, size_t length, search_point *point);
+static int _parse_date_field(const char **text, const char *end, int *value);
+static epoch_time _search_point_clock(const search_point *point, int pad);
+static int _parse_accept_date(const char *text, epoch_time *accept_time);
+static int _fixed_number(const char *digits, int count);
+static int _last_year_for(int month, int day, time_t reference);
+static int _date_parts(epoch_time time, int *year, int *month, int *day);
+static int64_t _days_from_civil(int year, int month, int day);
 
 
 
@@ -83,52 +145,21 @@ static int parse_log_day(char *time_string);
 //          line arg is the search time.
 //
 //******************************************************************************
-int is_valid_search_time(char *time_string)
+int is_valid_search_time(const char *text, size_t length)
 {
-    if(time_string == NULL)
-    {
-        return 0;
-    }
-
-    int i;
+    search_point first;
+    search_point second;
+    int is_range;
 
-    int digit_count = 0;
-    int colon_count = 0;
-    int hyphen_count = 0;
-
-    //simple parse of the string making sure there's nothing super out of the
-    //ordinary about it
-    for(i=0; time_string[i]!= '\0'; i++)
+    if(text == NULL)
     {
-        if(time_string[i] >= '0' && time_string[i] <= '9')
-        {
-            digit_count++;
-        }
-        else if(time_string[i] == ':')
-        {
-            colon_count++;
-        }
-        else if(time_string[i] == '-')
-        {
-            hyphen_count++;
-        }
-        else
-        {
-            return 0;
-        }
+        return 0;
     }
 
-    //again, make sure no one does anything stupid.  This really only prevents
+    //parsing it is the only real way to tell, this really only prevents
     //someone from doing `tgrep -----:::::0000000000000000000000:::::------' and
     //hoping it does something logical
-    if(hyphen_count > 1 || colon_count > 4 || digit_count > 12)
-    {
-        return 0;
-    }
-    else
-    {
-        return 1;
-    }
+    return _split_search_string(text, length, &first, &second, &is_range);
 }
 
 
@@ -139,293 +170,791 @@ int is_valid_search_time(char *time_string)
 //          sure that the line we're looking at matches the log file format
 //
 //******************************************************************************
-int is_valid_log_time(char *time_string)
+int is_valid_log_time(const char *line, size_t length)
 {
-    if(time_string == NULL)
+    if(line == NULL || length < LOG_TIME_LENGTH)
     {
         //fail.
         return 0;
     }
+    return _matches_layout(line, SYSLOG_LAYOUT, LOG_TIME_LENGTH);
+}
 
-    int i = 0;
 
-    //note: there's probably a more clever way to do this, but whatever...
-    //constantly try to fail the string.
 
-    //check the month portion
-    if(!IS_CHAR(time_string[i]))
+//******************************************************************************
+// Name:    parse_search_string
+// Notes:   Takes in the string that's provided on the command line and searches
+//          it for the start and stop times of the search.  The times returned
+//          are non-descript (they don't line up with a day), so the application
+//          has to do something with them that makes sense.
+//
+//******************************************************************************
+int parse_search_string(const char *text, size_t length, epoch_time *start_time, epoch_time *end_time, int *dated)
+{
+    search_point first;
+    search_point second;
+    search_point *last;
+    int is_range;
+    int year;
+    int end_year;
+    epoch_time start_clock;
+    epoch_time end_clock;
+
+    if(text == NULL || !_split_search_string(text, length, &first, &second, &is_range))
     {
         return 0;
     }
-    i++;
-    if(!IS_CHAR(time_string[i]))
+
+    //no range means the whole of whatever was given, 6 is 06:00:00-06:59:59
+    last = is_range ? &second : &first;
+    start_clock = _search_point_clock(&first, 0);
+    end_clock = _search_point_clock(last, 59);
+    if(!first.has_date)
     {
-        return 0;
+        *start_time = start_clock;
+        *end_time = end_clock;
+        *dated = SEARCH_UNDATED;
+        return 1;
     }
-    i++;
-    if(!IS_CHAR(time_string[i]))
+
+    //a date without a year goes in SEARCH_YEAR_BASE for now, each log
+    //works out the real one for itself (see resolve_search_year).  if only
+    //the end has a year the start goes by it.
+    *dated = SEARCH_DATED;
+    year = first.year;
+    if(year < 0 && last->has_date && last->year >= 0)
     {
-        return 0;
+        year = last->year - ((last->month < first.month || (last->month == first.month && last->day < first.day)) ? 1 : 0);
     }
-    i++;
-    if(!IS_SPACE(time_string[i]))
+    else if(year < 0)
     {
-        return 0;
+        year = SEARCH_YEAR_BASE;
+        *dated = SEARCH_DATED_NO_YEAR;
     }
-    i++;
-    if(!IS_SPACE(time_string[i])&&!IS_NUM(time_string[i]))
+    *start_time = _days_from_civil(year, first.month, first.day) * EPOCH_TIME_PER_DAY + start_clock;
+    if(last->has_date && last != &first)
     {
-        return 0;
+        end_year = last->year;
+        if(end_year < 0)
+        {
+            end_year = year + ((last->month < first.month || (last->month == first.month && last->day < first.day)) ? 1 : 0);
+        }
+        *end_time = _days_from_civil(end_year, last->month, last->day) * EPOCH_TIME_PER_DAY + end_clock;
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
+    else
     {
-        return 0;
+        //an end without a date is on the start's day, or the one after if
+        //it's earlier in the day (the same as an undated range wrapping)
+        *end_time = _days_from_civil(year, first.month, first.day) * EPOCH_TIME_PER_DAY + end_clock;
+        if(*end_time < *start_time)
+        {
+            *end_time += EPOCH_TIME_PER_DAY;
+        }
     }
-    i++;
-    if(!IS_SPACE(time_string[i]))
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    resolve_search_year
+// Notes:   Tries the month and day in the year before the log starts, the
+//          year it starts and the one after, and takes the first that puts
+//          the search over some of the log.  If none do it goes the first
+//          time it comes around on or after the log's first day, the same
+//          way set_log_time_start dates a log's later lines.  A search with
+//          no end is only over the log if it starts in it.  The end keeps
+//          however many years it was past SEARCH_YEAR_BASE, so a range over
+//          new year still wraps.  A 29th of February lands on the 1st of
+//          March in a year without one.
+//
+//******************************************************************************
+void resolve_search_year(epoch_time *start_time, epoch_time *end_time, epoch_time first_time, epoch_time last_time)
+{
+    epoch_time start_clock = *start_time % EPOCH_TIME_PER_DAY;
+    epoch_time end_clock = *end_time % EPOCH_TIME_PER_DAY;
+    epoch_time start;
+    epoch_time end;
+    int first_year;
+    int year;
+    int month;
+    int day;
+    int end_year;
+    int end_month;
+    int end_day;
+
+    if(!_date_parts(first_time, &first_year, &month, &day) || !_date_parts(*start_time, &year, &month, &day) ||
+       !_date_parts((*end_time == EPOCH_TIME_MAX) ? *start_time : *end_time, &end_year, &end_month, &end_day))
     {
-        return 0;
+        return;
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
+
+    for(year = first_year - 1; year <= first_year + 1; year++)
     {
-        return 0;
+        start = _days_from_civil(year, month, day) * EPOCH_TIME_PER_DAY + start_clock;
+        end = _days_from_civil(year + end_year - SEARCH_YEAR_BASE, end_month, end_day) * EPOCH_TIME_PER_DAY + end_clock;
+        if(start <= last_time && ((*end_time == EPOCH_TIME_MAX) ? start : end) >= first_time)
+        {
+            break;
+        }
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
+    if(year > first_year + 1)
     {
-        return 0;
+        year = (_days_from_civil(first_year, month, day) < first_time / EPOCH_TIME_PER_DAY) ? first_year + 1 : first_year;
+        start = _days_from_civil(year, month, day) * EPOCH_TIME_PER_DAY + start_clock;
+        end = _days_from_civil(year + end_year - SEARCH_YEAR_BASE, end_month, end_day) * EPOCH_TIME_PER_DAY + end_clock;
     }
-    i++;
-    if(!IS_COLON(time_string[i]))
+
+    *start_time = start;
+    if(*end_time != EPOCH_TIME_MAX)
     {
-        return 0;
+        *end_time = end;
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
+}
+
+
+
+//******************************************************************************
+// Name:    parse_log_time
+// Notes:   Grab the time from the log entry.  The year comes out of the
+//          table set_log_time_start filled in, so a log can go on for as
+//          many days as it likes (up to a year).  Anything that isn't a
+//          stamp is turned down, it's cheap next to finding the line.
+//
+//******************************************************************************
+int parse_log_time(const char *line, size_t length, epoch_time *log_time)
+{
+    int log_month;
+
+    if(!is_valid_log_time(line, length) || (log_month = parse_log_month(line)) == -1)
     {
         return 0;
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
-    {
-        return 0;
+
+    //the layout check means every digit is where it should be, so the
+    //clock comes straight out of the line
+    *log_time = combine_log_time(log_month, _log_day(line),
+                                 _fixed_number(line + SYSLOG_HOUR_AT, 2) * 3600 +
+                                 _fixed_number(line + SYSLOG_MINUTE_AT, 2) * 60 +
+                                 _fixed_number(line + SYSLOG_SECOND_AT, 2));
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    combine_log_time
+// Notes:   The date half of parse_log_time.  The month and day come from a
+//          stamp that's already been checked so they're always in the table.
+//
+//******************************************************************************
+epoch_time combine_log_time(int log_month, int log_day, int clock_seconds)
+{
+    return log_day_times[log_month][log_day] + clock_seconds * EPOCH_TIME_PER_SECOND;
+}
+
+
+
+//******************************************************************************
+// Name:    combine_dated_log_time
+// Notes:   No table for these, the year could be anything
+//
+//******************************************************************************
+epoch_time combine_dated_log_time(int year, int log_month, int log_day, int clock_seconds)
+{
+    return _days_from_civil(year, log_month + 1, log_day) * EPOCH_TIME_PER_DAY + clock_seconds * EPOCH_TIME_PER_SECOND;
+}
+
+
+
+//******************************************************************************
+// Name:    parse_log_month
+// Notes:   Upper or lower case, just like is_valid_log_time
+//
+//******************************************************************************
+int parse_log_month(const char *time_string)
+{
+    switch(MONTH_KEY(time_string[0] | 0x20, time_string[1] | 0x20, time_string[2] | 0x20))
+    {
+    case MONTH_KEY('j','a','n'): return 0;
+    case MONTH_KEY('f','e','b'): return 1;
+    case MONTH_KEY('m','a','r'): return 2;
+    case MONTH_KEY('a','p','r'): return 3;
+    case MONTH_KEY('m','a','y'): return 4;
+    case MONTH_KEY('j','u','n'): return 5;
+    case MONTH_KEY('j','u','l'): return 6;
+    case MONTH_KEY('a','u','g'): return 7;
+    case MONTH_KEY('s','e','p'): return 8;
+    case MONTH_KEY('o','c','t'): return 9;
+    case MONTH_KEY('n','o','v'): return 10;
+    case MONTH_KEY('d','e','c'): return 11;
+    default: return -1;
     }
-    i++;
-    if(!IS_COLON(time_string[i]))
+}
+
+
+
+//******************************************************************************
+// Name:    set_log_time_start
+// Notes:   sets up the log start day and works out every other day's time
+//          from it.  It parses the string itself to make it more
+//          straightforward to callers.
+//
+//******************************************************************************
+int set_log_time_start(const char *line, size_t length, time_t reference)
+{
+    int start_year;
+    int month;
+    int day;
+
+    //only the date has to be there, the clock isn't used
+    if(line == NULL || length < SYSLOG_DATE_LENGTH || !_matches_layout(line, SYSLOG_LAYOUT, SYSLOG_DATE_LENGTH))
     {
         return 0;
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
+
+    log_start_month = parse_log_month(line);
+    log_start_day = _log_day(line);
+    if(log_start_month == -1 || log_start_day < 1 || log_start_day > 31)
     {
+        log_start_month = -1;
         return 0;
     }
-    i++;
-    if(!IS_NUM(time_string[i]))
+
+    start_year = _last_year_for(log_start_month + 1, log_start_day, reference);
+    for(month = 0; month < 12; month++)
     {
-        return 0;
+        for(day = 0; day < LOG_DAY_COUNT; day++)
+        {
+            //anything before the first day has to be in the next year
+            int year = start_year + ((month < log_start_month || (month == log_start_month && day < log_start_day)) ? 1 : 0);
+            log_day_times[month][day] = _days_from_civil(year, month + 1, day) * EPOCH_TIME_PER_DAY;
+        }
     }
-
-    //WIN!
     return 1;
 }
 
 
 
 //******************************************************************************
-// Name:    parse_search_string
-// Notes:   Takes in the string that's provided on the command line and searches
-//          it for the start and stop times of the search.  The times returned
-//          are non-descript (they don't line up with a day), so the application
-//          has to do something with them that makes sense.
+// Name:    get_log_start_day_time
+// Notes:   -1 until set_log_time_start has seen a log
 //
 //******************************************************************************
-int parse_search_string(char *time_string, int *start_time, int *end_time)
+epoch_time get_log_start_day_time(void)
 {
-    if(time_string == NULL)
+    if(log_start_month == -1)
     {
-        return 0;
+        return -1;
     }
+    return log_day_times[log_start_month][log_start_day];
+}
 
-    //need to keep 2 points because strtok won't nest right with our parse
-    //time function -- stupid side-effects.
-    char *start_string;
-    char *end_string;
 
-    //see if we're given a range or if we have to take an implied range
 
+//******************************************************************************
+// Name:    format_log_time
+// Notes:   gmtime since the times are the log's wall clock taken as UTC.
+//          The milliseconds only show up when there are some.
+//
+//******************************************************************************
+char *format_log_time(epoch_time time, char *text)
+{
+    time_t seconds = (time_t)(time / EPOCH_TIME_PER_SECOND);
+    int milliseconds = (int)(time % EPOCH_TIME_PER_SECOND);
+    struct tm parts;
+    size_t length;
 
-    if(strchr(time_string,'-') != NULL)
+    if(gmtime_r(&seconds, &parts) == NULL ||
+       (length = strftime(text, LOG_TIME_TEXT_SIZE, "%Y-%m-%d %H:%M:%S", &parts)) == 0)
+    {
+        snprintf(text, LOG_TIME_TEXT_SIZE, "%lld", (long long int)time);
+    }
+    else if(milliseconds != 0)
     {
+        snprintf(text + length, LOG_TIME_TEXT_SIZE - length, ".%03d", milliseconds);
+    }
+    return text;
+}
 
-        //real range given, delimiter doesn't really matter on the second call
-        start_string = strtok(time_string,"-");
-        end_string   = strtok(NULL, "-");
 
-        if(start_string == NULL || end_string == NULL)
-        {
-            return 0;
-        }
 
-        *start_time = parse_search_time(start_string, 0);
-        *end_time   = parse_search_time(end_string, 59);
+//******************************************************************************
+// Name:    set_log_time_field
+// Notes:   Chooses where refine_log_time gets its times
+//
+//******************************************************************************
+void set_log_time_field(log_time_field field)
+{
+    time_field = field;
+}
+
+
+
+//******************************************************************************
+// Name:    get_log_time_field
+// Notes:   The map saves this with its keys
+//
+//******************************************************************************
+log_time_field get_log_time_field(void)
+{
+    return time_field;
+}
+
+
+
+//******************************************************************************
+// Name:    refine_log_time
+// Notes:   The haproxy line has a "[pid]" before the accept date, so every
+//          '[' near the front gets a look until one parses.  Nothing to do
+//          for the plain syslog stamp.  No falling back to the syslog stamp
+//          when there isn't one, the two clocks can be seconds apart and a
+//          line cut off at the end of a probe window would get the wrong key.
+//
+//******************************************************************************
+epoch_time refine_log_time(epoch_time stamp_time, const char *line, size_t length)
+{
+    const char *bracket;
+    const char *end;
+    epoch_time accept_time;
+
+    if(time_field != LOG_TIME_FIELD_ACCEPT)
+    {
+        return stamp_time;
     }
-    else
+
+    end = line + ((length < ACCEPT_DATE_SEARCH) ? length : ACCEPT_DATE_SEARCH);
+    while((bracket = memchr(line, '[', (size_t)(end - line))) != NULL)
     {
+        if((size_t)(end - bracket) > ACCEPT_DATE_LENGTH + 1 && bracket[ACCEPT_DATE_LENGTH + 1] == ']' &&
+           _parse_accept_date(bracket + 1, &accept_time))
+        {
+            return accept_time;
+        }
+        line = bracket + 1;
+    }
+    return EPOCH_TIME_NONE;
+}
 
-        //this is going to blow apart the time_string so we need to copy it first
-        end_string = malloc(strlen(time_string)+1);
-        if(end_string == NULL)
+
+
+//******************************************************************************
+// Name:    _clock_seconds
+// Notes:   parses the search time with a padding.  For example if you enter
+//          "6" it will actualy treat it like 06:PAD:PAD.  The fields are
+//          split on the colons in place, empty ones are skipped the way
+//          strtok always did, so "::6" is still 6 o'clock.
+//
+//******************************************************************************
+static int _clock_seconds(const char *text, size_t length, int pad)
+{
+    int fields[3] = {0, pad, pad};
+    int field_count = 0;
+    size_t i = 0;
+
+    while(i < length && field_count < 3)
+    {
+        if(IS_COLON(text[i]))
         {
-            return 0;
+            i++;
+            continue;
         }
-        //duplicate the string before : changes to \0 everywhere.
+        fields[field_count] = 0;
+        while(i < length && IS_NUM(text[i]))
+        {
+            fields[field_count] = (fields[field_count] * 10) + (text[i] - '0');
+            i++;
+        }
+        field_count++;
+    }
+    return (fields[0] * 3600) + (fields[1] * 60) + fields[2];
+}
+
 
-        strcpy(end_string, time_string);
 
-        *start_time = parse_search_time(time_string, 0);
+//******************************************************************************
+// Name:    _log_day
+// Notes:   the day out of a stamp that matched the layout, so it's a blank
+//          or a digit and then a digit
+//
+//******************************************************************************
+static int _log_day(const char *line)
+{
+    return (IS_SPACE(line[4]) ? 0 : (line[4] - '0') * 10) + (line[5] - '0');
+}
+
 
-        *end_time = parse_search_time(end_string, 59);
 
+//******************************************************************************
+// Name:    _matches_layout
+// Notes:   the first length bytes of text against a layout, see
+//          SYSLOG_LAYOUT.  length can't be longer than the layout.
+//
+//******************************************************************************
+static int _matches_layout(const char *text, const char *layout, size_t length)
+{
+    size_t i;
 
-        //free up the mem we created
-        free(end_string);
+    //constantly try to fail the string.
+    for(i = 0; i < length; i++)
+    {
+        switch(layout[i])
+        {
+        case 'a':
+            if(!IS_CHAR(text[i]))
+            {
+                return 0;
+            }
+            break;
+        case '0':
+            if(!IS_NUM(text[i]))
+            {
+                return 0;
+            }
+            break;
+        case '_':
+            if(!IS_SPACE(text[i]) && !IS_NUM(text[i]))
+            {
+                return 0;
+            }
+            break;
+        default:
+            if(text[i] != layout[i])
+            {
+                return 0;
+            }
+            break;
+        }
     }
+
+    //WIN!
     return 1;
 }
 
 
 
 //******************************************************************************
-// Name:    parse_log_time
-// Notes:   Grab the time from the log entry.  This is offset by 24 hours if the
-//          day on the log entry doesn't match the first day on the log entry.
-//          Note, this falls apart the second the logs rotate with a frequency
-//          that causes more than one midnight crossing (for this example we
-//          were told to ignore that.
+// Name:    _split_search_string
+// Notes:   Picks a search string apart into its start and (if it's a range)
+//          its end.  The hyphen between them is the first one after the
+//          start's date, if it has one.  An end can only have a date if the
+//          start does.  Returns 0 if it isn't a search string at all.
 //
 //******************************************************************************
-int parse_log_time(char *time_string, int *log_time)
+static int _split_search_string(const char *text, size_t length, search_point *first, search_point *second, int *is_range)
 {
-    if(time_string == NULL)
+    const char *date_end;
+    const char *lower_end;
+    const char *hyphen;
+
+    if(length == 0 || length > SEARCH_STRING_MAX)
     {
         return 0;
     }
 
-    int log_day = parse_log_day(time_string);
-    if(log_day == -1)
+    date_end = memchr(text, 'T', length);
+    lower_end = memchr(text, 't', length);
+    if(date_end == NULL || (lower_end != NULL && lower_end < date_end))
     {
-        return 0;
+        date_end = lower_end;
     }
-
-    if(log_day != log_time_start_day)
+    if(date_end == NULL)
     {
-        *log_time = SECONDS_PER_DAY;
+        date_end = text;
     }
-    else
+    hyphen = memchr(date_end, '-', length - (size_t)(date_end - text));
+    if(hyphen == NULL)
     {
-        *log_time = 0;
+        *is_range = 0;
+        return _parse_search_point(text, length, first);
     }
 
-    //hackey, but I don't want to write a non-padding version of the parse
-    //time function, feels wasteful.
-    *log_time += parse_search_time(time_string + 7, 0);
-    return 1;
+    *is_range = 1;
+    if(!_parse_search_point(text, (size_t)(hyphen - text), first) ||
+       !_parse_search_point(hyphen + 1, length - (size_t)(hyphen + 1 - text), second))
+    {
+        return 0;
+    }
+    return !second->has_date || first->has_date;
 }
 
 
 
 //******************************************************************************
-// Name:    set_log_time_start_day
-// Notes:   sets up the log start day.  It parses the string itself to make it
-//          more straightforward to callers.
+// Name:    _parse_search_point
+// Notes:   [[YYYY-]MM-DD(T|t)]hh[:mm[:ss[.fff]]], the clock part is as
+//          forgiving as it always was about leading zeros and missing bits
+//          but it has to have a digit in it.  The fraction needs all three
+//          of the hh:mm:ss so 1.5 doesn't get mistaken for a time.
 //
 //******************************************************************************
-int set_log_time_start_day(char *time_string)
+static int _parse_search_point(const char *text, size_t length, search_point *point)
 {
-    if(time_string == NULL)
+    const char *end = text + length;
+    const char *date_end = memchr(text, 'T', length);
+    int fields[3];
+    int field_count = 0;
+    int digit_count = 0;
+    int colon_count = 0;
+    size_t i;
+
+    if(date_end == NULL)
     {
-        return 0;
+        date_end = memchr(text, 't', length);
+    }
+
+    point->has_date = 0;
+    point->year = -1;
+    point->fraction = 0;
+    point->fraction_digits = 0;
+    if(date_end != NULL)
+    {
+        for(;;)
+        {
+            if(field_count == 3 || !_parse_date_field(&text, date_end, &fields[field_count]))
+            {
+                return 0;
+            }
+            field_count++;
+            if(text == date_end)
+            {
+                break;
+            }
+            if(*text++ != '-')
+            {
+                return 0;
+            }
+        }
+        if(field_count < 2)
+        {
+            return 0;
+        }
+        if(field_count == 3)
+        {
+            point->year = fields[0];
+        }
+        point->month = fields[field_count - 2];
+        point->day = fields[field_count - 1];
+        if(point->month < 1 || point->month > 12 || point->day < 1 || point->day > 31 ||
+           (point->year != -1 && (point->year < 1970 || point->year > 9999)))
+        {
+            return 0;
+        }
+        point->has_date = 1;
+        text = date_end + 1;
     }
 
-    log_time_start_day = parse_log_day(time_string);
+    //the fraction comes off the end first, the rest is an ordinary clock
+    const char *dot = memchr(text, '.', (size_t)(end - text));
+    if(dot != NULL)
+    {
+        for(i = 1; dot + i < end; i++)
+        {
+            if(!IS_NUM(dot[i]) || i > 3)
+            {
+                return 0;
+            }
+            point->fraction = (point->fraction * 10) + (dot[i] - '0');
+        }
+        point->fraction_digits = (int)(i - 1);
+        if(point->fraction_digits == 0 || dot == text || !IS_NUM(dot[-1]))
+        {
+            return 0;
+        }
+        end = dot;
+    }
+
+    length = (size_t)(end - text);
+    if(length > SEARCH_CLOCK_MAX)
+    {
+        return 0;
+    }
+    for(i = 0; i < length; i++)
+    {
+        if(IS_NUM(text[i]))
+        {
+            digit_count++;
+        }
+        else if(IS_COLON(text[i]))
+        {
+            colon_count++;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    if(digit_count == 0 || colon_count > 2 || (dot != NULL && colon_count != 2))
+    {
+        return 0;
+    }
+    //it's only needed until the caller's done with text
+    point->clock = text;
+    point->clock_length = length;
     return 1;
 }
 
 
 
 //******************************************************************************
-// Name:    parse_search_time
-// Notes:   parses the search time with a padding.  For example if you enter
-//          the string "6" it will actualy treat it like 06:PAD:PAD
+// Name:    _parse_date_field
+// Notes:   One run of digits out of a date, moving text past it
 //
 //******************************************************************************
-static int parse_search_time(char *time_string, int pad)
+static int _parse_date_field(const char **text, const char *end, int *value)
 {
-    int h=0, m=pad, s=pad;
-    char *working;
-    char *offset;
-    if(time_string == NULL)
-    {
-        return 0;
-    }
-    working = malloc(strlen(time_string)+1);
-    strcpy(working,time_string);
-    offset = working;
+    const char *digits = *text;
 
-    offset = strtok(working, ":");
-    if(offset!=NULL)
+    *value = 0;
+    while(*text < end && IS_NUM(**text) && *text - digits < 4)
     {
-        h = atoi(offset);
+        *value = (*value * 10) + (**text - '0');
+        (*text)++;
     }
-    offset = strtok(NULL, ":");
-    if(offset!=NULL)
+    return *text > digits;
+}
+
+
+
+//******************************************************************************
+// Name:    _last_year_for
+// Notes:   The year that month (1-12) and day last came around, as of
+//          reference.  reference is broken down in local time because that's
+//          the clock the stamps were written by, the times made from them
+//          still take the stamps as UTC (see epoch_time).
+//
+//******************************************************************************
+static int _last_year_for(int month, int day, time_t reference)
+{
+    struct tm parts;
+
+    if(localtime_r(&reference, &parts) == NULL)
     {
-        m = atoi(offset);
+        return 1970;
     }
-    offset = strtok(NULL, ":");
-    if(offset!=NULL)
+    if(month - 1 > parts.tm_mon || (month - 1 == parts.tm_mon && day > parts.tm_mday))
     {
-        s = atoi(offset);
+        return parts.tm_year + 1900 - 1;
     }
-    return (h * 3600) + (m * 60) + s;
+    return parts.tm_year + 1900;
 }
 
 
 
 //******************************************************************************
-// Name:    parse_log_day
-// Notes:   returns a decimal representation of the log day
+// Name:    _date_parts
+// Notes:   The year, month (1-12) and day of an epoch time, 0 if it can't
+//          be had
 //
 //******************************************************************************
-static int parse_log_day(char *time_string)
+static int _date_parts(epoch_time time, int *year, int *month, int *day)
 {
-    int log_day = 0;
-    //i really don't want this to stuff \0s into the line we're dealing with
-    //so i'll just copy the digits.
-    if(time_string == NULL)
+    time_t seconds = (time_t)(time / EPOCH_TIME_PER_SECOND);
+    struct tm parts;
+
+    if(gmtime_r(&seconds, &parts) == NULL)
     {
-        //yuck
-        return -1;
+        return 0;
     }
+    *year = parts.tm_year + 1900;
+    *month = parts.tm_mon + 1;
+    *day = parts.tm_mday;
+    return 1;
+}
+
 
-    if(IS_NUM(time_string[4]))
+
+//******************************************************************************
+// Name:    _days_from_civil
+// Notes:   Days since 1970-01-01 for a year, month (1-12) and day.  It's
+//          just arithmetic, so a day past the end of the month carries on
+//          into the next one rather than going wrong.
+//
+//******************************************************************************
+static int64_t _days_from_civil(int year, int month, int day)
+{
+    int64_t era;
+    int year_of_era;
+    int day_of_year;
+    int day_of_era;
+
+    //count from march so the leap day is at the end of the year
+    year -= (month <= 2);
+    era = ((year >= 0) ? year : year - 399) / 400;
+    year_of_era = (int)(year - era * 400);
+    day_of_year = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+    day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+
+
+//******************************************************************************
+// Name:    _search_point_clock
+// Notes:   Milliseconds into the day for one end of a search.  Whatever
+//          wasn't given is padded, 0s for a start and the top of the range
+//          for an end (59s for the clock, 9s for the fraction).
+//
+//******************************************************************************
+static epoch_time _search_point_clock(const search_point *point, int pad)
+{
+    epoch_time clock = _clock_seconds(point->clock, point->clock_length, pad) * EPOCH_TIME_PER_SECOND;
+    int scale = 1;
+    int i;
+
+    for(i = point->fraction_digits; i < 3; i++)
     {
-        log_day = (time_string[4] - '0') * 10;
+        scale *= 10;
     }
-
-    if(IS_NUM(time_string[5]))
+    clock += point->fraction * scale;
+    if(pad != 0)
     {
-        log_day+=time_string[5] - '0';
-        return log_day;
+        clock += scale - 1;
     }
-    else
+    return clock;
+}
+
+
+
+//******************************************************************************
+// Name:    _parse_accept_date
+// Notes:   "dd/Mmm/yyyy:hh:mm:ss.mmm", fixed width, with its own year so it
+//          doesn't need the guessing the syslog stamp does.
+//
+//******************************************************************************
+static int _parse_accept_date(const char *text, epoch_time *accept_time)
+{
+    static const char layout[] = "00/aaa/0000:00:00:00.000";
+    int month;
+
+    if(!_matches_layout(text, layout, ACCEPT_DATE_LENGTH) || (month = parse_log_month(text + 3)) == -1)
     {
-        //yuck
-        return -1;
+        return 0;
     }
 
+    *accept_time = _days_from_civil(_fixed_number(text + 7, 4), month + 1, _fixed_number(text, 2)) * EPOCH_TIME_PER_DAY +
+                   (_fixed_number(text + 12, 2) * 3600 + _fixed_number(text + 15, 2) * 60 + _fixed_number(text + 18, 2)) * EPOCH_TIME_PER_SECOND +
+                   _fixed_number(text + 21, 3);
+    return 1;
 }
 
+
+
+//******************************************************************************
+// Name:    _fixed_number
+// Notes:   count digits that the caller already checked are there (a
+//          syslog stamp or the accept date)
+//
+//******************************************************************************
+static int _fixed_number(const char *digits, int count)
+{
+    int value = 0;
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        value = (value * 10) + (digits[i] - '0');
+    }
+    return value;
+}
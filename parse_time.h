@@ -29,37 +29,122 @@
 #ifndef __TGREP_PARSE_TIME_H__
 #define __TGREP_PARSE_TIME_H__
 
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+//times are milliseconds since the epoch, taking the log's wall clock stamps
+//as if they were UTC (they don't say what zone they're in).  that keeps
+//every day exactly EPOCH_TIME_PER_DAY long, so the clock time is just the
+//remainder.  syslog stamps only go to the second, the milliseconds come
+//from the haproxy accept date if it's asked for (see set_log_time_field).
+typedef int64_t epoch_time;
+
+#define EPOCH_TIME_PER_SECOND ((epoch_time)1000)
+#define EPOCH_TIME_PER_DAY (EPOCH_TIME_PER_SECOND * SECONDS_PER_DAY)
+
+//a search with no end
+#define EPOCH_TIME_MAX INT64_MAX
+
+//a line that doesn't have the time we're after
+#define EPOCH_TIME_NONE INT64_MIN
+
+//room for format_log_time's "YYYY-MM-DD hh:mm:ss.mmm"
+#define LOG_TIME_TEXT_SIZE (24)
+
+//which part of a line its time comes from.  the accept date is haproxy's
+//"[09/Feb/2011:06:52:00.123]", lines without one don't count as stamped.
+//the map's keys depend on it, so it's saved along with them.
+typedef enum
+{
+    LOG_TIME_FIELD_SYSLOG = 0,
+    LOG_TIME_FIELD_ACCEPT
+} log_time_field;
+
 //seconds per day is useful when we're adding the 1 day offsets
 //to our search times and whatnot.
 #define SECONDS_PER_DAY (24*60*60)
 
+//number of characters in the "Mmm dd hh:mm:ss" stamp at the start of every
+//log line.  anything shorter than this can't be a log line.
+#define LOG_TIME_LENGTH (15)
+
 //this is allowed to have dashes and is more forgiving
 //on the leading zeros, which will allow for things like
-//tgrep 4 to be interpreted as tgrep 04:00:00
-int is_valid_search_time(char *time_string);
+//tgrep 4 to be interpreted as tgrep 04:00:00.  either end can also have a
+//date in front, [YYYY-]MM-DDThh:mm:ss, e.g. 02-10T06:52-07:00, and a full
+//hh:mm:ss can have up to 3 digits of fraction, e.g. 06:52:00.5-06:52:00.7.
+//on a log whose stamps stop at the second that's the whole of 06:52:00.
+int is_valid_search_time(const char *text, size_t length);
 
 //this is a bit more strict, must be the start of the line,
 //thus it expects ccc_[d/_]d_dd:dd:dd.  This really only protects against
 //some screwed up log file and I may not use it since the 2 options are
 //(1)pass the bad value to the output and hope it gets picked off by a follow
-//up grep/cut/whatever or (2) fail and give NO results.
-int is_valid_log_time(char *time_string);
+//up grep/cut/whatever or (2) fail and give NO results.  length is how much
+//of the line there is, it doesn't have to be NUL terminated.
+int is_valid_log_time(const char *line, size_t length);
+
+//what parse_search_string says about the date.  a date with no year can't
+//be placed until there's a log to go by, so its times are in
+//SEARCH_YEAR_BASE (a leap year, so the 29th of February is there) until
+//resolve_search_year.
+#define SEARCH_UNDATED          (0)
+#define SEARCH_DATED            (1)
+#define SEARCH_DATED_NO_YEAR    (2)
+#define SEARCH_YEAR_BASE        (2000)
 
 //parse the search string into a start and end time.  the times are passed in
-//by reference so we can return times and a pass/fail
-int parse_search_string(char *time_string, int *start_time, int *end_time);
+//by reference so we can return times and a pass/fail.  an end takes in
+//everything its last digit covers (6:00:00.7 is up to .799).  without a
+//date they're just milliseconds into the day (dated is SEARCH_UNDATED) and
+//it's up to the caller which days they go on.  with one they're epoch times
+//(SEARCH_DATED), or SEARCH_DATED_NO_YEAR if there wasn't a year.
+int parse_search_string(const char *text, size_t length, epoch_time *start_time, epoch_time *end_time, int *dated);
 
-//this will return the time that a log file line refers to.
-int parse_log_time(char *time_string, int *log_time);
+//puts a SEARCH_DATED_NO_YEAR search in a real year, the one that puts it
+//over the log running from first_time to last_time.  an end of
+//EPOCH_TIME_MAX is left alone.
+void resolve_search_year(epoch_time *start_time, epoch_time *end_time, epoch_time first_time, epoch_time last_time);
 
-//this is goofy, but I want log times to be naturally returned with the correct
-//offset rather than doing it in application for abstraction reasons.  no 
-//less-than-48-hour period has 2 of the same DAY so we'll keep that around and
-//use it to offset results to parse_log_time
+//this will return the time that a log file line refers to, or 0 if the
+//line doesn't start with a stamp.
+int parse_log_time(const char *line, size_t length, epoch_time *log_time);
+
+//same result as parse_log_time, for stamps that have already been picked
+//apart (see line_scan): the month (0-11), the day of the month and the
+//hh:mm:ss in seconds.
+epoch_time combine_log_time(int log_month, int log_day, int clock_seconds);
+
+//the same for stamps that come with their own year (see log_format)
+epoch_time combine_dated_log_time(int year, int log_month, int log_day, int clock_seconds);
+
+//the month of a "Mmm dd hh:mm:ss" stamp, 0-11 or -1 if it isn't one
+int parse_log_month(const char *time_string);
+
+//where line times come from, LOG_TIME_FIELD_SYSLOG unless set
+void set_log_time_field(log_time_field field);
+log_time_field get_log_time_field(void);
+
+//the time for a whole line of length bytes whose syslog stamp gave
+//stamp_time: that, or the accept date when it's the field in use.
+//EPOCH_TIME_NONE if it is and the line hasn't got one (or got cut off).
+epoch_time refine_log_time(epoch_time stamp_time, const char *line, size_t length);
+
+//syslog stamps don't have a year, so it gets worked out from the log's
+//first line and reference (the log's mtime): the first line is the last
+//time that date came around before reference, and any later line with an
+//earlier date has gone into the next year.  good for logs up to a year.
 
 //I chose doing it from the string so that no one else would have to do any
 //string parsing.
-int set_log_time_start_day(char *time_string);
+int set_log_time_start(const char *line, size_t length, time_t reference);
+
+//midnight of the log's first day, what the old maps counted from
+epoch_time get_log_start_day_time(void);
+
+//"YYYY-MM-DD hh:mm:ss" for messages, text needs LOG_TIME_TEXT_SIZE bytes
+char *format_log_time(epoch_time time, char *text);
 
 
 #endif
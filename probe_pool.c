@@ -0,0 +1,219 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    probe_pool.c
+// Notes:   A handful of threads that do nothing but pread() probe windows.
+//          On cold storage a search is one dependent read after another, so
+//          each round of the search hands over several windows at once and
+//          pays for one seek instead of several.  The threads only ever read,
+//          all the parsing (and the map, which isn't thread safe) stays on
+//          the searching thread.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <errno.h>
+#include <pthread.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "file_scan.h"
+#include "probe_pool.h"
+#include "console_output.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//nobody needs more than this many reads in flight for a search
+#define PROBE_POOL_MAX_THREADS  (64)
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+static int pool_started = 0;
+
+//the batch being worked on.  next_read is the next one nobody has picked up,
+//outstanding counts the ones that haven't finished yet.
+static probe_read *batch = NULL;
+static int batch_count = 0;
+static int next_read = 0;
+static int outstanding = 0;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void *_probe_thread(void *argument);
+static void _do_read(probe_read *read);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    probe_pool_start
+// Notes:   The threads are detached, they just sleep on the condition until
+//          the process goes away.
+//
+//******************************************************************************
+void probe_pool_start(int thread_count)
+{
+    pthread_attr_t attributes;
+    pthread_t thread;
+    int started = 0;
+    int i;
+
+    if(pool_started)
+    {
+        return;
+    }
+    pool_started = 1;
+
+    if(thread_count > PROBE_POOL_MAX_THREADS)
+    {
+        thread_count = PROBE_POOL_MAX_THREADS;
+    }
+
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    for(i = 1; i < thread_count; i++)
+    {
+        if(pthread_create(&thread, &attributes, _probe_thread, NULL) != 0)
+        {
+            break;
+        }
+        started++;
+    }
+    pthread_attr_destroy(&attributes);
+
+    console_print_debug("Probe pool running %d helper threads.\n",started);
+}
+
+
+
+//******************************************************************************
+// Name:    probe_pool_read
+// Notes:   The caller pitches in too, so with no helpers this is just a loop
+//          of reads.
+//
+//******************************************************************************
+void probe_pool_read(probe_read *reads, int count)
+{
+    int i;
+
+    if(count <= 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    batch = reads;
+    batch_count = count;
+    next_read = 0;
+    outstanding = count;
+    pthread_cond_broadcast(&work_ready);
+
+    while(next_read < batch_count)
+    {
+        i = next_read++;
+        pthread_mutex_unlock(&pool_lock);
+        _do_read(&reads[i]);
+        pthread_mutex_lock(&pool_lock);
+        outstanding--;
+    }
+
+    while(outstanding > 0)
+    {
+        pthread_cond_wait(&work_done, &pool_lock);
+    }
+    batch = NULL;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+
+//******************************************************************************
+// Name:    _probe_thread
+// Notes:   Grab a read, do it, repeat.  Whoever finishes the last one of a
+//          batch wakes the caller.
+//
+//******************************************************************************
+static void *_probe_thread(void *argument)
+{
+    probe_read *read;
+
+    (void)argument;
+
+    pthread_mutex_lock(&pool_lock);
+    for(;;)
+    {
+        while(batch == NULL || next_read >= batch_count)
+        {
+            pthread_cond_wait(&work_ready, &pool_lock);
+        }
+        read = &batch[next_read++];
+        pthread_mutex_unlock(&pool_lock);
+
+        _do_read(read);
+
+        pthread_mutex_lock(&pool_lock);
+        if(--outstanding == 0)
+        {
+            pthread_cond_signal(&work_done);
+        }
+    }
+    return NULL;
+}
+
+
+
+//******************************************************************************
+// Name:    _do_read
+// Notes:   read_log_file is a pread (or the compressed equivalent), so there's
+//          no shared file position to fight over
+//
+//******************************************************************************
+static void _do_read(probe_read *read)
+{
+    do
+    {
+        read->result = read_log_file(read->buffer, read->size, read->offset);
+    } while(read->result < 0 && errno == EINTR);
+}
@@ -0,0 +1,51 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    probe_pool.h
+// Notes:   header for the probe_pool module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_PROBE_POOL_H__
+#define __TGREP_PROBE_POOL_H__
+
+#include <sys/types.h>
+
+//one window of the log to pull in.  result is what read_log_file gave back
+struct _probe_read {
+    off_t offset;
+    size_t size;
+    char *buffer;
+    ssize_t result;
+};
+
+typedef struct _probe_read probe_read;
+
+//starts the helper threads.  thread_count includes the calling thread, so 1
+//(or a failed start) just means every read happens on the caller.  only the
+//first call does anything, the threads stick around for the rest of the run.
+void probe_pool_start(int thread_count);
+
+//reads every request at once and returns when they've all finished
+void probe_pool_read(probe_read *reads, int count);
+
+#endif
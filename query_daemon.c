@@ -0,0 +1,852 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    query_daemon.c
+// Notes:   A long running tgrep that listens on a UNIX socket, plus the thin
+//          client that talks to it.  Every plain run opens the log, hashes
+//          it and loads its map before doing any searching, which is most of
+//          the work for the small queries dashboards fire all day.  The
+//          daemon keeps the logs it has searched open, mapped and with their
+//          maps in memory, so the next query on the same log goes straight
+//          to the search.
+//
+//          The client sends its stdout and stderr along with the query
+//          (SCM_RIGHTS), and the daemon puts them on its own 1 and 2 while
+//          it runs the query.  So the range goes from the log straight to
+//          wherever the client's output goes (sendfile/splice and all), none
+//          of it passes through the socket.  Queries are answered one at a
+//          time, all the modules underneath are single-log.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "query_daemon.h"
+#include "file_scan.h"
+#include "map_file.h"
+#include "parse_time.h"
+#include "console_output.h"
+#include "stats.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+#define DEFAULT_SOCKET_NAME     "tgrep.sock"
+
+//"TGRQ", and a version so an old client gets turned away instead of
+//misunderstood
+#define QUERY_MAGIC             (0x51524754)
+#define QUERY_VERSION           (1)
+
+//a query is a handful of paths, anything this big is garbage
+#define QUERY_MAX_LENGTH        (1024*1024)
+#define QUERY_MAX_ARGS          (4096)
+
+//how long a client gets to finish sending its query
+#define QUERY_RECEIVE_TIMEOUT   (5)
+
+//logs kept open between queries, the least recently used one goes when
+//another needs the room
+#define DAEMON_MAX_RESIDENT     (32)
+
+//the client's stdout and stderr
+#define QUERY_FD_COUNT          (2)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//what goes ahead of the arguments, which follow as NUL terminated strings
+struct _query_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t arg_count;
+    uint32_t length;
+};
+
+typedef struct _query_header query_header;
+
+//one log parked between queries.  the key is the open file, not the name,
+//so a rotated log is still found under its new name.
+struct _resident_log {
+    dev_t device;
+    ino_t inode;
+    int fd;
+    uint64_t fingerprint;
+    log_context *log;
+    map_context *map;
+    unsigned long last_used;
+};
+
+typedef struct _resident_log resident_log;
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static volatile sig_atomic_t daemon_stopping = 0;
+static int daemon_running = 0;
+
+static resident_log resident_logs[DAEMON_MAX_RESIDENT];
+static int resident_count = 0;
+static unsigned long use_clock = 0;
+
+//where our own stdout and stderr went while a client's are borrowed
+static int saved_stdout = -1;
+static int saved_stderr = -1;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static int _listen_socket(const char *socket_path);
+static int _fill_socket_address(const char *socket_path, struct sockaddr_un *address);
+static void _stop_daemon(int signal_number);
+static void _serve_client(int client, query_handler handler);
+static int _receive_query(int client, int *fds, char ***args);
+static int _recv_all(int fd, char *buffer, size_t size);
+static char *_absolute_arg(const char *arg);
+static void _evict_resident_log(int index, int save);
+static void _drop_unlinked_logs(void);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    get_default_socket_path
+// Notes:   The map file directory is already ours and already exists.
+//
+//******************************************************************************
+char *get_default_socket_path(void)
+{
+    return get_map_file_path(DEFAULT_SOCKET_NAME);
+}
+
+
+
+//******************************************************************************
+// Name:    run_query_daemon
+// Notes:   Accept, answer, repeat.  The signal handlers go in without
+//          SA_RESTART so a SIGTERM knocks accept() out and we can save the
+//          maps of everything still resident on the way out.
+//
+//******************************************************************************
+int run_query_daemon(const char *socket_path, query_handler handler)
+{
+    struct sigaction action;
+    int listener;
+    int client;
+    int i;
+
+    listener = _listen_socket(socket_path);
+    if(listener < 0)
+    {
+        return 0;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _stop_daemon;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    //a client going away mid range is its problem, not ours
+    signal(SIGPIPE, SIG_IGN);
+
+    saved_stdout = dup(STDOUT_FILENO);
+    saved_stderr = dup(STDERR_FILENO);
+    daemon_running = 1;
+    console_print_info("Answering queries on %s\n",socket_path);
+
+    while(!daemon_stopping)
+    {
+        client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if(client < 0)
+        {
+            if(errno != EINTR && errno != ECONNABORTED)
+            {
+                console_print_error("accept() failed on %s: %s\n",socket_path,strerror(errno));
+                break;
+            }
+            continue;
+        }
+        _serve_client(client, handler);
+        close(client);
+        _drop_unlinked_logs();
+    }
+
+    console_print_info("Shutting down, saving %d resident map(s).\n",resident_count);
+    for(i = resident_count - 1; i >= 0; i--)
+    {
+        _evict_resident_log(i, 1);
+    }
+    daemon_running = 0;
+    close(listener);
+    unlink(socket_path);
+    close(saved_stdout);
+    close(saved_stderr);
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    run_query_client
+// Notes:   Relative paths mean nothing to the daemon (it's sitting in some
+//          other directory), so they get our cwd stuck on the front.  The
+//          search time goes as is.
+//
+//******************************************************************************
+int run_query_client(const char *socket_path, char **args, int arg_count)
+{
+    struct sockaddr_un address;
+    query_header header;
+    struct msghdr message;
+    struct iovec iov[2];
+    struct cmsghdr *control;
+    char control_buffer[CMSG_SPACE(QUERY_FD_COUNT * sizeof(int))];
+    int fds[QUERY_FD_COUNT] = {STDOUT_FILENO, STDERR_FILENO};
+    char *payload = NULL;
+    size_t payload_length = 0;
+    char *arg;
+    size_t arg_length;
+    int32_t status = 0;
+    ssize_t sent;
+    int sock;
+    int i;
+
+    if(_fill_socket_address(socket_path, &address) < 0)
+    {
+        return -1;
+    }
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0)
+    {
+        return -1;
+    }
+    if(connect(sock, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        console_print_info("No tgrep daemon on %s (%s).\n",socket_path,strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    for(i = 0; i < arg_count; i++)
+    {
+        arg = _absolute_arg(args[i]);
+        if(arg == NULL)
+        {
+            free(payload);
+            close(sock);
+            return 0;
+        }
+        arg_length = strlen(arg) + 1;
+        char *grown = realloc(payload, payload_length + arg_length);
+        if(grown == NULL)
+        {
+            free(arg);
+            free(payload);
+            close(sock);
+            return 0;
+        }
+        payload = grown;
+        memcpy(payload + payload_length, arg, arg_length);
+        payload_length += arg_length;
+        free(arg);
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = QUERY_MAGIC;
+    header.version = QUERY_VERSION;
+    header.arg_count = (uint32_t)arg_count;
+    header.length = (uint32_t)payload_length;
+
+    //the descriptors ride along with the header, the rest of the query
+    //follows as plain data
+    memset(&message, 0, sizeof(message));
+    memset(control_buffer, 0, sizeof(control_buffer));
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    message.msg_iov = iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control_buffer;
+    message.msg_controllen = sizeof(control_buffer);
+    control = CMSG_FIRSTHDR(&message);
+    control->cmsg_level = SOL_SOCKET;
+    control->cmsg_type = SCM_RIGHTS;
+    control->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(control), fds, sizeof(fds));
+
+    fflush(stdout);
+    sent = sendmsg(sock, &message, MSG_NOSIGNAL);
+    if(sent == (ssize_t)sizeof(header) && payload_length > 0)
+    {
+        size_t done = 0;
+        while(done < payload_length)
+        {
+            sent = send(sock, payload + done, payload_length - done, MSG_NOSIGNAL);
+            if(sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(sent <= 0)
+            {
+                break;
+            }
+            done += (size_t)sent;
+        }
+    }
+    free(payload);
+    if(sent <= 0)
+    {
+        console_print_error("Could not send the query to %s: %s\n",socket_path,strerror(errno));
+        close(sock);
+        return 0;
+    }
+    shutdown(sock, SHUT_WR);
+
+    //the daemon only answers once the whole range has gone out
+    if(_recv_all(sock, (char *)&status, sizeof(status)) < 0)
+    {
+        console_print_error("The tgrep daemon hung up before answering.\n");
+        status = 0;
+    }
+    close(sock);
+    return (int)status;
+}
+
+
+
+//******************************************************************************
+// Name:    attach_resident_log
+// Notes:   Takes the log out of the table while it's in use, keep puts it
+//          back.  Anything appended since last time gets picked up, and if
+//          the file was truncated or rewritten underneath us the resident
+//          copy is thrown away (its saved map would be wrong anyway).
+//
+//******************************************************************************
+int attach_resident_log(const struct stat *file_stat)
+{
+    resident_log entry;
+    int i;
+
+    if(!daemon_running)
+    {
+        return 0;
+    }
+    for(i = 0; i < resident_count; i++)
+    {
+        if(resident_logs[i].device == file_stat->st_dev && resident_logs[i].inode == file_stat->st_ino)
+        {
+            break;
+        }
+    }
+    if(i == resident_count)
+    {
+        return 0;
+    }
+
+    entry = resident_logs[i];
+    resident_logs[i] = resident_logs[--resident_count];
+
+    attach_map(entry.map);
+    if(attach_log_file(entry.log) < 0)
+    {
+        clear_map();
+        return 0;
+    }
+    if(refresh_log_file() < 0 || get_file_fingerprint() != entry.fingerprint)
+    {
+        console_print_info("Resident log changed underneath us, opening it again.\n");
+        close_log_file();
+        clear_map();
+        return 0;
+    }
+    console_print_debug("Using resident log %lld.\n",(long long int)entry.inode);
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    keep_resident_log
+// Notes:   The first time a log gets kept its map has already been saved by
+//          the caller, after that maps only get saved when they're evicted
+//          or the daemon shuts down.
+//
+//******************************************************************************
+int keep_resident_log(void)
+{
+    resident_log entry;
+    struct stat file_stat;
+    int oldest;
+    int i;
+
+    if(!daemon_running)
+    {
+        return 0;
+    }
+
+    entry.fd = get_log_file_descriptor();
+    if(entry.fd < 0 || fstat(entry.fd, &file_stat) != 0)
+    {
+        return 0;
+    }
+    entry.device = file_stat.st_dev;
+    entry.inode = file_stat.st_ino;
+    entry.fingerprint = get_file_fingerprint();
+    entry.last_used = ++use_clock;
+
+    entry.log = detach_log_file();
+    if(entry.log == NULL)
+    {
+        return 0;
+    }
+    entry.map = detach_map();
+    if(entry.map == NULL)
+    {
+        attach_log_file(entry.log);
+        return 0;
+    }
+
+    if(resident_count == DAEMON_MAX_RESIDENT)
+    {
+        oldest = 0;
+        for(i = 1; i < resident_count; i++)
+        {
+            if(resident_logs[i].last_used < resident_logs[oldest].last_used)
+            {
+                oldest = i;
+            }
+        }
+        _evict_resident_log(oldest, 1);
+    }
+    resident_logs[resident_count++] = entry;
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _listen_socket
+// Notes:   If something answers on the path already there's a daemon running
+//          and we leave it alone, otherwise whatever's there is a leftover
+//          from one that died.  The socket is ours only, whoever connects
+//          gets to read anything we can.
+//
+//******************************************************************************
+static int _listen_socket(const char *socket_path)
+{
+    struct sockaddr_un address;
+    mode_t old_mask;
+    int sock;
+
+    if(_fill_socket_address(socket_path, &address) < 0)
+    {
+        return -1;
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0)
+    {
+        console_print_error("Could not create a socket: %s\n",strerror(errno));
+        return -1;
+    }
+    if(connect(sock, (struct sockaddr *)&address, sizeof(address)) == 0)
+    {
+        console_print_error("A tgrep daemon is already running on %s\n",socket_path);
+        close(sock);
+        return -1;
+    }
+    close(sock);
+    unlink(socket_path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0)
+    {
+        console_print_error("Could not create a socket: %s\n",strerror(errno));
+        return -1;
+    }
+    old_mask = umask(0077);
+    if(bind(sock, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(sock, SOMAXCONN) != 0)
+    {
+        umask(old_mask);
+        console_print_error("Could not listen on %s: %s\n",socket_path,strerror(errno));
+        close(sock);
+        return -1;
+    }
+    umask(old_mask);
+    return sock;
+}
+
+
+
+//******************************************************************************
+// Name:    _fill_socket_address
+// Notes:   sun_path is short, complain rather than truncate
+//
+//******************************************************************************
+static int _fill_socket_address(const char *socket_path, struct sockaddr_un *address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if(socket_path == NULL || strlen(socket_path) >= sizeof(address->sun_path))
+    {
+        console_print_error("Socket path is too long: %s\n",socket_path ? socket_path : "(none)");
+        return -1;
+    }
+    strcpy(address->sun_path, socket_path);
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _stop_daemon
+// Notes:   SIGINT/SIGTERM, the accept loop notices on its way round
+//
+//******************************************************************************
+static void _stop_daemon(int signal_number)
+{
+    (void)signal_number;
+    daemon_stopping = 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _serve_client
+// Notes:   Only our own user (or root) gets answers.  The client's stdout and
+//          stderr stand in for ours while its query runs, so the range, the
+//          errors and the --stats report all end up where the client would
+//          have put them.
+//
+//******************************************************************************
+static void _serve_client(int client, query_handler handler)
+{
+    struct ucred credentials;
+    socklen_t credentials_length = sizeof(credentials);
+    struct timeval timeout;
+    int fds[QUERY_FD_COUNT];
+    char **args = NULL;
+    int arg_count;
+    int32_t status;
+
+    if(getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) != 0 ||
+       (credentials.uid != geteuid() && credentials.uid != 0))
+    {
+        console_print_debug("Turning away a client that isn't us.\n");
+        return;
+    }
+
+    timeout.tv_sec = QUERY_RECEIVE_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    arg_count = _receive_query(client, fds, &args);
+    if(arg_count < 0)
+    {
+        return;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(fds[0], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+
+    stats_reset();
+    status = (int32_t)handler(args, arg_count);
+    stats_print();
+
+    fflush(stdout);
+    fflush(stderr);
+    clearerr(stdout);
+    clearerr(stderr);
+    dup2(saved_stdout, STDOUT_FILENO);
+    dup2(saved_stderr, STDERR_FILENO);
+    free(args);
+
+    send(client, &status, sizeof(status), MSG_NOSIGNAL);
+}
+
+
+
+//******************************************************************************
+// Name:    _receive_query
+// Notes:   Fills in the client's descriptors and an argument array pointing
+//          into one allocation (free the array, that's it).  Returns the
+//          argument count, or -1 with nothing left open if the query is no
+//          good.
+//
+//******************************************************************************
+static int _receive_query(int client, int *fds, char ***args)
+{
+    query_header header;
+    struct msghdr message;
+    struct iovec iov;
+    struct cmsghdr *control;
+    char control_buffer[CMSG_SPACE(QUERY_FD_COUNT * sizeof(int))];
+    int received_fds[QUERY_FD_COUNT];
+    int fd_count = 0;
+    int extra_fds = 0;
+    int count;
+    int fd;
+    int j;
+    char **list = NULL;
+    char *payload;
+    char *working;
+    ssize_t received;
+    uint32_t i;
+
+    memset(&message, 0, sizeof(message));
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control_buffer;
+    message.msg_controllen = sizeof(control_buffer);
+
+    do
+    {
+        received = recvmsg(client, &message, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    } while(received < 0 && errno == EINTR);
+
+    //whatever we were sent is open in this process now, so every descriptor
+    //in every SCM_RIGHTS message is either kept or closed here
+    for(control = CMSG_FIRSTHDR(&message); control != NULL; control = CMSG_NXTHDR(&message, control))
+    {
+        if(control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_RIGHTS)
+        {
+            count = (int)((control->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            for(j = 0; j < count; j++)
+            {
+                memcpy(&fd, CMSG_DATA(control) + j * sizeof(int), sizeof(int));
+                if(fd_count < QUERY_FD_COUNT)
+                {
+                    received_fds[fd_count++] = fd;
+                }
+                else
+                {
+                    close(fd);
+                    extra_fds = 1;
+                }
+            }
+        }
+    }
+
+    if(received != (ssize_t)sizeof(header) || fd_count != QUERY_FD_COUNT || extra_fds ||
+       (message.msg_flags & MSG_CTRUNC) || header.magic != QUERY_MAGIC ||
+       header.version != QUERY_VERSION || header.length > QUERY_MAX_LENGTH ||
+       header.arg_count > QUERY_MAX_ARGS)
+    {
+        console_print_debug("Dropping a malformed query.\n");
+        goto bad_query;
+    }
+
+    //the strings go right after the pointers, one free does it all
+    list = malloc((header.arg_count + 1) * sizeof(char *) + header.length + 1);
+    if(list == NULL)
+    {
+        goto bad_query;
+    }
+    payload = (char *)(list + header.arg_count + 1);
+    if(header.length > 0 && _recv_all(client, payload, header.length) < 0)
+    {
+        console_print_debug("Query was cut short.\n");
+        goto bad_query;
+    }
+    payload[header.length] = '\0';
+
+    working = payload;
+    for(i = 0; i < header.arg_count; i++)
+    {
+        if(working >= payload + header.length)
+        {
+            console_print_debug("Query is missing arguments.\n");
+            goto bad_query;
+        }
+        list[i] = working;
+        working += strlen(working) + 1;
+    }
+    list[header.arg_count] = NULL;
+
+    fds[0] = received_fds[0];
+    fds[1] = received_fds[1];
+    *args = list;
+    return (int)header.arg_count;
+
+bad_query:
+    free(list);
+    for(i = 0; i < (uint32_t)fd_count; i++)
+    {
+        close(received_fds[i]);
+    }
+    return -1;
+}
+
+
+
+//******************************************************************************
+// Name:    _recv_all
+// Notes:   recv() until size bytes show up, -1 on EOF, error or timeout
+//
+//******************************************************************************
+static int _recv_all(int fd, char *buffer, size_t size)
+{
+    ssize_t received;
+    size_t done = 0;
+
+    while(done < size)
+    {
+        received = recv(fd, buffer + done, size - done, 0);
+        if(received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(received <= 0)
+        {
+            return -1;
+        }
+        done += (size_t)received;
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _absolute_arg
+// Notes:   Search times and absolute paths pass straight through, anything
+//          else is relative to our cwd.  Caller frees.
+//
+//******************************************************************************
+static char *_absolute_arg(const char *arg)
+{
+    char cwd[PATH_MAX];
+    char *absolute;
+
+    if(arg[0] == '/' || is_valid_search_time(arg, strlen(arg)))
+    {
+        return strdup(arg);
+    }
+    if(getcwd(cwd, sizeof(cwd)) == NULL)
+    {
+        console_print_error("Could not work out the current directory.\n");
+        return NULL;
+    }
+    absolute = malloc(strlen(cwd) + strlen(arg) + 2);
+    if(absolute != NULL)
+    {
+        sprintf(absolute, "%s/%s", cwd, arg);
+    }
+    return absolute;
+}
+
+
+
+//******************************************************************************
+// Name:    _evict_resident_log
+// Notes:   Puts the log back in the modules just long enough to save its map
+//          (unless it's not worth saving) and close it.
+//
+//******************************************************************************
+static void _evict_resident_log(int index, int save)
+{
+    resident_log entry = resident_logs[index];
+    char *file_hash;
+
+    resident_logs[index] = resident_logs[--resident_count];
+
+    attach_map(entry.map);
+    if(attach_log_file(entry.log) < 0)
+    {
+        clear_map();
+        return;
+    }
+    if(save)
+    {
+        file_hash = get_file_hash();
+        if(file_hash != NULL)
+        {
+            save_map_file(file_hash, entry.fingerprint, get_log_file_size());
+            free(file_hash);
+        }
+    }
+    close_log_file();
+    clear_map();
+}
+
+
+
+//******************************************************************************
+// Name:    _drop_unlinked_logs
+// Notes:   A rotated log that's since been deleted would otherwise hang on
+//          to its disk space until it got pushed out of the table.
+//
+//******************************************************************************
+static void _drop_unlinked_logs(void)
+{
+    struct stat file_stat;
+    int i;
+
+    for(i = resident_count - 1; i >= 0; i--)
+    {
+        if(fstat(resident_logs[i].fd, &file_stat) == 0 && file_stat.st_nlink == 0)
+        {
+            console_print_debug("Resident log %lld was deleted, letting it go.\n",(long long int)resident_logs[i].inode);
+            _evict_resident_log(i, 0);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    query_daemon.h
+// Notes:   header for the query_daemon module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_QUERY_DAEMON_H__
+#define __TGREP_QUERY_DAEMON_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+//runs one query.  args are what would follow the options on the command
+//line (the search time and the files), and it returns what tgrep would exit
+//with.
+typedef int (*query_handler)(char **args, int arg_count);
+
+//where the daemon listens unless told otherwise, next to the map files.
+//caller frees.
+char *get_default_socket_path(void);
+
+//--daemon: answers queries on socket_path until SIGINT/SIGTERM.  returns 0
+//if it couldn't get the socket going.
+int run_query_daemon(const char *socket_path, query_handler handler);
+
+//--client: hands the query (and our stdout and stderr) to the daemon and
+//waits for it to finish.  returns the daemon's answer, or -1 if there's no
+//daemon to talk to and the caller should just search itself.
+int run_query_client(const char *socket_path, char **args, int arg_count);
+
+//logs the daemon keeps open between queries.  attach makes the resident
+//copy of this file the open log (and its map the map), returning 1, or 0 if
+//there isn't one and the log has to be opened as usual.  keep takes the
+//open log and map off the modules' hands instead of them being closed,
+//returning 0 if it can't (not a daemon, a compressed log...).
+int attach_resident_log(const struct stat *file_stat);
+int keep_resident_log(void);
+
+#endif
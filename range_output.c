@@ -0,0 +1,501 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    range_output.c
+// Notes:   This module moves a byte range of the log file to an output
+//          descriptor.  It looks at what the output actually is and lets the
+//          kernel do the copy when it can: splice() into pipes, sendfile()
+//          into sockets and copy_file_range() into regular files (which gets
+//          us reflinks on filesystems that support them).  Anything else, or
+//          any kernel that says no, gets a big-buffer pread/write loop.
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "range_output.h"
+#include "console_output.h"
+#include "uring_io.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//the fallback path is only used when the kernel won't do the work for us, so
+//make each trip through user space count.
+#define COPY_BUFFER_SIZE        (1024*1024)
+
+//the kernel paths are capped per call anyway, this just keeps a single call
+//from hogging the output for too long on huge ranges.
+#define KERNEL_CHUNK_SIZE       (16*1024*1024)
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static output_method last_output_method = OUTPUT_METHOD_NONE;
+
+static int use_io_uring = 0;
+
+//allocated the first time we need to fall back
+static char *copy_buffer = NULL;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static output_method _pick_output_method(int out_fd);
+static ssize_t _kernel_copy(output_method method, int in_fd, off_t *offset, size_t size, int out_fd);
+static int _kernel_method_unsupported(int error);
+static int _wait_for_output(int out_fd);
+static off_t _read_write_copy(int in_fd, range_reader reader, off_t start_offset, off_t end_offset, int out_fd);
+static off_t _mapped_write_copy(const char *in_map, off_t start_offset, off_t end_offset, int out_fd);
+static int _write_all(int out_fd, const char *working, size_t size, off_t *written_total);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    output_file_range
+// Notes:   Tries the kernel path that fits out_fd first.  If that path fails
+//          because it isn't supported for this pair of descriptors we pick up
+//          where it left off with the copy loop, so a partial kernel copy
+//          never duplicates or drops bytes.
+//
+//******************************************************************************
+off_t output_file_range(int in_fd, const char *in_map, off_t start_offset, off_t end_offset, int out_fd)
+{
+    off_t offset = start_offset;
+    output_method method = _pick_output_method(out_fd);
+    ssize_t copied;
+    off_t fallback;
+
+    if(in_fd < 0 || out_fd < 0 || end_offset < start_offset)
+    {
+        return -1;
+    }
+
+    //the io_uring pipeline either does the lot (or as much as the file or
+    //the output allow) or nothing at all
+    if(use_io_uring && uring_io_ready())
+    {
+        fallback = uring_io_copy_range(in_fd, start_offset, end_offset, out_fd);
+        if(fallback >= 0)
+        {
+            last_output_method = OUTPUT_METHOD_IO_URING;
+            console_print_info("Output path: %s.\n",get_output_method_name(last_output_method));
+            return fallback;
+        }
+        console_print_debug("io_uring refused the copy, falling back.\n");
+    }
+
+    while(method != OUTPUT_METHOD_READ_WRITE && offset < end_offset)
+    {
+        size_t size = (size_t)(end_offset - offset);
+        if(size > KERNEL_CHUNK_SIZE)
+        {
+            size = KERNEL_CHUNK_SIZE;
+        }
+
+        copied = _kernel_copy(method, in_fd, &offset, size, out_fd);
+        if(copied > 0)
+        {
+            continue;
+        }
+
+        if(copied == 0)
+        {
+            //the file got shorter underneath us, nothing more to give
+            break;
+        }
+
+        if(errno == EINTR)
+        {
+            continue;
+        }
+
+        if(errno == EAGAIN && _wait_for_output(out_fd))
+        {
+            continue;
+        }
+
+        if(_kernel_method_unsupported(errno))
+        {
+            console_print_debug("%s refused the copy, falling back.\n",get_output_method_name(method));
+            method = OUTPUT_METHOD_READ_WRITE;
+            break;
+        }
+
+        console_print_error("Output failed after %lld bytes.\n",(long long int)(offset - start_offset));
+        last_output_method = method;
+        return (offset == start_offset) ? -1 : offset - start_offset;
+    }
+
+    last_output_method = method;
+
+    if(method == OUTPUT_METHOD_READ_WRITE && offset < end_offset)
+    {
+        if(in_map != NULL)
+        {
+            fallback = _mapped_write_copy(in_map, offset, end_offset, out_fd);
+        }
+        else
+        {
+            fallback = _read_write_copy(in_fd, NULL, offset, end_offset, out_fd);
+        }
+        if(fallback > 0)
+        {
+            offset += fallback;
+        }
+    }
+
+    console_print_info("Output path: %s.\n",get_output_method_name(last_output_method));
+    return offset - start_offset;
+}
+
+
+
+//******************************************************************************
+// Name:    output_reader_range
+// Notes:   Nothing for the kernel to do here, it's the copy loop every time.
+//
+//******************************************************************************
+off_t output_reader_range(range_reader reader, off_t start_offset, off_t end_offset, int out_fd)
+{
+    off_t copied;
+
+    if(reader == NULL || out_fd < 0 || end_offset < start_offset)
+    {
+        return -1;
+    }
+    last_output_method = OUTPUT_METHOD_READ_WRITE;
+    copied = _read_write_copy(-1, reader, start_offset, end_offset, out_fd);
+    console_print_info("Output path: %s.\n",get_output_method_name(last_output_method));
+    return copied;
+}
+
+
+
+//******************************************************************************
+// Name:    set_output_io_uring
+// Notes:   --io=uring
+//
+//******************************************************************************
+void set_output_io_uring(int enabled)
+{
+    use_io_uring = enabled;
+}
+
+
+
+//******************************************************************************
+// Name:    output_buffer
+// Notes:   For output that's been put together in memory (the -e filter)
+//
+//******************************************************************************
+off_t output_buffer(const char *data, size_t size, int out_fd)
+{
+    off_t written = 0;
+
+    _write_all(out_fd, data, size, &written);
+    return written;
+}
+
+
+
+//******************************************************************************
+// Name:    get_output_method
+// Notes:   The method the last range actually ended up going through.
+//
+//******************************************************************************
+output_method get_output_method(void)
+{
+    return last_output_method;
+}
+
+
+
+//******************************************************************************
+// Name:    get_output_method_name
+// Notes:   Printable names for the output paths.
+//
+//******************************************************************************
+const char *get_output_method_name(output_method method)
+{
+    switch(method)
+    {
+    case OUTPUT_METHOD_SPLICE:
+        return "splice";
+    case OUTPUT_METHOD_SENDFILE:
+        return "sendfile";
+    case OUTPUT_METHOD_COPY_FILE_RANGE:
+        return "copy_file_range";
+    case OUTPUT_METHOD_READ_WRITE:
+        return "read_write";
+    case OUTPUT_METHOD_IO_URING:
+        return "io_uring";
+    default:
+        return "none";
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _pick_output_method
+// Notes:   Looks at what out_fd really is.  Terminals and anything weird get
+//          the copy loop.
+//
+//******************************************************************************
+static output_method _pick_output_method(int out_fd)
+{
+#ifdef __linux__
+    struct stat out_stat;
+
+    if(fstat(out_fd, &out_stat) == 0)
+    {
+        if(S_ISFIFO(out_stat.st_mode))
+        {
+            return OUTPUT_METHOD_SPLICE;
+        }
+        if(S_ISSOCK(out_stat.st_mode))
+        {
+            return OUTPUT_METHOD_SENDFILE;
+        }
+        if(S_ISREG(out_stat.st_mode))
+        {
+            return OUTPUT_METHOD_COPY_FILE_RANGE;
+        }
+    }
+#endif
+    return OUTPUT_METHOD_READ_WRITE;
+}
+
+
+
+//******************************************************************************
+// Name:    _kernel_copy
+// Notes:   One call of the chosen kernel path.  All of them take the input
+//          offset by pointer and advance it, so the log file's own position is
+//          never touched.
+//
+//******************************************************************************
+static ssize_t _kernel_copy(output_method method, int in_fd, off_t *offset, size_t size, int out_fd)
+{
+#ifdef __linux__
+    switch(method)
+    {
+    case OUTPUT_METHOD_SPLICE:
+        return splice(in_fd, offset, out_fd, NULL, size, SPLICE_F_MOVE | SPLICE_F_MORE);
+    case OUTPUT_METHOD_SENDFILE:
+        return sendfile(out_fd, in_fd, offset, size);
+    case OUTPUT_METHOD_COPY_FILE_RANGE:
+        return copy_file_range(in_fd, offset, out_fd, NULL, size, 0);
+    default:
+        break;
+    }
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+
+
+//******************************************************************************
+// Name:    _kernel_method_unsupported
+// Notes:   These are the errors that mean "not with these descriptors" rather
+//          than "something actually broke", e.g. copy_file_range into an
+//          O_APPEND file or across filesystems on older kernels.
+//
+//******************************************************************************
+static int _kernel_method_unsupported(int error)
+{
+    return (error == EINVAL || error == ENOSYS || error == EXDEV ||
+            error == EBADF  || error == EOPNOTSUPP || error == EPERM);
+}
+
+
+
+//******************************************************************************
+// Name:    _wait_for_output
+// Notes:   Somebody handed us a non-blocking stdout, just wait until it can
+//          take more.
+//
+//******************************************************************************
+static int _wait_for_output(int out_fd)
+{
+    struct pollfd pfd;
+    pfd.fd = out_fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    return poll(&pfd, 1, -1) > 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _read_write_copy
+// Notes:   The old reliable.  pread so we don't care where the file pointer
+//          is, and keep writing until the kernel takes everything.  With a
+//          reader the data comes from there instead of in_fd.
+//
+//******************************************************************************
+static off_t _read_write_copy(int in_fd, range_reader reader, off_t start_offset, off_t end_offset, int out_fd)
+{
+    off_t offset = start_offset;
+    ssize_t read_size;
+    size_t size;
+
+    if(copy_buffer == NULL)
+    {
+        copy_buffer = malloc(COPY_BUFFER_SIZE);
+        if(copy_buffer == NULL)
+        {
+            console_print_error("Could not allocate output buffer.\n");
+            return -1;
+        }
+    }
+
+    while(offset < end_offset)
+    {
+        size = COPY_BUFFER_SIZE;
+        if(end_offset - offset < COPY_BUFFER_SIZE)
+        {
+            size = (size_t)(end_offset - offset);
+        }
+
+        if(reader != NULL)
+        {
+            read_size = reader(copy_buffer, size, offset);
+        }
+        else
+        {
+            read_size = pread(in_fd, copy_buffer, size, offset);
+        }
+        if(read_size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(read_size <= 0)
+        {
+            break;
+        }
+
+        if(!_write_all(out_fd, copy_buffer, (size_t)read_size, &offset))
+        {
+            console_print_error("Output failed after %lld bytes.\n",(long long int)(offset - start_offset));
+            break;
+        }
+    }
+    return offset - start_offset;
+}
+
+
+
+//******************************************************************************
+// Name:    _mapped_write_copy
+// Notes:   Same idea as above but the file is already in memory, so there's
+//          nothing to read.  Still chunked so a bad output doesn't fault in
+//          the whole range before we notice.
+//
+//******************************************************************************
+static off_t _mapped_write_copy(const char *in_map, off_t start_offset, off_t end_offset, int out_fd)
+{
+    off_t offset = start_offset;
+    size_t size;
+
+    while(offset < end_offset)
+    {
+        size = COPY_BUFFER_SIZE;
+        if(end_offset - offset < COPY_BUFFER_SIZE)
+        {
+            size = (size_t)(end_offset - offset);
+        }
+        if(!_write_all(out_fd, in_map + offset, size, &offset))
+        {
+            console_print_error("Output failed after %lld bytes.\n",(long long int)(offset - start_offset));
+            break;
+        }
+    }
+    return offset - start_offset;
+}
+
+
+
+//******************************************************************************
+// Name:    _write_all
+// Notes:   Keeps calling write until everything is out, moving written_total
+//          along as it goes.  Returns 0 if the output gave up on us.
+//
+//******************************************************************************
+static int _write_all(int out_fd, const char *working, size_t size, off_t *written_total)
+{
+    ssize_t written;
+
+    while(size > 0)
+    {
+        written = write(out_fd, working, size);
+        if(written < 0)
+        {
+            if(errno == EINTR || (errno == EAGAIN && _wait_for_output(out_fd)))
+            {
+                continue;
+            }
+            return 0;
+        }
+        working += written;
+        size -= (size_t)written;
+        *written_total += (off_t)written;
+    }
+    return 1;
+}
@@ -0,0 +1,73 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    range_output.h
+// Notes:   header for the range_output module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_RANGE_OUTPUT_H__
+#define __TGREP_RANGE_OUTPUT_H__
+
+#include <sys/types.h>
+
+//the different ways we know how to move bytes from the log to the output.
+//the kernel ones never copy the data through user space.
+typedef enum
+{
+    OUTPUT_METHOD_NONE = 0,
+    OUTPUT_METHOD_SPLICE,
+    OUTPUT_METHOD_SENDFILE,
+    OUTPUT_METHOD_COPY_FILE_RANGE,
+    OUTPUT_METHOD_READ_WRITE,
+    OUTPUT_METHOD_IO_URING
+} output_method;
+
+//with this on output_file_range runs the copy through the io_uring
+//pipeline first, whatever out_fd is, and only falls back to the paths above
+//if the ring can't handle it
+void set_output_io_uring(int enabled);
+
+//copies [start_offset, end_offset) from in_fd to out_fd, picking the best
+//path for whatever out_fd happens to be and falling back to a plain copy
+//loop when the kernel won't play along.  If the caller already has the file
+//mapped, pass the mapping as in_map and the fallback writes straight out of
+//it instead of reading into a buffer first (NULL otherwise).  Returns the
+//number of bytes written or -1 if nothing could be written at all.
+off_t output_file_range(int in_fd, const char *in_map, off_t start_offset, off_t end_offset, int out_fd);
+
+//for logs that can't be handed to the kernel as they are (compressed ones),
+//the same copy but pulling [start_offset, end_offset) through reader, which
+//behaves like pread.
+typedef ssize_t (*range_reader)(char *buffer, size_t size, off_t offset);
+off_t output_reader_range(range_reader reader, off_t start_offset, off_t end_offset, int out_fd);
+
+//write() the whole buffer, riding out short writes, EINTR and a
+//non-blocking out_fd.  returns how much got written, size unless output
+//failed.
+off_t output_buffer(const char *data, size_t size, int out_fd);
+
+//which path the last output_file_range call ended up using, for -v/--stats
+output_method get_output_method(void);
+const char *get_output_method_name(output_method method);
+
+#endif
@@ -0,0 +1,529 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    stats.c
+// Notes:   Keeps the counters and phase timers that --stats reports.
+//          Collection is off by default so the rest of the program can
+//          sprinkle stats_add calls around without caring.  The report goes
+//          to stderr as JSON so it never gets mixed in with the log output
+//          on stdout.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "stats.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//heap allocations are counted by putting our own malloc in front of glibc's,
+//which isn't something the shipped tgrep should do, so it's only built in
+//with "make COUNT_ALLOCATIONS=1".  otherwise the counts aren't reported.
+#if defined(TGREP_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+#define STATS_COUNT_ALLOCATIONS
+#endif
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static int stats_on = 0;
+
+static long long int counters[STAT_COUNT];
+static const char *labels[STAT_LABEL_COUNT];
+
+//nanoseconds so far for each timer, and when the running ones started
+static long long int timer_totals[STAT_TIMER_COUNT];
+static long long int timer_starts[STAT_TIMER_COUNT];
+
+#ifdef STATS_COUNT_ALLOCATIONS
+//every allocation the process has made (from any thread), and the same per
+//timer
+static long long int heap_allocations = 0;
+static long long int timer_allocations[STAT_TIMER_COUNT];
+static long long int timer_allocation_starts[STAT_TIMER_COUNT];
+#endif
+
+//these have to line up with the enums in stats.h
+static const char *counter_names[STAT_COUNT] =
+{
+    "output_ranges",
+    "output_bytes",
+    "files_searched",
+    "files_skipped",
+    "blocks_decompressed",
+    "bytes_decompressed",
+    "probe_rounds",
+    "probe_reads",
+    "probe_bytes",
+    "probe_window_grows",
+    "prefetch_bytes",
+    "filter_matches",
+    "map_entries_loaded",
+    "searches",
+    "map_hits",
+    "probe_interpolations",
+    "probe_bisections",
+    "probe_boundaries",
+    "map_blocks",
+    "map_huge_blocks",
+    "map_peak_bytes",
+    "map_entries_coarsened"
+};
+
+static const char *label_names[STAT_LABEL_COUNT] =
+{
+    "reader",
+    "output_method",
+    "line_scan",
+    "io_engine",
+    "log_format"
+};
+
+static const char *timer_names[STAT_TIMER_COUNT] =
+{
+    "total_seconds",
+    "open_seconds",
+    "map_load_seconds",
+    "search_seconds",
+    "output_seconds",
+    "map_save_seconds"
+};
+
+#ifdef STATS_COUNT_ALLOCATIONS
+static const char *timer_allocation_names[STAT_TIMER_COUNT] =
+{
+    "total_allocations",
+    "open_allocations",
+    "map_load_allocations",
+    "search_allocations",
+    "output_allocations",
+    "map_save_allocations"
+};
+
+//the real ones
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+extern void __libc_free(void *pointer);
+#endif
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static long long int _now_ns(void);
+#ifdef STATS_COUNT_ALLOCATIONS
+static long long int _allocations(void);
+#endif
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    stats_enable
+// Notes:   Turns on collection (--stats)
+//
+//******************************************************************************
+void stats_enable(void)
+{
+    stats_on = 1;
+}
+
+
+
+//******************************************************************************
+// Name:    stats_enabled
+// Notes:   Lets callers skip work that only exists to feed the report
+//
+//******************************************************************************
+int stats_enabled(void)
+{
+    return stats_on;
+}
+
+
+
+//******************************************************************************
+// Name:    stats_add
+// Notes:   Bumps a counter
+//
+//******************************************************************************
+void stats_add(stat_counter counter, long long int value)
+{
+    if(stats_on && counter < STAT_COUNT)
+    {
+        counters[counter] += value;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    stats_max
+// Notes:   Keeps the biggest value it's been given
+//
+//******************************************************************************
+void stats_max(stat_counter counter, long long int value)
+{
+    if(stats_on && counter < STAT_COUNT && value > counters[counter])
+    {
+        counters[counter] = value;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    stats_get
+// Notes:   Reads a counter back
+//
+//******************************************************************************
+long long int stats_get(stat_counter counter)
+{
+    if(counter < STAT_COUNT)
+    {
+        return counters[counter];
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    stats_set_label
+// Notes:   Labels have to be string constants, we just keep the pointer
+//
+//******************************************************************************
+void stats_set_label(stat_label label, const char *value)
+{
+    if(stats_on && label < STAT_LABEL_COUNT)
+    {
+        labels[label] = value;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    stats_timer_start
+// Notes:   Starts (or restarts) a phase
+//
+//******************************************************************************
+void stats_timer_start(stat_timer timer)
+{
+    if(stats_on && timer < STAT_TIMER_COUNT)
+    {
+        timer_starts[timer] = _now_ns();
+#ifdef STATS_COUNT_ALLOCATIONS
+        timer_allocation_starts[timer] = _allocations();
+#endif
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    stats_timer_stop
+// Notes:   Adds the time since the start, a stop without a start does nothing
+//
+//******************************************************************************
+void stats_timer_stop(stat_timer timer)
+{
+    if(stats_on && timer < STAT_TIMER_COUNT && timer_starts[timer] != 0)
+    {
+        timer_totals[timer] += _now_ns() - timer_starts[timer];
+        timer_starts[timer] = 0;
+#ifdef STATS_COUNT_ALLOCATIONS
+        timer_allocations[timer] += _allocations() - timer_allocation_starts[timer];
+#endif
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    stats_print
+// Notes:   One JSON object on one line, easy to pick out of stderr
+//
+//******************************************************************************
+void stats_print(void)
+{
+    int i;
+    if(!stats_on)
+    {
+        return;
+    }
+
+    fprintf(stderr,"{");
+    for(i = 0; i < STAT_LABEL_COUNT; i++)
+    {
+        fprintf(stderr,"\"%s\":\"%s\",",label_names[i],labels[i] ? labels[i] : "none");
+    }
+    for(i = 0; i < STAT_COUNT; i++)
+    {
+        fprintf(stderr,"\"%s\":%lld,",counter_names[i],counters[i]);
+    }
+    for(i = 0; i < STAT_TIMER_COUNT; i++)
+    {
+        fprintf(stderr,"\"%s\":%.6f,",timer_names[i],(double)timer_totals[i] / 1e9);
+    }
+#ifdef STATS_COUNT_ALLOCATIONS
+    for(i = 0; i < STAT_TIMER_COUNT; i++)
+    {
+        fprintf(stderr,"\"%s\":%lld,",timer_allocation_names[i],timer_allocations[i]);
+    }
+#endif
+
+    //the two everybody works out by hand anyway
+    fprintf(stderr,"\"probe_bytes_per_read\":%lld,",
+            counters[STAT_PROBE_READS] ? counters[STAT_PROBE_BYTES] / counters[STAT_PROBE_READS] : 0);
+    fprintf(stderr,"\"output_mb_per_second\":%.1f}\n",
+            timer_totals[STAT_TIMER_OUTPUT] ? (double)counters[STAT_OUTPUT_BYTES] / (1024.0 * 1024.0) /
+                                              ((double)timer_totals[STAT_TIMER_OUTPUT] / 1e9) : 0.0);
+}
+
+
+
+//******************************************************************************
+// Name:    stats_reset
+// Notes:   Zeroes the counters and timers and forgets the labels,
+//          collection stays on
+//
+//******************************************************************************
+void stats_reset(void)
+{
+    memset(counters, 0, sizeof(counters));
+    memset(labels, 0, sizeof(labels));
+    memset(timer_totals, 0, sizeof(timer_totals));
+    memset(timer_starts, 0, sizeof(timer_starts));
+#ifdef STATS_COUNT_ALLOCATIONS
+    memset(timer_allocations, 0, sizeof(timer_allocations));
+    memset(timer_allocation_starts, 0, sizeof(timer_allocation_starts));
+#endif
+}
+
+
+
+//******************************************************************************
+// Name:    _now_ns
+// Notes:   Monotonic nanoseconds, never 0 so 0 can mean "not running"
+//
+//******************************************************************************
+static long long int _now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long int)now.tv_sec * 1000000000LL + now.tv_nsec + 1;
+}
+
+
+
+#ifdef STATS_COUNT_ALLOCATIONS
+//******************************************************************************
+// Name:    _allocations
+// Notes:   How many heap allocations there have been so far
+//
+//******************************************************************************
+static long long int _allocations(void)
+{
+    return __atomic_load_n(&heap_allocations, __ATOMIC_RELAXED);
+}
+
+
+
+//******************************************************************************
+// Name:    malloc
+// Notes:   Counts and hands on to glibc.  glibc wants malloc, calloc, realloc
+//          and free replaced together, and the aligned ones as well or they
+//          go uncounted.  Every block still comes from glibc's allocator so
+//          its own malloc_usable_size is right for them.
+//
+//******************************************************************************
+void *malloc(size_t size)
+{
+    __atomic_fetch_add(&heap_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+
+
+//******************************************************************************
+// Name:    calloc
+// Notes:   see malloc
+//
+//******************************************************************************
+void *calloc(size_t count, size_t size)
+{
+    __atomic_fetch_add(&heap_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+
+
+//******************************************************************************
+// Name:    realloc
+// Notes:   see malloc, a realloc can move the block so it counts as one
+//
+//******************************************************************************
+void *realloc(void *pointer, size_t size)
+{
+    __atomic_fetch_add(&heap_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(pointer, size);
+}
+
+
+
+//******************************************************************************
+// Name:    reallocarray
+// Notes:   see realloc, glibc's own doesn't come back through ours
+//
+//******************************************************************************
+void *reallocarray(void *pointer, size_t count, size_t size)
+{
+    if(size != 0 && count > (size_t)-1 / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(pointer, count * size);
+}
+
+
+
+//******************************************************************************
+// Name:    free
+// Notes:   Not counted, only here because glibc needs it replaced with the
+//          rest
+//
+//******************************************************************************
+void free(void *pointer)
+{
+    __libc_free(pointer);
+}
+
+
+
+//******************************************************************************
+// Name:    memalign
+// Notes:   see malloc
+//
+//******************************************************************************
+void *memalign(size_t alignment, size_t size)
+{
+    __atomic_fetch_add(&heap_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_memalign(alignment, size);
+}
+
+
+
+//******************************************************************************
+// Name:    aligned_alloc
+// Notes:   see malloc
+//
+//******************************************************************************
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return memalign(alignment, size);
+}
+
+
+
+//******************************************************************************
+// Name:    posix_memalign
+// Notes:   see malloc
+//
+//******************************************************************************
+int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    void *block;
+
+    if(alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0)
+    {
+        return EINVAL;
+    }
+    block = memalign(alignment, size);
+    if(block == NULL)
+    {
+        return ENOMEM;
+    }
+    *pointer = block;
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    valloc
+// Notes:   see malloc
+//
+//******************************************************************************
+void *valloc(size_t size)
+{
+    __atomic_fetch_add(&heap_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_valloc(size);
+}
+
+
+
+//******************************************************************************
+// Name:    pvalloc
+// Notes:   see malloc
+//
+//******************************************************************************
+void *pvalloc(size_t size)
+{
+    __atomic_fetch_add(&heap_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_pvalloc(size);
+}
+#endif
@@ -0,0 +1,106 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    stats.h
+// Notes:   header for the stats module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_STATS_H__
+#define __TGREP_STATS_H__
+
+//every counter we keep.  add new ones before STAT_COUNT and give them a name
+//in stats.c
+typedef enum
+{
+    STAT_OUTPUT_RANGES = 0,
+    STAT_OUTPUT_BYTES,
+    STAT_FILES_SEARCHED,
+    STAT_FILES_SKIPPED,
+    STAT_BLOCKS_DECOMPRESSED,
+    STAT_BYTES_DECOMPRESSED,
+    STAT_PROBE_ROUNDS,
+    STAT_PROBE_READS,
+    STAT_PROBE_BYTES,
+    STAT_PROBE_WINDOW_GROWS,
+    STAT_PREFETCH_BYTES,
+    STAT_FILTER_MATCHES,
+    STAT_MAP_ENTRIES_LOADED,
+    STAT_SEARCHES,
+    STAT_MAP_HITS,
+    STAT_PROBE_INTERPOLATIONS,
+    STAT_PROBE_BISECTIONS,
+    STAT_PROBE_BOUNDARIES,
+    STAT_MAP_BLOCKS,
+    STAT_MAP_HUGE_BLOCKS,
+    STAT_MAP_PEAK_BYTES,
+    STAT_MAP_ENTRIES_COARSENED,
+    STAT_COUNT
+} stat_counter;
+
+//labels are the non-numeric bits of the report
+typedef enum
+{
+    STAT_LABEL_READER = 0,
+    STAT_LABEL_OUTPUT_METHOD,
+    STAT_LABEL_LINE_SCAN,
+    STAT_LABEL_IO_ENGINE,
+    STAT_LABEL_LOG_FORMAT,
+    STAT_LABEL_COUNT
+} stat_label;
+
+//wall time per phase of a search, reported in seconds, along with how many
+//heap allocations each phase made when built to count them (see stats.c)
+typedef enum
+{
+    STAT_TIMER_TOTAL = 0,
+    STAT_TIMER_OPEN,
+    STAT_TIMER_MAP_LOAD,
+    STAT_TIMER_SEARCH,
+    STAT_TIMER_OUTPUT,
+    STAT_TIMER_MAP_SAVE,
+    STAT_TIMER_COUNT
+} stat_timer;
+
+//--stats turns collection on, everything is a no-op otherwise
+void stats_enable(void);
+int stats_enabled(void);
+
+void stats_add(stat_counter counter, long long int value);
+long long int stats_get(stat_counter counter);
+
+//for counters that are a high water mark rather than a total
+void stats_max(stat_counter counter, long long int value);
+void stats_set_label(stat_label label, const char *value);
+
+//a phase runs from start to stop, a phase that runs more than once (one
+//search per window, one dump per range) adds up
+void stats_timer_start(stat_timer timer);
+void stats_timer_stop(stat_timer timer);
+
+//dumps everything we collected to stderr as a single JSON object
+void stats_print(void);
+
+//back to zero, for the daemon's one report per query
+void stats_reset(void);
+
+#endif
@@ -0,0 +1,809 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    synthetic_log.c
+// Notes:   Made up logs for benchmarking, in the same format makelog.pl
+//          writes but with traffic that isn't spread evenly: a daily cycle,
+//          bursts, holes, midnight in the middle, lines far longer than a
+//          probe window.  Where interpolation search earns its keep (or
+//          doesn't) depends on exactly that.
+//
+//          Everything comes from a seeded hash of the second or the line
+//          number, so any byte of the log can be made without making the
+//          ones before it.  Opening one works out how many lines each
+//          second gets and where each second starts, and from there a read
+//          anywhere is a binary search and some formatting.  log_gen uses
+//          that to write real files from several threads, and tgrep reads
+//          spec files through it (as if they were compressed logs) so a TB
+//          sized log doesn't need a TB of disk.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "synthetic_log.h"
+#include "parse_time.h"
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//a line has to at least hold its stamp, address and line number
+#define SYNTHETIC_MIN_LINE      (72)
+#define SYNTHETIC_MAX_LINE      (1024*1024)
+
+//a month, the per second tables are 16 bytes a second
+#define SYNTHETIC_MAX_DURATION  (31*SECONDS_PER_DAY)
+
+#define SYNTHETIC_DEFAULT_SIZE  (1024LL*1024*1024)
+
+//bursty: a burst starts in about one second in this many, jumps to PEAK
+//times the base rate and dies off over BURST_SECONDS
+#define BURST_CHANCE            (500)
+#define BURST_PEAK              (30.0)
+#define BURST_SECONDS           (60)
+#define BURST_BASE              (0.25)
+
+//gaps: half the hours lose a stretch of up to 20 minutes, and a few
+//seconds here and there are empty
+#define GAP_MIN_SECONDS         (60)
+#define GAP_MAX_EXTRA           (1140)
+#define GAP_SECOND_CHANCE       (30)
+
+//long lines: about one second in LONG_CHANCE has one line of up to
+//2^LONG_MAX_SHIFT lines' worth
+#define LONG_CHANCE             (600)
+#define LONG_MAX_SHIFT          (14)
+
+//which hash each decision uses
+#define SALT_ROUND              (0x1)
+#define SALT_BURST              (0x2)
+#define SALT_GAP_HOUR           (0x3)
+#define SALT_GAP_SECOND         (0x4)
+#define SALT_LONG               (0x5)
+#define SALT_ADDRESS            (0x6)
+
+//what goes after the line number to pad a line out
+#define SYNTHETIC_PADDING       " | GET /api/v1/items?id=4242&page=7 HTTP/1.1 200 5183 - - ---- 3/3/0/0/0 0/0"
+#define SYNTHETIC_PADDING_SIZE  (sizeof(SYNTHETIC_PADDING) - 1)
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static const char *shape_names[SHAPE_COUNT] =
+{
+    "uniform",
+    "diurnal",
+    "bursty",
+    "gaps",
+    "midnight",
+    "long_lines"
+};
+
+static const char *month_names[12] =
+{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+//the open log: where every second starts, in bytes and in lines, with one
+//extra entry at the end for the totals
+static synthetic_spec log_spec;
+static int second_count = 0;
+static int64_t *second_offsets = NULL;
+static uint64_t *second_first_lines = NULL;
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static uint64_t _hash(uint64_t value, uint64_t salt);
+static double _second_weight(int second);
+static int _long_line(int second, uint64_t line_count, uint64_t *index, int64_t *length);
+static int _find_second(off_t offset);
+static void _copy_line(int second, uint64_t line_number, int64_t length, int64_t from, int64_t to, char *dest);
+static int _format_header(int second, uint64_t line_number, char *header);
+static int64_t _parse_size(const char *text);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    synthetic_spec_defaults
+// Notes:   Same start as makelog.pl
+//
+//******************************************************************************
+void synthetic_spec_defaults(synthetic_spec *spec, synthetic_shape shape)
+{
+    memset(spec, 0, sizeof(*spec));
+    spec->shape = shape;
+    spec->start_month = 1;
+    spec->start_day = 9;
+    spec->start_time = 6*3600 + 52*60;
+    spec->duration = SECONDS_PER_DAY;
+    spec->size = SYNTHETIC_DEFAULT_SIZE;
+    spec->line_length = 100;
+    spec->seed = 1;
+
+    if(shape == SHAPE_MIDNIGHT)
+    {
+        spec->start_time = 22*3600;
+        spec->duration = 4*3600;
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_shape_from_name
+// Notes:   SHAPE_COUNT for anything we don't know
+//
+//******************************************************************************
+synthetic_shape synthetic_shape_from_name(const char *name)
+{
+    int i;
+
+    for(i = 0; i < SHAPE_COUNT; i++)
+    {
+        if(strcmp(name, shape_names[i]) == 0)
+        {
+            return (synthetic_shape)i;
+        }
+    }
+    return SHAPE_COUNT;
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_shape_name
+// Notes:   The other way round
+//
+//******************************************************************************
+const char *synthetic_shape_name(synthetic_shape shape)
+{
+    return (shape < SHAPE_COUNT) ? shape_names[shape] : "unknown";
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_spec_parse
+// Notes:   The shape has to come first if it's given at all, everything after
+//          it goes on top of that shape's defaults.  Unknown keys are an
+//          error so a typo doesn't quietly benchmark the wrong thing.
+//
+//******************************************************************************
+int synthetic_spec_parse(const char *text, size_t length, synthetic_spec *spec)
+{
+    size_t magic_length = strlen(SYNTHETIC_SPEC_MAGIC);
+    char line[256];
+    const char *working;
+    const char *end = text + length;
+    const char *newline;
+    char *value;
+    size_t line_length;
+
+    if(length < magic_length || memcmp(text, SYNTHETIC_SPEC_MAGIC, magic_length) != 0)
+    {
+        return -1;
+    }
+    synthetic_spec_defaults(spec, SHAPE_UNIFORM);
+
+    for(working = text + magic_length; working < end; working = newline + 1)
+    {
+        newline = memchr(working, '\n', (size_t)(end - working));
+        if(newline == NULL)
+        {
+            newline = end;
+        }
+        line_length = (size_t)(newline - working);
+        if(line_length == 0 || working[0] == '#')
+        {
+            continue;
+        }
+        if(line_length >= sizeof(line))
+        {
+            return -1;
+        }
+        memcpy(line, working, line_length);
+        line[line_length] = '\0';
+
+        value = strchr(line, '=');
+        if(value == NULL)
+        {
+            return -1;
+        }
+        *value++ = '\0';
+
+        if(strcmp(line, "shape") == 0)
+        {
+            synthetic_shape shape = synthetic_shape_from_name(value);
+            if(shape == SHAPE_COUNT)
+            {
+                return -1;
+            }
+            synthetic_spec_defaults(spec, shape);
+        }
+        else if(strcmp(line, "start") == 0)
+        {
+            if(synthetic_spec_set_start(spec, value) < 0)
+            {
+                return -1;
+            }
+        }
+        else if(strcmp(line, "duration") == 0)
+        {
+            spec->duration = atoi(value);
+        }
+        else if(strcmp(line, "size") == 0)
+        {
+            spec->size = _parse_size(value);
+        }
+        else if(strcmp(line, "line_length") == 0)
+        {
+            spec->line_length = atoi(value);
+        }
+        else if(strcmp(line, "seed") == 0)
+        {
+            spec->seed = strtoull(value, NULL, 10);
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_spec_format
+// Notes:   snprintf rules, the return is what it would have taken
+//
+//******************************************************************************
+int synthetic_spec_format(const synthetic_spec *spec, char *text, size_t length)
+{
+    return snprintf(text, length,
+                    "%sshape=%s\nstart=%s %2d %02d:%02d:%02d\nduration=%d\nsize=%lld\nline_length=%d\nseed=%llu\n",
+                    SYNTHETIC_SPEC_MAGIC, synthetic_shape_name(spec->shape),
+                    month_names[spec->start_month], spec->start_day,
+                    spec->start_time / 3600, (spec->start_time / 60) % 60, spec->start_time % 60,
+                    spec->duration, (long long int)spec->size, spec->line_length,
+                    (unsigned long long int)spec->seed);
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_spec_set_start
+// Notes:   Same stamp the lines start with
+//
+//******************************************************************************
+int synthetic_spec_set_start(synthetic_spec *spec, const char *stamp)
+{
+    char month[4];
+    int day;
+    int hours;
+    int minutes;
+    int seconds;
+    int i;
+
+    if(sscanf(stamp, "%3s %d %d:%d:%d", month, &day, &hours, &minutes, &seconds) != 5)
+    {
+        return -1;
+    }
+    for(i = 0; i < 12; i++)
+    {
+        if(strcmp(month, month_names[i]) == 0)
+        {
+            break;
+        }
+    }
+    if(i == 12 || day < 1 || day > month_days[i] || hours < 0 || hours > 23 ||
+       minutes < 0 || minutes > 59 || seconds < 0 || seconds > 59)
+    {
+        return -1;
+    }
+    spec->start_month = i;
+    spec->start_day = day;
+    spec->start_time = hours*3600 + minutes*60 + seconds;
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_log_open
+// Notes:   The rate gets scaled so the whole thing comes out at about the
+//          size asked for.  Each second's
+//          share is rounded up or down at random, so a slow second still
+//          gets a line now and then.
+//
+//******************************************************************************
+int synthetic_log_open(const synthetic_spec *spec)
+{
+    double total_weight = 0;
+    int64_t long_bytes = 0;
+    double rate;
+    uint64_t lines;
+    uint64_t long_index;
+    int64_t long_length;
+    int i;
+
+    synthetic_log_close();
+    if(spec->shape >= SHAPE_COUNT || spec->duration <= 0 || spec->duration > SYNTHETIC_MAX_DURATION ||
+       spec->line_length < SYNTHETIC_MIN_LINE || spec->line_length > SYNTHETIC_MAX_LINE || spec->size <= 0)
+    {
+        return -1;
+    }
+
+    log_spec = *spec;
+    second_count = spec->duration;
+    second_offsets = malloc((second_count + 1) * sizeof(int64_t));
+    second_first_lines = malloc((second_count + 1) * sizeof(uint64_t));
+    if(second_offsets == NULL || second_first_lines == NULL)
+    {
+        synthetic_log_close();
+        return -1;
+    }
+
+    //long lines come out of the same budget, the ordinary ones get what's left
+    for(i = 0; i < second_count; i++)
+    {
+        total_weight += _second_weight(i);
+        if(_long_line(i, 1, &long_index, &long_length))
+        {
+            long_bytes += long_length - spec->line_length;
+        }
+    }
+    if(total_weight <= 0)
+    {
+        synthetic_log_close();
+        return -1;
+    }
+    if(long_bytes > spec->size / 2)
+    {
+        long_bytes = spec->size / 2;
+    }
+    rate = ((double)(spec->size - long_bytes) / spec->line_length) / total_weight;
+
+    second_offsets[0] = 0;
+    second_first_lines[0] = 0;
+    for(i = 0; i < second_count; i++)
+    {
+        lines = (uint64_t)(_second_weight(i) * rate + (double)(_hash(i, SALT_ROUND) >> 11) / (double)(1ULL << 53));
+        second_first_lines[i + 1] = second_first_lines[i] + lines;
+        second_offsets[i + 1] = second_offsets[i] + (int64_t)lines * spec->line_length;
+        if(_long_line(i, lines, &long_index, &long_length))
+        {
+            second_offsets[i + 1] += long_length - spec->line_length;
+        }
+    }
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_log_close
+// Notes:   Forgets the layout
+//
+//******************************************************************************
+void synthetic_log_close(void)
+{
+    free(second_offsets);
+    free(second_first_lines);
+    second_offsets = NULL;
+    second_first_lines = NULL;
+    second_count = 0;
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_log_size
+// Notes:   In bytes
+//
+//******************************************************************************
+off_t synthetic_log_size(void)
+{
+    return (second_offsets != NULL) ? (off_t)second_offsets[second_count] : 0;
+}
+
+
+
+//******************************************************************************
+// Name:    synthetic_log_read
+// Notes:   Finds the second, then the line (only one line in a second is
+//          ever a different length, so that's arithmetic), and copies out
+//          a line or part of one at a time.
+//
+//******************************************************************************
+ssize_t synthetic_log_read(char *buffer, size_t size, off_t offset)
+{
+    int64_t line_length = log_spec.line_length;
+    int64_t long_length;
+    int64_t past_long;
+    int64_t relative;
+    int64_t line_start;
+    int64_t length;
+    int64_t chunk;
+    uint64_t long_index;
+    uint64_t lines;
+    uint64_t line;
+    size_t copied = 0;
+    int has_long;
+    int second;
+
+    if(second_offsets == NULL || offset < 0)
+    {
+        return -1;
+    }
+
+    while(copied < size && offset < (off_t)second_offsets[second_count])
+    {
+        second = _find_second(offset);
+        relative = (int64_t)offset - second_offsets[second];
+        lines = second_first_lines[second + 1] - second_first_lines[second];
+        has_long = _long_line(second, lines, &long_index, &long_length);
+
+        length = line_length;
+        if(!has_long || relative < (int64_t)long_index * line_length)
+        {
+            line = (uint64_t)(relative / line_length);
+            line_start = (int64_t)line * line_length;
+        }
+        else if(relative < (int64_t)long_index * line_length + long_length)
+        {
+            line = long_index;
+            line_start = (int64_t)long_index * line_length;
+            length = long_length;
+        }
+        else
+        {
+            past_long = (int64_t)long_index * line_length + long_length;
+            line = long_index + 1 + (uint64_t)((relative - past_long) / line_length);
+            line_start = past_long + (int64_t)(line - long_index - 1) * line_length;
+        }
+
+        chunk = length - (relative - line_start);
+        if(chunk > (int64_t)(size - copied))
+        {
+            chunk = (int64_t)(size - copied);
+        }
+        _copy_line(second, second_first_lines[second] + line + 1, length, relative - line_start,
+                   relative - line_start + chunk, buffer + copied);
+        copied += (size_t)chunk;
+        offset += (off_t)chunk;
+    }
+    return (ssize_t)copied;
+}
+
+
+
+//******************************************************************************
+// Name:    _hash
+// Notes:   splitmix64 of the value, the salt and the seed
+//
+//******************************************************************************
+static uint64_t _hash(uint64_t value, uint64_t salt)
+{
+    uint64_t z = value * 0x9e3779b97f4a7c15ULL + (salt << 56) + log_spec.seed * 0xbf58476d1ce4e5b9ULL;
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+
+//******************************************************************************
+// Name:    _second_weight
+// Notes:   How busy a second is compared to the others.  The daily cycle is
+//          quietest at 04:00 and busiest at 16:00, eased in and out so
+//          there's no kink for the interpolation to land on.
+//
+//******************************************************************************
+static double _second_weight(int second)
+{
+    int absolute = log_spec.start_time + second;
+    int time_of_day = absolute % SECONDS_PER_DAY;
+    double weight = 1.0;
+    double x;
+    uint64_t hash;
+    int gap_start;
+    int i;
+
+    switch(log_spec.shape)
+    {
+    case SHAPE_DIURNAL:
+        x = (double)((time_of_day - 4*3600 + SECONDS_PER_DAY) % SECONDS_PER_DAY) / SECONDS_PER_DAY;
+        x = (x < 0.5) ? 2*x : 2 - 2*x;
+        weight = 0.1 + 0.9 * x * x * (3 - 2*x);
+        break;
+
+    case SHAPE_BURSTY:
+        weight = BURST_BASE;
+        for(i = 0; i < BURST_SECONDS && i <= second; i++)
+        {
+            if(_hash(second - i, SALT_BURST) % BURST_CHANCE == 0)
+            {
+                weight += BURST_PEAK * (BURST_SECONDS - i) / BURST_SECONDS;
+            }
+        }
+        break;
+
+    case SHAPE_GAPS:
+        hash = _hash(absolute / 3600, SALT_GAP_HOUR);
+        gap_start = (int)((hash >> 8) % 3600);
+        if((hash & 1) && absolute % 3600 >= gap_start &&
+           absolute % 3600 < gap_start + GAP_MIN_SECONDS + (int)((hash >> 24) % GAP_MAX_EXTRA))
+        {
+            weight = 0;
+        }
+        else if(_hash(second, SALT_GAP_SECOND) % GAP_SECOND_CHANCE == 0)
+        {
+            weight = 0;
+        }
+        break;
+
+    default:
+        break;
+    }
+    return weight;
+}
+
+
+
+//******************************************************************************
+// Name:    _long_line
+// Notes:   Whether this second has its one long line, which one it is and
+//          how long
+//
+//******************************************************************************
+static int _long_line(int second, uint64_t line_count, uint64_t *index, int64_t *length)
+{
+    uint64_t hash;
+    int64_t longest = SYNTHETIC_MAX_LINE * 2LL;
+
+    if(log_spec.shape != SHAPE_LONG_LINES || line_count == 0)
+    {
+        return 0;
+    }
+    hash = _hash(second, SALT_LONG);
+    if(hash % LONG_CHANCE != 0)
+    {
+        return 0;
+    }
+    *index = (hash >> 8) % line_count;
+    *length = (int64_t)log_spec.line_length << (1 + (hash >> 40) % LONG_MAX_SHIFT);
+    if(*length > longest)
+    {
+        *length = longest;
+    }
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _find_second
+// Notes:   The last second starting at or before offset.  Empty seconds
+//          start where the next one does, so the last one wins and that's
+//          the one with the bytes in it.
+//
+//******************************************************************************
+static int _find_second(off_t offset)
+{
+    int low = 0;
+    int high = second_count;
+    int middle;
+
+    while(high - low > 1)
+    {
+        middle = low + (high - low) / 2;
+        if(second_offsets[middle] <= (int64_t)offset)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+
+//******************************************************************************
+// Name:    _copy_line
+// Notes:   Bytes [from, to) of one line: the header, then padding, then the
+//          newline as its last byte.
+//
+//******************************************************************************
+static void _copy_line(int second, uint64_t line_number, int64_t length, int64_t from, int64_t to, char *dest)
+{
+    char header[128];
+    int64_t header_length = _format_header(second, line_number, header);
+    int64_t position = from;
+    int64_t chunk;
+    size_t pad_offset;
+
+    if(header_length > length - 1)
+    {
+        header_length = length - 1;
+    }
+
+    if(position < header_length)
+    {
+        chunk = ((to < header_length) ? to : header_length) - position;
+        memcpy(dest, header + position, (size_t)chunk);
+        dest += chunk;
+        position += chunk;
+    }
+    while(position < to && position < length - 1)
+    {
+        pad_offset = (size_t)((position - header_length) % (int64_t)SYNTHETIC_PADDING_SIZE);
+        chunk = (int64_t)(SYNTHETIC_PADDING_SIZE - pad_offset);
+        if(chunk > to - position)
+        {
+            chunk = to - position;
+        }
+        if(chunk > length - 1 - position)
+        {
+            chunk = length - 1 - position;
+        }
+        memcpy(dest, SYNTHETIC_PADDING + pad_offset, (size_t)chunk);
+        dest += chunk;
+        position += chunk;
+    }
+    if(position < to)
+    {
+        *dest = '\n';
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _format_header
+// Notes:   "Feb  9 06:52:00  | 32.206.223.119 | This is line number
+//          00000000000001", like makelog.pl.  Returns the length.
+//
+//******************************************************************************
+static int _format_header(int second, uint64_t line_number, char *header)
+{
+    int absolute = log_spec.start_time + second;
+    int month = log_spec.start_month;
+    int day = log_spec.start_day + absolute / SECONDS_PER_DAY;
+    int time_of_day = absolute % SECONDS_PER_DAY;
+    uint64_t address = _hash(line_number, SALT_ADDRESS);
+    char *working = header;
+    int octet;
+    int i;
+
+    while(day > month_days[month])
+    {
+        day -= month_days[month];
+        month = (month + 1) % 12;
+    }
+
+    //sprintf is most of the cost of making a line, so this is done by hand
+    memcpy(working, month_names[month], 3);
+    working[3] = ' ';
+    working[4] = (day >= 10) ? (char)('0' + day / 10) : ' ';
+    working[5] = (char)('0' + day % 10);
+    working[6] = ' ';
+    working[7] = (char)('0' + time_of_day / 36000);
+    working[8] = (char)('0' + (time_of_day / 3600) % 10);
+    working[9] = ':';
+    working[10] = (char)('0' + (time_of_day / 600) % 6);
+    working[11] = (char)('0' + (time_of_day / 60) % 10);
+    working[12] = ':';
+    working[13] = (char)('0' + (time_of_day % 60) / 10);
+    working[14] = (char)('0' + time_of_day % 10);
+    memcpy(working + 15, "  | ", 4);
+    working += 19;
+
+    for(i = 0; i < 4; i++)
+    {
+        octet = (int)((address >> (8*i)) & 0xff);
+        if(octet >= 100)
+        {
+            *working++ = (char)('0' + octet / 100);
+        }
+        if(octet >= 10)
+        {
+            *working++ = (char)('0' + (octet / 10) % 10);
+        }
+        *working++ = (char)('0' + octet % 10);
+        *working++ = (i < 3) ? '.' : ' ';
+    }
+
+    memcpy(working, "| This is line number ", 22);
+    working += 22;
+    for(i = 13; i >= 0; i--)
+    {
+        working[i] = (char)('0' + line_number % 10);
+        line_number /= 10;
+    }
+    working += 14;
+    return (int)(working - header);
+}
+
+
+
+//******************************************************************************
+// Name:    _parse_size
+// Notes:   Bytes, with an optional K/M/G/T (powers of 1024)
+//
+//******************************************************************************
+static int64_t _parse_size(const char *text)
+{
+    char *suffix;
+    int64_t size = strtoll(text, &suffix, 10);
+
+    switch(*suffix)
+    {
+    case 'T': case 't':
+        size *= 1024;
+        //fall through
+    case 'G': case 'g':
+        size *= 1024;
+        //fall through
+    case 'M': case 'm':
+        size *= 1024;
+        //fall through
+    case 'K': case 'k':
+        size *= 1024;
+        break;
+    default:
+        break;
+    }
+    return size;
+}
@@ -0,0 +1,91 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    synthetic_log.h
+// Notes:   header for the synthetic_log module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_SYNTHETIC_LOG_H__
+#define __TGREP_SYNTHETIC_LOG_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+//the first line of a spec file, which tgrep reads as the log it describes
+#define SYNTHETIC_SPEC_MAGIC "#!tgrep-synthetic 1\n"
+
+//how the traffic is spread over the day
+typedef enum
+{
+    SHAPE_UNIFORM = 0,
+    SHAPE_DIURNAL,
+    SHAPE_BURSTY,
+    SHAPE_GAPS,
+    SHAPE_MIDNIGHT,
+    SHAPE_LONG_LINES,
+    SHAPE_COUNT
+} synthetic_shape;
+
+//everything that decides the log's contents, the same spec always gives
+//the same bytes
+struct _synthetic_spec {
+    synthetic_shape shape;
+    int start_month;
+    int start_day;
+    int start_time;
+    int duration;
+    int64_t size;
+    int line_length;
+    uint64_t seed;
+};
+
+typedef struct _synthetic_spec synthetic_spec;
+
+//the defaults for a shape: a day from 06:52 (the midnight shape gets four
+//hours around midnight instead), 100 byte lines, 1GB
+void synthetic_spec_defaults(synthetic_spec *spec, synthetic_shape shape);
+
+//"uniform", "diurnal"... SHAPE_COUNT if it's not one of them
+synthetic_shape synthetic_shape_from_name(const char *name);
+const char *synthetic_shape_name(synthetic_shape shape);
+
+//spec files are the magic line then key=value lines.  parse fills in
+//whatever the text sets on top of the defaults for its shape, returns -1 if
+//it isn't a spec.  format writes one, returning its length.
+int synthetic_spec_parse(const char *text, size_t length, synthetic_spec *spec);
+int synthetic_spec_format(const synthetic_spec *spec, char *text, size_t length);
+
+//"Mmm dd hh:mm:ss" for the spec's start, -1 if it doesn't parse
+int synthetic_spec_set_start(synthetic_spec *spec, const char *stamp);
+
+//lays out the log, second by second.  after that reads can go anywhere
+//and from any number of threads at once.  returns -1 if the spec is no good.
+int synthetic_log_open(const synthetic_spec *spec);
+void synthetic_log_close(void);
+
+off_t synthetic_log_size(void);
+
+//pread() on the log, the bytes get made up as they're asked for
+ssize_t synthetic_log_read(char *buffer, size_t size, off_t offset);
+
+#endif
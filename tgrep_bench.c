@@ -0,0 +1,902 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    tgrep_bench.c
+// Notes:   End to end benchmark.  For every log shape it has log_gen write a
+//          real log and a virtual (TB sized) one, then runs each query
+//          through tgrep cold (no map, log dropped from the page cache) and
+//          warm (map already built) and writes everything to a JSON report
+//          so runs can be compared from one commit to the next.
+//
+//          Wall and cpu time come from plain runs.  One extra run of each
+//          kind is made under ptrace to count syscalls and read what the
+//          kernel says was read (/proc/pid/io), since strace and perf
+//          aren't always there.  Probe counts and the rest come from
+//          tgrep's own --stats.
+//
+//          Not part of tgrep itself, "make bench" builds and runs it.
+//
+//          usage: tgrep_bench [--tgrep PATH] [--log-gen PATH] [--dir DIR]
+//                             [--report FILE] [--size N] [--virtual-size N]
+//                             [--shapes a,b,...] [--query Q]... [--runs N]
+//                             [--label TEXT] [--keep]
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+
+
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+#define BENCH_DEFAULT_SIZE      "256M"
+#define BENCH_DEFAULT_VIRTUAL   "1T"
+#define BENCH_DEFAULT_RUNS      (3)
+#define BENCH_MAX_RUNS          (50)
+#define BENCH_MAX_QUERIES       (32)
+#define BENCH_MAX_THREADS       (256)
+#define BENCH_STATS_MAX         (4096)
+#define BENCH_SHAPES            "uniform,diurnal,bursty,gaps,midnight,long_lines"
+
+#define OPTION_TGREP            (256)
+#define OPTION_LOG_GEN          (257)
+#define OPTION_DIR              (258)
+#define OPTION_REPORT           (259)
+#define OPTION_SIZE             (260)
+#define OPTION_VIRTUAL_SIZE     (261)
+#define OPTION_SHAPES           (262)
+#define OPTION_QUERY            (263)
+#define OPTION_RUNS             (264)
+#define OPTION_LABEL            (265)
+#define OPTION_KEEP             (266)
+
+#define BENCH_SYSCALL(name)     {SYS_##name, #name}
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+
+//the syscalls worth naming in the report, everything else is just counted
+struct _bench_syscall {
+    long number;
+    const char *name;
+};
+
+typedef struct _bench_syscall bench_syscall;
+
+//one tgrep run.  the syscall and /proc numbers only get filled in by
+//traced runs.
+struct _run_result {
+    double wall_seconds;
+    double user_seconds;
+    double system_seconds;
+    long max_rss_kb;
+    int exit_code;
+    long long syscalls;
+    long long syscall_counts[32];
+    long long read_chars;
+    long long read_bytes;
+    long long read_syscalls;
+    char stats[BENCH_STATS_MAX];
+};
+
+typedef struct _run_result run_result;
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static const bench_syscall named_syscalls[] =
+{
+    BENCH_SYSCALL(read),
+    BENCH_SYSCALL(pread64),
+    BENCH_SYSCALL(readv),
+    BENCH_SYSCALL(write),
+    BENCH_SYSCALL(openat),
+    BENCH_SYSCALL(close),
+    BENCH_SYSCALL(lseek),
+    BENCH_SYSCALL(mmap),
+    BENCH_SYSCALL(munmap),
+    BENCH_SYSCALL(madvise),
+    BENCH_SYSCALL(readahead),
+    BENCH_SYSCALL(splice),
+    BENCH_SYSCALL(copy_file_range),
+    BENCH_SYSCALL(futex),
+#ifdef SYS_fadvise64
+    BENCH_SYSCALL(fadvise64),
+#endif
+#ifdef SYS_sendfile
+    BENCH_SYSCALL(sendfile),
+#endif
+#ifdef SYS_io_uring_enter
+    BENCH_SYSCALL(io_uring_enter),
+#endif
+#ifdef SYS_newfstatat
+    BENCH_SYSCALL(newfstatat),
+#endif
+#ifdef SYS_fstat
+    BENCH_SYSCALL(fstat),
+#endif
+#ifdef SYS_clone3
+    BENCH_SYSCALL(clone3),
+#endif
+    BENCH_SYSCALL(clone)
+};
+
+#define NAMED_SYSCALL_COUNT     ((int)(sizeof(named_syscalls) / sizeof(named_syscalls[0])))
+
+_Static_assert(sizeof(named_syscalls) / sizeof(named_syscalls[0]) <= 32, "too many named syscalls for run_result");
+
+static const char *default_queries[] =
+{
+    "12:00:00",
+    "06:53:00",
+    "00:00:00-00:00:02",
+    "18:30-18:30:10",
+    "23:59:58-00:00:02"
+};
+
+static const char *tgrep_path = "./tgrep";
+static const char *log_gen_path = "./log_gen";
+static char home_path[PATH_MAX];
+static char map_path[PATH_MAX];
+static char stderr_path[PATH_MAX];
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static void _usage(void);
+static double _now(void);
+static int _generate(const char *shape, const char *size, int virtual_log, const char *path, double *seconds);
+static long long _virtual_size(const char *path);
+static void _forget_log(const char *log_path);
+static int _run_tgrep(const char *log_path, const char *query, int traced, run_result *result);
+static void _trace_child(pid_t pid, run_result *result, int *status, struct rusage *usage);
+static void _read_proc_io(pid_t pid, run_result *result);
+static void _read_stats(run_result *result);
+static void _write_runs(FILE *report, const char *name, run_result *runs, int count, run_result *traced);
+static void _write_string(FILE *report, const char *text);
+static int _compare_seconds(const void *a, const void *b);
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+//******************************************************************************
+// Name:    main
+// Notes:   Shape by shape so only one real log has to be on disk at a time
+//
+//******************************************************************************
+int main(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        {"tgrep",        required_argument, 0, OPTION_TGREP},
+        {"log-gen",      required_argument, 0, OPTION_LOG_GEN},
+        {"dir",          required_argument, 0, OPTION_DIR},
+        {"report",       required_argument, 0, OPTION_REPORT},
+        {"size",         required_argument, 0, OPTION_SIZE},
+        {"virtual-size", required_argument, 0, OPTION_VIRTUAL_SIZE},
+        {"shapes",       required_argument, 0, OPTION_SHAPES},
+        {"query",        required_argument, 0, OPTION_QUERY},
+        {"runs",         required_argument, 0, OPTION_RUNS},
+        {"label",        required_argument, 0, OPTION_LABEL},
+        {"keep",         no_argument,       0, OPTION_KEEP},
+        {"help",         no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    const char *queries[BENCH_MAX_QUERIES];
+    const char *directory = "bench_data";
+    const char *report_path = "bench_report.json";
+    const char *size = BENCH_DEFAULT_SIZE;
+    const char *virtual_size = BENCH_DEFAULT_VIRTUAL;
+    const char *label = "";
+    char shapes[256] = BENCH_SHAPES;
+    char absolute[PATH_MAX];
+    char log_path[PATH_MAX];
+    run_result cold[BENCH_MAX_RUNS];
+    run_result warm[BENCH_MAX_RUNS];
+    run_result cold_traced;
+    run_result warm_traced;
+    struct stat log_stat;
+    FILE *report;
+    char *shape;
+    char *saved;
+    double seconds;
+    long long bytes;
+    int query_count = 0;
+    int runs = BENCH_DEFAULT_RUNS;
+    int keep = 0;
+    int first_log = 1;
+    int option;
+    int virtual_log;
+    int q;
+    int i;
+
+    while((option = getopt_long(argc, argv, "h", long_options, NULL)) != -1)
+    {
+        switch(option)
+        {
+        case OPTION_TGREP:
+            tgrep_path = optarg;
+            break;
+        case OPTION_LOG_GEN:
+            log_gen_path = optarg;
+            break;
+        case OPTION_DIR:
+            directory = optarg;
+            break;
+        case OPTION_REPORT:
+            report_path = optarg;
+            break;
+        case OPTION_SIZE:
+            size = optarg;
+            break;
+        case OPTION_VIRTUAL_SIZE:
+            virtual_size = optarg;
+            break;
+        case OPTION_SHAPES:
+            snprintf(shapes, sizeof(shapes), "%s", optarg);
+            break;
+        case OPTION_QUERY:
+            if(query_count < BENCH_MAX_QUERIES)
+            {
+                queries[query_count++] = optarg;
+            }
+            break;
+        case OPTION_RUNS:
+            runs = atoi(optarg);
+            break;
+        case OPTION_LABEL:
+            label = optarg;
+            break;
+        case OPTION_KEEP:
+            keep = 1;
+            break;
+        default:
+            _usage();
+            return 1;
+        }
+    }
+    if(optind != argc)
+    {
+        _usage();
+        return 1;
+    }
+    if(runs < 1)
+    {
+        runs = 1;
+    }
+    if(runs > BENCH_MAX_RUNS)
+    {
+        runs = BENCH_MAX_RUNS;
+    }
+    if(query_count == 0)
+    {
+        for(q = 0; q < (int)(sizeof(default_queries) / sizeof(default_queries[0])); q++)
+        {
+            queries[query_count++] = default_queries[q];
+        }
+    }
+
+    //tgrep gets its own HOME so its maps can be thrown away for cold runs
+    mkdir(directory, 0777);
+    if(realpath(directory, absolute) == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", directory, strerror( errno ));
+        return 1;
+    }
+    if(snprintf(home_path, sizeof(home_path), "%s/home", absolute) >= (int)sizeof(home_path) ||
+       snprintf(map_path, sizeof(map_path), "%s/.tgrepmapfiles", home_path) >= (int)sizeof(map_path) ||
+       snprintf(stderr_path, sizeof(stderr_path), "%s/tgrep.stderr", absolute) >= (int)sizeof(stderr_path))
+    {
+        fprintf(stderr, "%s: path too long\n", directory);
+        return 1;
+    }
+    mkdir(home_path, 0777);
+
+    report = fopen(report_path, "w");
+    if(report == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", report_path, strerror( errno ));
+        return 1;
+    }
+    fprintf(report, "{\n  \"label\": ");
+    _write_string(report, label);
+    fprintf(report, ",\n  \"time\": %lld,\n  \"cpus\": %ld,\n  \"runs\": %d,\n  \"logs\": [",
+            (long long int)time(NULL), sysconf(_SC_NPROCESSORS_ONLN), runs);
+
+    for(shape = strtok_r(shapes, ",", &saved); shape != NULL; shape = strtok_r(NULL, ",", &saved))
+    {
+        for(virtual_log = 0; virtual_log <= 1; virtual_log++)
+        {
+            if(snprintf(log_path, sizeof(log_path), "%s/%s.%s", absolute, shape, virtual_log ? "spec" : "log") >= (int)sizeof(log_path))
+            {
+                continue;
+            }
+            fprintf(stderr, "%s %s log\n", shape, virtual_log ? "virtual" : "real");
+            if(_generate(shape, virtual_log ? virtual_size : size, virtual_log, log_path, &seconds) < 0)
+            {
+                fprintf(stderr, "Could not generate %s.\n", log_path);
+                fclose(report);
+                return 1;
+            }
+            if(virtual_log)
+            {
+                bytes = _virtual_size(log_path);
+            }
+            else
+            {
+                bytes = (stat(log_path, &log_stat) == 0) ? (long long)log_stat.st_size : 0;
+            }
+
+            fprintf(report, "%s\n    {\n      \"shape\": ", first_log ? "" : ",");
+            _write_string(report, shape);
+            fprintf(report, ",\n      \"virtual\": %s,\n      \"bytes\": %lld,\n      \"generate_seconds\": %.6f,\n      \"queries\": [",
+                    virtual_log ? "true" : "false", bytes, seconds);
+            first_log = 0;
+
+            for(q = 0; q < query_count; q++)
+            {
+                for(i = 0; i < runs; i++)
+                {
+                    _forget_log(log_path);
+                    _run_tgrep(log_path, queries[q], 0, &cold[i]);
+                }
+                _forget_log(log_path);
+                _run_tgrep(log_path, queries[q], 1, &cold_traced);
+
+                //the traced run left a map behind, everything from here is warm
+                for(i = 0; i < runs; i++)
+                {
+                    _run_tgrep(log_path, queries[q], 0, &warm[i]);
+                }
+                _run_tgrep(log_path, queries[q], 1, &warm_traced);
+
+                fprintf(report, "%s\n        {\n          \"query\": ", (q == 0) ? "" : ",");
+                _write_string(report, queries[q]);
+                fprintf(report, ",\n");
+                _write_runs(report, "cold", cold, runs, &cold_traced);
+                fprintf(report, ",\n");
+                _write_runs(report, "warm", warm, runs, &warm_traced);
+                fprintf(report, "\n        }");
+            }
+            fprintf(report, "\n      ]\n    }");
+
+            if(!keep)
+            {
+                unlink(log_path);
+            }
+        }
+    }
+    fprintf(report, "\n  ]\n}\n");
+    if(fclose(report) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", report_path, strerror( errno ));
+        return 1;
+    }
+    fprintf(stderr, "Report written to %s\n", report_path);
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _usage
+// Notes:   What the options are
+//
+//******************************************************************************
+static void _usage(void)
+{
+    fprintf(stderr, "usage: tgrep_bench [--tgrep PATH] [--log-gen PATH] [--dir DIR] [--report FILE]\n"
+                    "                   [--size N[KMGT]] [--virtual-size N[KMGT]] [--shapes a,b,...]\n"
+                    "                   [--query Q]... [--runs N] [--label TEXT] [--keep]\n");
+}
+
+
+
+//******************************************************************************
+// Name:    _now
+// Notes:   Monotonic seconds
+//
+//******************************************************************************
+static double _now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+
+//******************************************************************************
+// Name:    _generate
+// Notes:   Runs log_gen, timing it
+//
+//******************************************************************************
+static int _generate(const char *shape, const char *size, int virtual_log, const char *path, double *seconds)
+{
+    char *arguments[10];
+    double start = _now();
+    int status;
+    int count = 0;
+    pid_t pid;
+
+    arguments[count++] = (char *)log_gen_path;
+    arguments[count++] = "--shape";
+    arguments[count++] = (char *)shape;
+    arguments[count++] = "--size";
+    arguments[count++] = (char *)size;
+    if(virtual_log)
+    {
+        arguments[count++] = "--virtual";
+    }
+    arguments[count++] = (char *)path;
+    arguments[count] = NULL;
+
+    pid = fork();
+    if(pid < 0)
+    {
+        return -1;
+    }
+    if(pid == 0)
+    {
+        execv(log_gen_path, arguments);
+        fprintf(stderr, "%s: %s\n", log_gen_path, strerror( errno ));
+        _exit(127);
+    }
+    if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+    *seconds = _now() - start;
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _virtual_size
+// Notes:   The size the spec asked for, the log comes out within a line or
+//          so per second of it
+//
+//******************************************************************************
+static long long _virtual_size(const char *path)
+{
+    char line[256];
+    long long size = 0;
+    FILE *spec = fopen(path, "r");
+
+    if(spec == NULL)
+    {
+        return 0;
+    }
+    while(fgets(line, sizeof(line), spec) != NULL)
+    {
+        if(strncmp(line, "size=", 5) == 0)
+        {
+            size = atoll(line + 5);
+        }
+    }
+    fclose(spec);
+    return size;
+}
+
+
+
+//******************************************************************************
+// Name:    _forget_log
+// Notes:   Throws away every map and index, and asks the kernel to drop the
+//          log from the page cache (it only does that for clean pages, which
+//          a log we just wrote and fsynced is)
+//
+//******************************************************************************
+static void _forget_log(const char *log_path)
+{
+    char path[PATH_MAX];
+    struct dirent *entry;
+    DIR *maps = opendir(map_path);
+    int fd;
+
+    if(maps != NULL)
+    {
+        while((entry = readdir(maps)) != NULL)
+        {
+            if(entry->d_name[0] == '.' && (entry->d_name[1] == '\0' || (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+            {
+                continue;
+            }
+            if(snprintf(path, sizeof(path), "%s/%s", map_path, entry->d_name) < (int)sizeof(path))
+            {
+                unlink(path);
+            }
+        }
+        closedir(maps);
+    }
+
+    fd = open(log_path, O_RDONLY);
+    if(fd >= 0)
+    {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _run_tgrep
+// Notes:   tgrep --stats QUERY LOG, output thrown away, stderr kept for the
+//          stats line
+//
+//******************************************************************************
+static int _run_tgrep(const char *log_path, const char *query, int traced, run_result *result)
+{
+    char *arguments[] = {(char *)tgrep_path, "--stats", (char *)query, (char *)log_path, NULL};
+    struct rusage usage;
+    double start;
+    int status = 0;
+    int fd;
+    pid_t pid;
+
+    memset(result, 0, sizeof(*result));
+    start = _now();
+    pid = fork();
+    if(pid < 0)
+    {
+        return -1;
+    }
+    if(pid == 0)
+    {
+        setenv("HOME", home_path, 1);
+        fd = open("/dev/null", O_WRONLY);
+        dup2(fd, STDOUT_FILENO);
+        fd = open(stderr_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        dup2(fd, STDERR_FILENO);
+        if(traced)
+        {
+            ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+            raise(SIGSTOP);
+        }
+        execv(tgrep_path, arguments);
+        _exit(127);
+    }
+
+    if(traced)
+    {
+        _trace_child(pid, result, &status, &usage);
+    }
+    else
+    {
+        wait4(pid, &status, 0, &usage);
+    }
+    result->wall_seconds = _now() - start;
+    result->user_seconds = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6;
+    result->system_seconds = (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+    result->max_rss_kb = usage.ru_maxrss;
+    result->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    _read_stats(result);
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _trace_child
+// Notes:   Stops at every syscall entry and exit of every thread.  Which one
+//          a stop is gets tracked per thread, so the count works on kernels
+//          without PTRACE_GET_SYSCALL_INFO (which is only needed to know
+//          which syscall it was).  /proc/pid/io gets read as the process
+//          exits, while it's still there.
+//
+//******************************************************************************
+static void _trace_child(pid_t pid, run_result *result, int *status, struct rusage *usage)
+{
+    pid_t threads[BENCH_MAX_THREADS];
+    char in_syscall[BENCH_MAX_THREADS];
+    int thread_count = 1;
+    int deliver;
+    int signal_number;
+    int event;
+    int slot;
+    int i;
+    pid_t tid;
+#ifdef PTRACE_GET_SYSCALL_INFO
+    struct __ptrace_syscall_info info;
+#endif
+
+    threads[0] = pid;
+    in_syscall[0] = 0;
+    memset(usage, 0, sizeof(*usage));
+    if(waitpid(pid, status, __WALL) != pid)
+    {
+        return;
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE |
+                                                       PTRACE_O_TRACEEXIT | PTRACE_O_EXITKILL));
+    ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+
+    for(;;)
+    {
+        tid = wait4(-1, status, __WALL, usage);
+        if(tid < 0)
+        {
+            break;
+        }
+        if(WIFEXITED(*status) || WIFSIGNALED(*status))
+        {
+            if(tid == pid)
+            {
+                break;
+            }
+            continue;
+        }
+        if(!WIFSTOPPED(*status))
+        {
+            continue;
+        }
+
+        slot = -1;
+        for(i = 0; i < thread_count; i++)
+        {
+            if(threads[i] == tid)
+            {
+                slot = i;
+                break;
+            }
+        }
+
+        signal_number = WSTOPSIG(*status);
+        event = *status >> 16;
+        deliver = 0;
+        if(slot < 0)
+        {
+            //a new thread, it arrives with a SIGSTOP that isn't for delivering
+            if(thread_count < BENCH_MAX_THREADS)
+            {
+                threads[thread_count] = tid;
+                in_syscall[thread_count] = 0;
+                thread_count++;
+            }
+        }
+        else if(signal_number == (SIGTRAP | 0x80))
+        {
+            in_syscall[slot] = !in_syscall[slot];
+            if(in_syscall[slot])
+            {
+                result->syscalls++;
+#ifdef PTRACE_GET_SYSCALL_INFO
+                if(ptrace(PTRACE_GET_SYSCALL_INFO, tid, (void *)sizeof(info), &info) > 0 &&
+                   info.op == PTRACE_SYSCALL_INFO_ENTRY)
+                {
+                    for(i = 0; i < NAMED_SYSCALL_COUNT; i++)
+                    {
+                        if((long)info.entry.nr == named_syscalls[i].number)
+                        {
+                            result->syscall_counts[i]++;
+                            break;
+                        }
+                    }
+                }
+#endif
+            }
+        }
+        else if(event == PTRACE_EVENT_EXIT && tid == pid)
+        {
+            _read_proc_io(pid, result);
+        }
+        else if(signal_number != SIGTRAP && event == 0)
+        {
+            deliver = signal_number;
+        }
+        ptrace(PTRACE_SYSCALL, tid, NULL, (void *)(long)deliver);
+    }
+}
+
+
+
+//******************************************************************************
+// Name:    _read_proc_io
+// Notes:   rchar is everything read() and friends returned, read_bytes is
+//          what actually came off the disk
+//
+//******************************************************************************
+static void _read_proc_io(pid_t pid, run_result *result)
+{
+    char path[64];
+    char line[128];
+    FILE *io;
+
+    snprintf(path, sizeof(path), "/proc/%d/io", (int)pid);
+    io = fopen(path, "r");
+    if(io == NULL)
+    {
+        return;
+    }
+    while(fgets(line, sizeof(line), io) != NULL)
+    {
+        if(strncmp(line, "rchar: ", 7) == 0)
+        {
+            result->read_chars = atoll(line + 7);
+        }
+        else if(strncmp(line, "syscr: ", 7) == 0)
+        {
+            result->read_syscalls = atoll(line + 7);
+        }
+        else if(strncmp(line, "read_bytes: ", 12) == 0)
+        {
+            result->read_bytes = atoll(line + 12);
+        }
+    }
+    fclose(io);
+}
+
+
+
+//******************************************************************************
+// Name:    _read_stats
+// Notes:   The last thing --stats writes is one line of JSON, it goes into
+//          the report as it is
+//
+//******************************************************************************
+static void _read_stats(run_result *result)
+{
+    char line[BENCH_STATS_MAX];
+    FILE *errors = fopen(stderr_path, "r");
+
+    strcpy(result->stats, "null");
+    if(errors == NULL)
+    {
+        return;
+    }
+    while(fgets(line, sizeof(line), errors) != NULL)
+    {
+        if(line[0] == '{')
+        {
+            line[strcspn(line, "\n")] = '\0';
+            strcpy(result->stats, line);
+        }
+    }
+    fclose(errors);
+}
+
+
+
+//******************************************************************************
+// Name:    _write_runs
+// Notes:   Times for every plain run plus their min and median, cpu and
+//          memory from the median one, then what the traced run saw
+//
+//******************************************************************************
+static void _write_runs(FILE *report, const char *name, run_result *runs, int count, run_result *traced)
+{
+    run_result *sorted[BENCH_MAX_RUNS];
+    run_result *median;
+    int first = 1;
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        sorted[i] = &runs[i];
+    }
+    qsort(sorted, (size_t)count, sizeof(sorted[0]), _compare_seconds);
+    median = sorted[count / 2];
+
+    fprintf(report, "          \"%s\": {\n            \"wall_seconds\": [", name);
+    for(i = 0; i < count; i++)
+    {
+        fprintf(report, "%s%.6f", i ? ", " : "", runs[i].wall_seconds);
+    }
+    fprintf(report, "],\n            \"wall_seconds_min\": %.6f,\n            \"wall_seconds_median\": %.6f,\n",
+            sorted[0]->wall_seconds, median->wall_seconds);
+    fprintf(report, "            \"user_seconds\": %.6f,\n            \"system_seconds\": %.6f,\n            \"max_rss_kb\": %ld,\n",
+            median->user_seconds, median->system_seconds, median->max_rss_kb);
+    fprintf(report, "            \"exit_code\": %d,\n            \"syscalls\": %lld,\n            \"syscall_counts\": {",
+            median->exit_code, traced->syscalls);
+    for(i = 0; i < NAMED_SYSCALL_COUNT; i++)
+    {
+        if(traced->syscall_counts[i] > 0)
+        {
+            fprintf(report, "%s\"%s\": %lld", first ? "" : ", ", named_syscalls[i].name, traced->syscall_counts[i]);
+            first = 0;
+        }
+    }
+    fprintf(report, "},\n            \"read_syscalls\": %lld,\n            \"read_chars\": %lld,\n            \"read_bytes\": %lld,\n",
+            traced->read_syscalls, traced->read_chars, traced->read_bytes);
+    fprintf(report, "            \"stats\": %s\n          }", median->stats);
+}
+
+
+
+//******************************************************************************
+// Name:    _write_string
+// Notes:   JSON string with the few escapes labels and paths could need
+//
+//******************************************************************************
+static void _write_string(FILE *report, const char *text)
+{
+    fputc('"', report);
+    for(; *text != '\0'; text++)
+    {
+        if(*text == '"' || *text == '\\')
+        {
+            fprintf(report, "\\%c", *text);
+        }
+        else if((unsigned char)*text < 0x20)
+        {
+            fprintf(report, "\\u%04x", (unsigned char)*text);
+        }
+        else
+        {
+            fputc(*text, report);
+        }
+    }
+    fputc('"', report);
+}
+
+
+
+//******************************************************************************
+// Name:    _compare_seconds
+// Notes:   qsort, fastest run first
+//
+//******************************************************************************
+static int _compare_seconds(const void *a, const void *b)
+{
+    const run_result *first = *(run_result * const *)a;
+    const run_result *second = *(run_result * const *)b;
+
+    if(first->wall_seconds < second->wall_seconds)
+    {
+        return -1;
+    }
+    return first->wall_seconds > second->wall_seconds;
+}
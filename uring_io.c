@@ -0,0 +1,759 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    uring_io.c
+// Notes:   An io_uring engine for the two places tgrep does real I/O: the
+//          batches of probe reads and dumping the range out.  Everything
+//          else in tgrep waits on one read at a time, which leaves an NVMe
+//          drive sitting at a queue depth of one.  Here a probe batch is a
+//          single submit, and a dump keeps a queue of reads into registered
+//          buffers going while earlier chunks are being written.
+//
+//          This talks to the kernel with the raw syscalls so there's nothing
+//          extra to link against.  If the ring can't be set up (not linux,
+//          old kernel, a sandbox that blocks it) uring_io_init says so and
+//          the callers carry on with the blocking calls.
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+
+//******************************************************************************
+// Library includes
+//******************************************************************************
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define URING_IO_SUPPORTED
+#endif
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef URING_IO_SUPPORTED
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+
+
+//******************************************************************************
+// Project includes
+//******************************************************************************
+#include "uring_io.h"
+#include "console_output.h"
+
+
+
+#ifdef URING_IO_SUPPORTED
+//******************************************************************************
+// Module Specific #defines
+//******************************************************************************
+
+//submission queue entries.  a probe batch has to fit in one go, --probes
+//tops out at 64 too.
+#define URING_QUEUE_DEPTH       (64)
+
+//the dump pipeline: this many chunks can be read ahead of the one being
+//written
+#define URING_COPY_BUFFERS      (16)
+#define URING_COPY_CHUNK        (256*1024)
+
+//user_data is the chunk's sequence number with the low bit saying whether
+//it was the write
+#define URING_WRITE_FLAG        (1ULL)
+
+
+
+//******************************************************************************
+// Module Specific Types
+//******************************************************************************
+typedef enum
+{
+    SLOT_FREE = 0,
+    SLOT_READING,
+    SLOT_READY
+} slot_state;
+
+//one chunk of the dump and the buffer it lives in
+struct _copy_slot {
+    off_t offset;
+    size_t length;
+    size_t filled;
+    size_t written;
+    slot_state state;
+};
+
+typedef struct _copy_slot copy_slot;
+
+
+
+//******************************************************************************
+// Module Specific Global Variables
+//******************************************************************************
+static int ring_fd = -1;
+static int ring_broken = 0;
+static unsigned ring_entries = 0;
+
+//the shared rings, straight out of the mmaps
+static unsigned *sq_head;
+static unsigned *sq_tail;
+static unsigned *sq_mask;
+static unsigned *sq_array;
+static struct io_uring_sqe *sqes;
+static unsigned *cq_head;
+static unsigned *cq_tail;
+static unsigned *cq_mask;
+static struct io_uring_cqe *cqes;
+
+//queued but not handed to the kernel yet
+static unsigned sq_pending = 0;
+
+//the dump buffers, registered with the ring if the kernel lets us.  the
+//iovecs are for when it doesn't, and have to outlive the submit.
+static char *copy_buffers = NULL;
+static int buffers_registered = 0;
+static struct iovec copy_iovecs[URING_COPY_BUFFERS];
+static struct iovec write_iovec;
+static struct iovec probe_iovecs[URING_QUEUE_DEPTH];
+
+
+
+//******************************************************************************
+// Module Specific Functions
+//******************************************************************************
+static int _ring_setup(void);
+static struct io_uring_sqe *_get_sqe(void);
+static void _queue_sqe(void);
+static int _submit_and_wait(unsigned wait_count);
+static int _next_cqe(struct io_uring_cqe *cqe);
+static int _setup_copy_buffers(void);
+static int _queue_copy_read(int in_fd, copy_slot *slots, unsigned long long sequence);
+static int _queue_copy_write(int out_fd, copy_slot *slots, unsigned long long sequence);
+static void _break_ring(void);
+#endif
+
+
+
+//******************************************************************************
+//******************************************************************************
+// Implimentation
+//******************************************************************************
+//******************************************************************************
+
+#ifdef URING_IO_SUPPORTED
+//******************************************************************************
+// Name:    uring_io_init
+// Notes:   Only tries once, a ring that failed to come up isn't going to come
+//          up on the next file either.
+//
+//******************************************************************************
+int uring_io_init(void)
+{
+    static int tried = 0;
+
+    if(!tried)
+    {
+        tried = 1;
+        if(!_ring_setup())
+        {
+            console_print_debug("io_uring setup failed (%d).\n",errno);
+        }
+    }
+    return uring_io_ready();
+}
+
+
+
+//******************************************************************************
+// Name:    uring_io_ready
+//******************************************************************************
+int uring_io_ready(void)
+{
+    return ring_fd >= 0 && !ring_broken;
+}
+
+
+
+//******************************************************************************
+// Name:    uring_io_read_batch
+// Notes:   The ring is always empty between calls, so the whole batch fits.
+//          A read the kernel bounces back with EAGAIN just gets done the
+//          blocking way.
+//
+//******************************************************************************
+int uring_io_read_batch(int fd, probe_read *reads, int count)
+{
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe cqe;
+    int done = 0;
+    int i;
+
+    if(!uring_io_ready() || count <= 0 || count > URING_QUEUE_DEPTH || (unsigned)count > ring_entries)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        sqe = _get_sqe();
+        if(sqe == NULL)
+        {
+            _break_ring();
+            return -1;
+        }
+        probe_iovecs[i].iov_base = reads[i].buffer;
+        probe_iovecs[i].iov_len = reads[i].size;
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->addr = (unsigned long)&probe_iovecs[i];
+        sqe->len = 1;
+        sqe->off = (unsigned long long)reads[i].offset;
+        sqe->user_data = (unsigned long long)i;
+        _queue_sqe();
+    }
+
+    while(done < count)
+    {
+        if(_submit_and_wait(1) < 0)
+        {
+            _break_ring();
+            return -1;
+        }
+        while(_next_cqe(&cqe))
+        {
+            i = (int)cqe.user_data;
+            if(cqe.res == -EAGAIN || cqe.res == -EINTR)
+            {
+                reads[i].result = pread(fd, reads[i].buffer, reads[i].size, reads[i].offset);
+            }
+            else if(cqe.res < 0)
+            {
+                errno = -cqe.res;
+                reads[i].result = -1;
+            }
+            else
+            {
+                reads[i].result = cqe.res;
+            }
+            done++;
+        }
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    uring_io_copy_range
+// Notes:   Reads are queued for every free buffer, in file order, and the
+//          oldest chunk is written the moment it's in.  Only one write is
+//          ever in flight, since out_fd is usually a pipe or a terminal and
+//          the bytes have to land in order.  A short read means the file got
+//          shorter, nothing past it is written.
+//
+//******************************************************************************
+off_t uring_io_copy_range(int in_fd, off_t start_offset, off_t end_offset, int out_fd)
+{
+    copy_slot slots[URING_COPY_BUFFERS];
+    struct io_uring_cqe cqe;
+    unsigned long long read_sequence = 0;
+    unsigned long long write_sequence = 0;
+    unsigned long long last_sequence = ~0ULL;
+    unsigned long long sequence;
+    copy_slot *slot;
+    off_t read_offset = start_offset;
+    off_t written = 0;
+    int in_flight = 0;
+    int write_in_flight = 0;
+    int failed = 0;
+    int error = 0;
+
+    if(!uring_io_ready() || end_offset < start_offset || _setup_copy_buffers() < 0)
+    {
+        return -1;
+    }
+
+    memset(slots, 0, sizeof(slots));
+    for(;;)
+    {
+        //keep the read queue full
+        while(!failed && read_offset < end_offset && read_sequence < last_sequence &&
+              read_sequence - write_sequence < URING_COPY_BUFFERS)
+        {
+            slot = &slots[read_sequence % URING_COPY_BUFFERS];
+            slot->offset = read_offset;
+            slot->length = URING_COPY_CHUNK;
+            if(end_offset - read_offset < URING_COPY_CHUNK)
+            {
+                slot->length = (size_t)(end_offset - read_offset);
+            }
+            slot->filled = 0;
+            slot->written = 0;
+            slot->state = SLOT_READING;
+            if(_queue_copy_read(in_fd, slots, read_sequence) < 0)
+            {
+                break;
+            }
+            read_offset += (off_t)slot->length;
+            read_sequence++;
+            in_flight++;
+        }
+
+        //and the oldest chunk goes out as soon as it's in
+        slot = &slots[write_sequence % URING_COPY_BUFFERS];
+        if(!failed && !write_in_flight && write_sequence < read_sequence && write_sequence < last_sequence &&
+           slot->state == SLOT_READY)
+        {
+            if(_queue_copy_write(out_fd, slots, write_sequence) == 0)
+            {
+                write_in_flight = 1;
+                in_flight++;
+            }
+        }
+
+        if(in_flight == 0)
+        {
+            break;
+        }
+
+        if(_submit_and_wait(1) < 0)
+        {
+            //we can't tell what the kernel still has hold of, so this ring is
+            //done for good
+            _break_ring();
+            error = errno;
+            failed = 1;
+            break;
+        }
+
+        while(_next_cqe(&cqe))
+        {
+            in_flight--;
+            sequence = cqe.user_data >> 1;
+            slot = &slots[sequence % URING_COPY_BUFFERS];
+
+            if(cqe.user_data & URING_WRITE_FLAG)
+            {
+                write_in_flight = 0;
+                if(cqe.res == -EAGAIN || cqe.res == -EINTR)
+                {
+                    //still ready, it'll get queued again
+                    continue;
+                }
+                if(cqe.res <= 0)
+                {
+                    error = (cqe.res < 0) ? -cqe.res : EIO;
+                    failed = 1;
+                    continue;
+                }
+                slot->written += (size_t)cqe.res;
+                written += cqe.res;
+                if(slot->written == slot->filled)
+                {
+                    slot->state = SLOT_FREE;
+                    write_sequence++;
+                }
+                continue;
+            }
+
+            //a read finished.  anything past a short read doesn't count.
+            if(sequence >= last_sequence)
+            {
+                slot->state = SLOT_FREE;
+                continue;
+            }
+            if(cqe.res == -EAGAIN || cqe.res == -EINTR)
+            {
+                if(_queue_copy_read(in_fd, slots, sequence) == 0)
+                {
+                    in_flight++;
+                    continue;
+                }
+                cqe.res = -EIO;
+            }
+            if(cqe.res < 0)
+            {
+                error = -cqe.res;
+                failed = 1;
+                continue;
+            }
+            slot->filled = (size_t)cqe.res;
+            slot->state = SLOT_READY;
+            if(slot->filled < slot->length)
+            {
+                last_sequence = (slot->filled == 0) ? sequence : sequence + 1;
+            }
+        }
+    }
+
+    if(failed)
+    {
+        if(written == 0)
+        {
+            errno = error;
+            return -1;
+        }
+        console_print_error("Output failed after %lld bytes.\n",(long long int)written);
+    }
+    return written;
+}
+
+
+
+//******************************************************************************
+// Name:    _ring_setup
+// Notes:   The usual dance: set up the ring, then map the submission ring,
+//          the completion ring (one mapping on newer kernels) and the array
+//          of submission entries.
+//
+//******************************************************************************
+static int _ring_setup(void)
+{
+    struct io_uring_params params;
+    size_t sq_size;
+    size_t cq_size;
+    char *sq_ring;
+    char *cq_ring;
+    void *entries;
+    int fd;
+
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(__NR_io_uring_setup, URING_QUEUE_DEPTH, &params);
+    if(fd < 0)
+    {
+        return 0;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(cq_size > sq_size)
+        {
+            sq_size = cq_size;
+        }
+        cq_size = sq_size;
+    }
+
+    sq_ring = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sq_ring == MAP_FAILED)
+    {
+        close(fd);
+        return 0;
+    }
+    cq_ring = sq_ring;
+    if(!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        cq_ring = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(cq_ring == MAP_FAILED)
+        {
+            munmap(sq_ring, sq_size);
+            close(fd);
+            return 0;
+        }
+    }
+    entries = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(entries == MAP_FAILED)
+    {
+        if(cq_ring != sq_ring)
+        {
+            munmap(cq_ring, cq_size);
+        }
+        munmap(sq_ring, sq_size);
+        close(fd);
+        return 0;
+    }
+
+    sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+    sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+    sq_mask = (unsigned *)(sq_ring + params.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+    sqes = entries;
+    cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+    cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+    cq_mask = (unsigned *)(cq_ring + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    ring_entries = params.sq_entries;
+    ring_fd = fd;
+
+    console_print_debug("io_uring ready with %u entries.\n",ring_entries);
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _get_sqe
+// Notes:   The next free submission entry, cleared, or NULL if the ring is
+//          full.  We're the only thread that ever submits.
+//
+//******************************************************************************
+static struct io_uring_sqe *_get_sqe(void)
+{
+    unsigned tail = *sq_tail;
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    unsigned index;
+
+    if(tail - head >= ring_entries)
+    {
+        return NULL;
+    }
+    index = tail & *sq_mask;
+    sq_array[index] = index;
+    memset(&sqes[index], 0, sizeof(struct io_uring_sqe));
+    return &sqes[index];
+}
+
+
+
+//******************************************************************************
+// Name:    _queue_sqe
+// Notes:   Publishes the entry _get_sqe handed out
+//
+//******************************************************************************
+static void _queue_sqe(void)
+{
+    __atomic_store_n(sq_tail, *sq_tail + 1, __ATOMIC_RELEASE);
+    sq_pending++;
+}
+
+
+
+//******************************************************************************
+// Name:    _submit_and_wait
+// Notes:   Hands over everything queued and waits for at least wait_count
+//          completions
+//
+//******************************************************************************
+static int _submit_and_wait(unsigned wait_count)
+{
+    int result;
+
+    do
+    {
+        result = (int)syscall(__NR_io_uring_enter, ring_fd, sq_pending, wait_count,
+                              wait_count ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while(result < 0 && errno == EINTR);
+
+    if(result < 0)
+    {
+        return -1;
+    }
+    sq_pending -= ((unsigned)result > sq_pending) ? sq_pending : (unsigned)result;
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _next_cqe
+// Notes:   Copies out the next completion, returns 0 when there aren't any
+//
+//******************************************************************************
+static int _next_cqe(struct io_uring_cqe *cqe)
+{
+    unsigned head = *cq_head;
+
+    if(head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+    *cqe = cqes[head & *cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+
+
+//******************************************************************************
+// Name:    _setup_copy_buffers
+// Notes:   Registering the buffers saves the kernel pinning them on every
+//          request.  Older kernels count that against RLIMIT_MEMLOCK, if it
+//          says no the plain vectored calls work just as well, a bit slower.
+//
+//******************************************************************************
+static int _setup_copy_buffers(void)
+{
+    struct iovec region;
+    int i;
+
+    if(copy_buffers != NULL)
+    {
+        return 0;
+    }
+
+    copy_buffers = mmap(NULL, (size_t)URING_COPY_BUFFERS * URING_COPY_CHUNK, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(copy_buffers == MAP_FAILED)
+    {
+        copy_buffers = NULL;
+        return -1;
+    }
+    for(i = 0; i < URING_COPY_BUFFERS; i++)
+    {
+        copy_iovecs[i].iov_base = copy_buffers + (size_t)i * URING_COPY_CHUNK;
+        copy_iovecs[i].iov_len = URING_COPY_CHUNK;
+    }
+
+    region.iov_base = copy_buffers;
+    region.iov_len = (size_t)URING_COPY_BUFFERS * URING_COPY_CHUNK;
+    if(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, &region, 1) == 0)
+    {
+        buffers_registered = 1;
+    }
+    else
+    {
+        console_print_debug("Could not register io_uring buffers (%d), using plain reads.\n",errno);
+    }
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _queue_copy_read
+// Notes:   Reads the whole of a chunk into its buffer
+//
+//******************************************************************************
+static int _queue_copy_read(int in_fd, copy_slot *slots, unsigned long long sequence)
+{
+    int index = (int)(sequence % URING_COPY_BUFFERS);
+    struct io_uring_sqe *sqe = _get_sqe();
+
+    if(sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->fd = in_fd;
+    sqe->off = (unsigned long long)slots[index].offset;
+    sqe->user_data = sequence << 1;
+    if(buffers_registered)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (unsigned long)copy_iovecs[index].iov_base;
+        sqe->len = (unsigned)slots[index].length;
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        copy_iovecs[index].iov_len = slots[index].length;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (unsigned long)&copy_iovecs[index];
+        sqe->len = 1;
+    }
+    _queue_sqe();
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _queue_copy_write
+// Notes:   Writes whatever of the chunk hasn't gone out yet.  An offset of -1
+//          means "wherever out_fd is", so regular files get appended to just
+//          like write() would.
+//
+//******************************************************************************
+static int _queue_copy_write(int out_fd, copy_slot *slots, unsigned long long sequence)
+{
+    int index = (int)(sequence % URING_COPY_BUFFERS);
+    char *data = (char *)copy_iovecs[index].iov_base + slots[index].written;
+    struct io_uring_sqe *sqe = _get_sqe();
+
+    if(sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->fd = out_fd;
+    sqe->off = ~0ULL;
+    sqe->user_data = (sequence << 1) | URING_WRITE_FLAG;
+    if(buffers_registered)
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->addr = (unsigned long)data;
+        sqe->len = (unsigned)(slots[index].filled - slots[index].written);
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        write_iovec.iov_base = data;
+        write_iovec.iov_len = slots[index].filled - slots[index].written;
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->addr = (unsigned long)&write_iovec;
+        sqe->len = 1;
+    }
+    _queue_sqe();
+    return 0;
+}
+
+
+
+//******************************************************************************
+// Name:    _break_ring
+// Notes:   Something went wrong talking to the kernel.  Stop using the ring,
+//          the callers fall back to the blocking calls from here on.
+//
+//******************************************************************************
+static void _break_ring(void)
+{
+    console_print_debug("io_uring failed (%d), using blocking I/O from here on.\n",errno);
+    ring_broken = 1;
+}
+
+#else
+
+//******************************************************************************
+// Name:    uring_io_init
+// Notes:   No io_uring on this platform, everything uses the blocking calls.
+//
+//******************************************************************************
+int uring_io_init(void)
+{
+    return 0;
+}
+
+int uring_io_ready(void)
+{
+    return 0;
+}
+
+int uring_io_read_batch(int fd, probe_read *reads, int count)
+{
+    (void)fd;
+    (void)reads;
+    (void)count;
+    return -1;
+}
+
+off_t uring_io_copy_range(int in_fd, off_t start_offset, off_t end_offset, int out_fd)
+{
+    (void)in_fd;
+    (void)start_offset;
+    (void)end_offset;
+    (void)out_fd;
+    return -1;
+}
+#endif
@@ -0,0 +1,53 @@
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//******************************************************************************
+//******************************************************************************
+// Name:    uring_io.h
+// Notes:   header for the uring_io module
+//
+//
+// Rev:     17-Oct-2026 Initial Rev
+//
+//******************************************************************************
+//******************************************************************************
+
+
+#ifndef __TGREP_URING_IO_H__
+#define __TGREP_URING_IO_H__
+
+#include <sys/types.h>
+
+#include "probe_pool.h"
+
+//sets up the ring.  returns 1 if io_uring works here, 0 if it doesn't (not
+//linux, an old kernel, a seccomp filter saying no...), in which case
+//everything keeps using the blocking calls.
+int uring_io_init(void);
+int uring_io_ready(void);
+
+//every read in the batch goes to the kernel in one submit.  returns 0 once
+//they've all finished (each one's result filled in like pread would), or -1
+//if the ring couldn't take them and the caller should read them some other
+//way.
+int uring_io_read_batch(int fd, probe_read *reads, int count);
+
+//copies [start_offset, end_offset) of in_fd to out_fd with a queue of reads
+//running ahead of the writes, which go out in order.  returns the bytes
+//written (less than asked if the file shrank or output failed part way), or
+//-1 if the ring couldn't do anything with these descriptors.
+off_t uring_io_copy_range(int in_fd, off_t start_offset, off_t end_offset, int out_fd);
+
+#endif